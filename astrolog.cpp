@@ -95,76 +95,32 @@ void InitColors(void)
 }
 
 
-// This is the dispatch procedure for the entire program. After all the
-// command switches have been processed, this routine is called to actually
-// call the various routines to generate and display the charts.
+// Set up the current chart, and the chart it's compared with, for a chart or
+// pair of charts from the chart list, as done with the -5e switch.
 
-void Action(void)
+void SetListChart(int iList, int iList2)
 {
-  char sz[cchSzMax];
-  int cSequenceLine = us.cSequenceLine, iList, iList2, iLine, i;
-  flag fDoList, fHTML, fHTMLClip;
-
-  // If the -os switch is in effect, open a file and set a global to
-  // internally 'redirect' all screen output to.
-
-  if (is.szFileScreen) {
-    is.S = fopen(is.szFileScreen, "w");
-    if (is.S == NULL) {
-      sprintf(sz, "File %s can not be created.", is.szFileScreen);
-      PrintError(sz);
-      is.S = stdout;
-    }
-  } else
-    is.S = stdout;
-  is.cchRow = is.cchCol = is.cchColMax = 0;
-
-  // If the -kh switch is in effect, start outputting a new HTML file.
-
-  fHTML = us.fTextHTML && !us.fGraphics && is.S != stdout;
-  if (fHTML) {
-    fHTMLClip = is.nHTML < 0;
-    is.nHTML = 2;
-    if (fHTMLClip)
-      PrintSz("Version:0.9\n"
-        "StartHTML:00000161\n"
-        "EndHTML:00010000\n"
-        "StartFragment:00000196\n"
-        "EndFragment:00010000\n");
-    sprintf(sz, "<html>\n<head><meta charset=\"UTF-8\"><title>Astrolog %s"
-      "</title></head>\n<body>", szVersionCore); PrintSz(sz);
-    if (fHTMLClip)
-      PrintSz("\n<!--StartFragment -->\n");
-    PrintSz("<font face=\"Courier\">");
-    is.nHTML = 3;
-  } else
-    is.nHTML = 0;
+  is.iciIndex1 = iList; is.iciIndex2 = iList2;
+  if (us.nListAll == 1)
+    ciCore = ciMain = is.rgci[iList];
+  else if (us.nListAll == 2)
+    ciTwin = is.rgci[iList];
+  else {
+    ciCore = ciMain = is.rgci[iList];
+    ciTwin = is.rgci[iList2];
+  }
+}
 
-  if (us.nCharsetOut == ccUTF8 && is.S != stdout)
-    fprintf(is.S, "%c%c%c", 0xef, 0xbb, 0xbf);
 
-  // If the -5e switch is in effect, loop over all charts in chart list.
+// Cast and display the current chart, after any -Yq command line for it has
+// been processed. Return -1 if chart info wasn't available, 1 if a graphics
+// chart was drawn, and 0 otherwise. The parameters are only checked in
+// Windows, to decide whether the chart needs to be cast again.
 
-  fDoList = (us.nListAll > 0 && !us.fGraphics && is.cci > 0 &&
-    !(us.nListAll == 3 && is.cci < 2));
-  iList = (us.nListAll == 3); iList2 = 0;
-LNextList:
-  if (fDoList) {
-    is.iciIndex1 = iList; is.iciIndex2 = iList2;
-    if (us.nListAll == 1)
-      ciCore = ciMain = is.rgci[iList];
-    else if (us.nListAll == 2)
-      ciTwin = is.rgci[iList];
-    else {
-      ciCore = ciMain = is.rgci[iList];
-      ciTwin = is.rgci[iList2];
-    }
-  }
-  iLine = 0;
+int NActionChart(int cSequenceLine, flag fDoList)
+{
+  int i;
 
-LNextLine:
-  if (iLine < cSequenceLine && is.rgszLine[iLine] != NULL)
-    FProcessCommandLine(is.rgszLine[iLine]);
   is.fMult = fFalse;
   is.fSzPersist = is.fNoEphFile = fFalse;
   InitColors();
@@ -193,19 +149,26 @@ LNextLine:
       ignore[i] = ignore2[i] = fTrue;
 
   if (FPrintTables())    // Print out any generic tables specified.
-    goto LDone;          // If nothing else to do, then exit right away.
+    return 0;            // If nothing else to do, then exit right away.
   if (is.fMult) {
     PrintL2();
     is.fMult = fFalse;
   }
 
+  // If the -5p switch is in effect, compare pairs of charts in chart list.
+
+  if (fDoList && us.nListPair > 0) {
+    ChartListPairs();
+    return 0;
+  }
+
   // Here either do a normal chart or some kind of relationship chart.
 
   if (!us.nRel) {
 #ifndef WIN
     // If chart info not in memory yet, then prompt the user for it.
     if (!is.fHaveInfo && !FInputData(szTtyCore))
-      return;
+      return -1;
     ciMain = ciCore;
     CastChart(1);
 #else
@@ -227,45 +190,252 @@ LNextLine:
   if (us.fGraphics) {
     // If in -X graphics mode, go make a graphics chart.
     FActionX();
-    iLine = cSequenceLine;    // Once any graphics drawn, stop looping!
-  } else
+    return 1;
+  }
 #endif
-  {
-    // If not in graphics mode, print a text only chart on screen.
+
+  // If not in graphics mode, print a text only chart on screen.
 #ifdef GRAPH
-    if (gs.fInverse) {
-      SwapN(kBlackA, kWhiteA);
-      SwapN(kLtGrayA, kDkGrayA);
-      AnsiColor(kDefault);
-    }
+  if (gs.fInverse) {
+    SwapN(kBlackA, kWhiteA);
+    SwapN(kLtGrayA, kDkGrayA);
+    AnsiColor(kDefault);
+  }
 #endif
 #ifdef EXPRESS
   // Notify AstroExpression a chart is about to be drawn.
   if (!us.fExpOff && FSzSet(us.szExpDisp1))
     ParseExpression(us.szExpDisp1);
 #endif
-    PrintChart(is.fProgress);
+  PrintChart(is.fProgress);
 #ifdef EXPRESS
   // Notify AstroExpression a chart has just been drawn.
   if (!us.fExpOff && FSzSet(us.szExpDisp2))
     ParseExpression(us.szExpDisp2);
 #endif
 #ifdef GRAPH
-    if (gs.fInverse) {
-      SwapN(kBlackA, kWhiteA);
-      SwapN(kLtGrayA, kDkGrayA);
-    }
+  if (gs.fInverse) {
+    SwapN(kBlackA, kWhiteA);
+    SwapN(kLtGrayA, kDkGrayA);
+  }
 #endif
+  return 0;
+}
+
+
+#ifdef THREADS
+// Return the chart, and chart it's compared with, for an index into all the
+// charts or pairs of charts the -5e switch loops over.
+
+void ListChartFromIndex(long ind, int *piList, int *piList2)
+{
+  int i;
+
+  if (us.nListAll <= 2) {
+    *piList = (int)ind; *piList2 = 0;
+  } else if (us.nListAll >= 4) {
+    *piList = (int)(ind / is.cci); *piList2 = (int)(ind % is.cci);
+  } else {
+    // With -5e3 each chart is paired with every chart before it.
+    i = (int)((1.0 + RSqr(1.0 + 8.0 * (real)ind)) / 2.0);
+    while ((long)i * (i-1) / 2 > ind)
+      i--;
+    while ((long)(i+1) * i / 2 <= ind)
+      i++;
+    *piList = i; *piList2 = (int)(ind - (long)i * (i-1) / 2);
   }
+}
+
+
+typedef struct _ListBlock {
+  long ijob0;     // Index of first chart in block.
+  CONST CC *pcc;  // Context each chart starts from.
+  char **rgpch;   // Text output of each chart.
+  size_t *rgcb;   // Length of each chart's output.
+} LB;
+
+// Cast and display one chart of a block into its own buffer. Called by
+// RunThreadJobs() on worker threads.
+
+void ListChartJob(int ijob, void *pv)
+{
+  LB *plb = (LB *)pv;
+  FILE *file;
+  int iList, iList2, cAlloc;
+
+  plb->rgpch[ijob] = NULL; plb->rgcb[ijob] = 0;
+  file = open_memstream(&plb->rgpch[ijob], &plb->rgcb[ijob]);
+  if (file == NULL)
+    return;
+  cAlloc = is.cAlloc;
+  LoadChartContext(plb->pcc);
+  is.cAlloc = cAlloc;
+  us.nThreads = 1;    // Charts are already spread over threads.
+  ListChartFromIndex(plb->ijob0 + ijob, &iList, &iList2);
+  SetListChart(iList, iList2);
+  is.S = file;
+  NActionChart(0, fTrue);
+  fclose(file);
+}
+
+
+// Display all charts in the chart list but the last one, casting them in
+// blocks over multiple threads, and writing each block's output in list
+// order. Each chart starts from the same settings, so this is only done if
+// no -Yq command lines may change settings between charts. Return false if
+// charts can't be done this way, otherwise set the indexes of the last chart
+// which is left for the caller.
+
+flag FActionListThreads(int cSequenceLine, int *piList, int *piList2)
+{
+  LB lb;
+  CC *pcc;
+  long cjob, ijob;
+  int cthread, cblock, cAlloc, i;
+
+  if (cSequenceLine > 0 || us.nScrollRow > 0 || (!is.fHaveInfo && !us.nRel))
+    return fFalse;
+  cthread = NThreadCount();
+  if (cthread <= 1)
+    return fFalse;
+  if (us.nListAll <= 2)
+    cjob = is.cci;
+  else if (us.nListAll >= 4)
+    cjob = (long)is.cci * is.cci;
+  else
+    cjob = (long)is.cci * (is.cci-1) / 2;
+  cjob--;
+  if (cjob < 1)
+    return fFalse;
+
+  cblock = cthread * 16;
+  pcc = RgAllocate(1, CC, "chart context");
+  lb.rgpch = RgAllocate(cblock, char *, "chart list output");
+  lb.rgcb = RgAllocate(cblock, size_t, "chart list output");
+  if (pcc == NULL || lb.rgpch == NULL || lb.rgcb == NULL) {
+    if (pcc != NULL)
+      DeallocateP(pcc);
+    if (lb.rgpch != NULL)
+      DeallocateP(lb.rgpch);
+    if (lb.rgcb != NULL)
+      DeallocateP(lb.rgcb);
+    return fFalse;
+  }
+  SaveChartContext(pcc);
+  lb.pcc = pcc;
+
+  for (lb.ijob0 = 0; lb.ijob0 < cjob; lb.ijob0 += cblock) {
+    i = (int)Min(cjob - lb.ijob0, (long)cblock);
+    RunThreadJobs(i, ListChartJob, &lb);
+    for (ijob = 0; ijob < i; ijob++) {
+      if (lb.rgpch[ijob] == NULL) {
+        // If a buffer couldn't be made, display this chart directly.
+        cAlloc = is.cAlloc;
+        LoadChartContext(pcc);
+        is.cAlloc = cAlloc;
+        ListChartFromIndex(lb.ijob0 + ijob, piList, piList2);
+        SetListChart(*piList, *piList2);
+        NActionChart(0, fTrue);
+      } else {
+        fwrite(lb.rgpch[ijob], 1, lb.rgcb[ijob], is.S);
+        free(lb.rgpch[ijob]);
+      }
+      PrintL2();
+    }
+  }
+  cAlloc = is.cAlloc;
+  LoadChartContext(pcc);
+  is.cAlloc = cAlloc;
+  ListChartFromIndex(cjob, piList, piList2);
+  DeallocateP(pcc);
+  DeallocateP(lb.rgpch);
+  DeallocateP(lb.rgcb);
+  return fTrue;
+}
+#endif
+
+
+// This is the dispatch procedure for the entire program. After all the
+// command switches have been processed, this routine is called to actually
+// call the various routines to generate and display the charts.
+
+void Action(void)
+{
+  char sz[cchSzMax];
+  int cSequenceLine = us.cSequenceLine, iList, iList2, iLine, i;
+  flag fDoList, fPair, fHTML, fHTMLClip;
+
+  // If the -os switch is in effect, open a file and set a global to
+  // internally 'redirect' all screen output to.
+
+  if (is.szFileScreen) {
+    is.S = fopen(is.szFileScreen, "w");
+    if (is.S == NULL) {
+      sprintf(sz, "File %s can not be created.", is.szFileScreen);
+      PrintError(sz);
+      is.S = stdout;
+    }
+  } else
+    is.S = stdout;
+  is.cchRow = is.cchCol = is.cchColMax = 0;
+
+  // If the -kh switch is in effect, start outputting a new HTML file.
+
+  fHTML = us.fTextHTML && !us.fGraphics && is.S != stdout;
+  if (fHTML) {
+    fHTMLClip = is.nHTML < 0;
+    is.nHTML = 2;
+    if (fHTMLClip)
+      PrintSz("Version:0.9\n"
+        "StartHTML:00000161\n"
+        "EndHTML:00010000\n"
+        "StartFragment:00000196\n"
+        "EndFragment:00010000\n");
+    sprintf(sz, "<html>\n<head><meta charset=\"UTF-8\"><title>Astrolog %s"
+      "</title></head>\n<body>", szVersionCore); PrintSz(sz);
+    if (fHTMLClip)
+      PrintSz("\n<!--StartFragment -->\n");
+    PrintSz("<font face=\"Courier\">");
+    is.nHTML = 3;
+  } else
+    is.nHTML = 0;
+
+  if (us.nCharsetOut == ccUTF8 && is.S != stdout)
+    fprintf(is.S, "%c%c%c", 0xef, 0xbb, 0xbf);
+
+  // If the -5e switch is in effect, loop over all charts in chart list.
+
+  fPair = (us.nListPair > 0 && !us.fGraphics && is.cci > 0);
+  fDoList = fPair || (us.nListAll > 0 && !us.fGraphics && is.cci > 0 &&
+    !(us.nListAll == 3 && is.cci < 2));
+  iList = (us.nListAll == 3); iList2 = 0;
+  is.fCastList = fDoList;
+#ifdef THREADS
+  // If charts can be cast on multiple threads, do all but the last at once.
+  if (fDoList && !fPair)
+    FActionListThreads(cSequenceLine, &iList, &iList2);
+#endif
+LNextList:
+  if (fDoList)
+    SetListChart(iList, iList2);
+  iLine = 0;
+
+LNextLine:
+  if (iLine < cSequenceLine && is.rgszLine[iLine] != NULL)
+    FProcessCommandLine(is.rgszLine[iLine]);
+  i = NActionChart(cSequenceLine, fDoList);
+  if (i < 0)
+    return;
+  if (i > 0)
+    iLine = cSequenceLine;    // Once any graphics drawn, stop looping!
 
-LDone:
   iLine++;
   if (iLine < cSequenceLine) {
     if (!us.fGraphics)
       PrintL2();
     goto LNextLine;
   }
-  if (fDoList) {
+  if (fDoList && !fPair) {
     if (us.nListAll >= 3) {
       iList2++;
       if (iList2 < (us.nListAll >= 4 ? is.cci : iList)) {
@@ -281,6 +451,7 @@ LDone:
     }
     is.iciIndex1 = is.iciIndex2 = -1;
   }
+  is.fCastList = fFalse;
 
   if (fHTML) {           // If -kh switch in effect, end the HTML file.
     is.nHTML = 2;
@@ -679,6 +850,57 @@ int NProcessSwitchesRare(int argc, char **argv, int pos,
     darg++;
     break;
 
+  case 'x':
+    SwitchF(us.fInDayRefine);
+    break;
+
+  case 'M':
+    if (FErrorArgc("YM", argc, 1))
+      return tcError;
+    i = NFromSz(argv[1]);
+    if (FErrorValN("YM", !FValidThreads(i), i, 0))
+      return tcError;
+    us.nThreads = i;
+    darg++;
+    break;
+
+#ifdef EPHEM
+  case 'L':
+    if (FErrorArgc("YL", argc, 1))
+      return tcError;
+    i = NFromSz(argv[1]);
+    if (FErrorValN("YL", i < 0, i, 0))
+      return tcError;
+    us.nPosCache = i;
+    darg++;
+    break;
+#endif
+
+#ifdef SWISS
+  case 'W':
+    i = (ch1 == '0');
+    if (FErrorArgc("YW", argc, 1 + i))
+      return tcError;
+    r = RFromSz(argv[1]);
+    if (FErrorValR("YW", r < 0.0, r, 1))
+      return tcError;
+    us.rChebErr = r;
+    if (i)
+      us.szChebFile = SzPersist(argv[2]);
+    darg += 1 + i;
+    break;
+
+  case 'H':
+    if (FErrorArgc("YH", argc, 1))
+      return tcError;
+    i = NFromSz(argv[1]);
+    if (FErrorValN("YH", !FBetween(i, 0, 2), i, 0))
+      return tcError;
+    us.nPreload = i;
+    darg++;
+    break;
+#endif
+
 #ifdef SWISS
   case 'e':
     if (FErrorArgc("Ye", argc, 2))
@@ -1168,6 +1390,14 @@ int NProcessSwitchesRare(int argc, char **argv, int pos,
       break;
     }
 #ifdef ATLAS
+    if (ch1 == 'c') {
+      if (FErrorArgc("YYc", argc, 1))
+        return tcError;
+      if (!FWriteAtlasBin(argv[1]))
+        return tcError;
+      darg++;
+      break;
+    }
     i = ch1 - '0';
     if (FErrorArgc("YY", argc, 1 + (i == 1 || i == 2)))
       return tcError;
@@ -2623,6 +2853,21 @@ flag FProcessSwitches(int argc, char **argv)
           us.nListAll = FSwitchF(us.nListAll == i) * i;
         else
           FEnumerateCIList(i);   // -5Y does the same as -Y5
+      } else if (ch1 == 'p') {
+        if (FErrorArgc("5p", argc, 2))
+          return fFalse;
+        i = NFromSz(argv[1]);
+        if (FErrorValN("5p", i < 0, i, 0))
+          return fFalse;
+        us.nListPair = 3 + (ch2 == '4');
+        us.nListPairMax = i;
+        us.rListPairMin = RFromSz(argv[2]);
+        argc -= 2; argv += 2;
+      } else if (ch1 == 'c') {
+        if (FErrorArgc("5c", argc, 1))
+          return fFalse;
+        us.szListCache = SzPersist(argv[1]);
+        argc--; argv++;
       } else if (ch1 == 'd')
         FSortCIList(0);
       else if (ch1 == 'x')
@@ -2729,6 +2974,9 @@ flag FProcessSwitches(int argc, char **argv)
       if (ch1 == '0') {
         SwitchF(us.fExpOff);
         break;
+      } else if (ch1 == 'T') {
+        SwitchF(us.fExpProfile);
+        break;
       }
       i = 1 + (ch1 == 'M' || ch1 == '2');
       if (FErrorArgc("~", argc, i))
@@ -2857,6 +3105,7 @@ void InitProgram()
   int i;
 
   Assert(starHi == cObj && cObj == objMax-1);
+  InitChartContext();
   is.S = stdout;
   ClearB((pbyte)szStarCustom, sizeof(szStarCustom));
   CopyRgb(ignore,  ignoreMem,  sizeof(ignore));
@@ -2954,11 +3203,12 @@ void FinalizeProgram(flag fSkip)
 
   if (grid != NULL)
     DeallocateP(grid);
+  GridRelationClose();
   if (is.rgci != NULL)
     DeallocateP(is.rgci);
 #ifdef ATLAS
-  if (is.rgae != NULL)
-    DeallocateP(is.rgae);
+  FreeAtlas();
+  FreeZoneTables();
   if (is.rgzc != NULL)
     DeallocateP(is.rgzc);
   if (is.rgrun != NULL)
@@ -3002,6 +3252,19 @@ void FinalizeProgram(flag fSkip)
 #ifdef WIN
   if (ofn.lpstrFile != NULL && ofn.lpstrFile != szFileName)
     DeallocateP(ofn.lpstrFile);
+#endif
+  CastCacheClose();
+#ifdef EPHEM
+  if (us.nPosCache > 0)
+    PrintPosCacheStats();
+  else
+    PosCacheClose();
+#endif
+#ifdef SWISS
+  if (us.nPreload > 0)
+    PrintPreloadStats();
+  SwissClose();
+  SwissUnmapFiles();
 #endif
   if (!fSkip && is.cAlloc != 0) {
     sprintf(sz, "Number of memory allocations not freed before exiting: %d",
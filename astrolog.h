@@ -81,6 +81,9 @@
 //#define JPLWEB /* Comment out this #define if you don't want to compile in */
                /* features to access the JPL Horizons Website online.      */
 
+//#define THREADS /* Comment out this #define if your system can't create */
+                /* POSIX threads to cast charts on several CPU cores.   */
+
 #define TIME /* Comment out this #define if your compiler can't take the  */
              /* calls to the 'time' or 'localtime' functions as in time.h */
 
@@ -215,6 +218,10 @@
 #define DEFAULT_ATLASFILE "atlas.as"
   // Name of file to look in for default atlas city and time zone list.
 
+#define DEFAULT_ATLASBIN "atlas.ab"
+  // Name of file to look in for compiled atlas city list, created with -YYc,
+  // which is used instead of the above if present and up to date.
+
 #define DEFAULT_TIMECHANGE "timezone.as"
   // Name of file to look in for default list of time zone changes.
 
@@ -316,6 +323,7 @@
 #include <stdlib.h>
 #endif
 #include <math.h>
+#include <string.h>
 #ifdef PC
 #include <malloc.h>
 #include <windows.h>
@@ -349,6 +357,19 @@
 #define WINANY
 #include <windows.h>
 #endif
+#ifdef THREADS
+#include <pthread.h>
+#include <unistd.h>
+#define TLOCAL __thread
+#else
+#define TLOCAL
+#endif
+#ifndef PC
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 #ifdef PC
 #ifdef _WIN64
 #define szArchCore "64 bit"
@@ -434,6 +455,15 @@
 #endif
 #endif // WCLI
 
+#ifdef THREADS
+#ifdef PC
+#error "If 'THREADS' is defined 'PC' must not be as well"
+#endif
+#ifndef SWISS
+#error "If 'THREADS' is defined 'SWISS' must be too"
+#endif
+#endif // THREADS
+
 #ifdef PS
 #ifndef GRAPH
 #error "If 'PS' is defined 'GRAPH' must be too"
@@ -1265,6 +1295,7 @@ enum _terminationcode {
 #define FValidPart(n) FBetween(n, 1, cPart)
 #define FValidDwad(n) FBetween(n, 0, 12)
 #define FValidBioday(n) FBetween(n, 1, 199)
+#define FValidThreads(n) FBetween(n, 0, 256)
 #define FValidScreen(n) FBetween(n, 20, 200)
 #define FValidMacro(n) FBetween(n, 1, 48)
 #define FValidList(n) FBetween(n, 0, is.cci-1)
@@ -1479,6 +1510,35 @@ typedef struct _GridInfo {
   real v[objMax][objMax];  // Value of aspect orb, or degree within sign
 } GridInfo;
 
+// Positions and orbs of the objects along one side of an aspect grid, laid
+// out as parallel arrays. This allows FCreateGrid() and FCreateGridRelation()
+// to rule out most pairs of objects with a few tight loops over all objects
+// and aspects at once, leaving GetAspect() to only be called for pairs with
+// an aspect within orb. Each loop body is branch free so the compiler can
+// vectorize it. Columns for fixed stars are also indexed by zodiac position,
+// so the stars near each aspect angle can be found with a binary search.
+
+typedef struct _AspectKernel {
+  int cobj;                  // Number of objects in the arrays
+  int rgobj[objMax];         // Index of each object
+  real rgpos[objMax];        // Zodiac position of each object
+  real rgalt[objMax];        // Latitude of each object, for 3D aspects
+  real rgorb[objMax];        // Maximum orb allowed by each object
+  real rgadd[objMax];        // Orb added by each object
+  real rgdist[objMax];       // Angle between each object and current one
+  byte rgf[objMax];          // Whether each object may aspect current one
+  int casp;                  // Number of unrestricted aspects
+  int rgasp[cAspect+1];      // Index of each aspect
+  real rgang[cAspect+1];     // Angle of each aspect
+  real rgorbAsp[cAspect+1];  // Maximum orb allowed by each aspect
+  int kStar;                 // Column of the first star, which come last
+  int cstar;                 // Number of stars in index, or 0 if not used
+  int rgkStar[cStar];        // Column of each star, sorted by position
+  real rgposStar[cStar];     // Zodiac position of each star, sorted
+  real orbStar;              // Maximum orb allowed by any star
+  real addStar;              // Maximum orb added by any star
+} AK;
+
 typedef struct _CrossInfo {
   short obj1;  // First planet making crossing
   short ang1;  // Angle in question of first planet
@@ -1525,6 +1585,13 @@ typedef struct _AtlasEntry {
   short izn;             // Time zone area of city
 } AtlasEntry;
 
+typedef struct _AtlasBox {
+  int y, y2;     // Current and last row of cells to enumerate.
+  int x1, ix;    // First column of cells, and current offset from it.
+  int cx;        // Number of columns of cells to enumerate.
+  int i, iMax;   // Current and end position in current cell's city list.
+} AtlasBox;
+
 typedef struct _TimezoneChange {
   int zon;      // Time zone value (in seconds before UTC)
   int irun;     // Daylight Saving rule (if any)
@@ -1553,6 +1620,22 @@ typedef struct _TimezoneRuleEntry {
   int dst;       // Rule applies this Daylight offset (in seconds before UTC)
 } RuleEntry;
 
+typedef struct _ZoneEvent {
+  int mon, day, yea, tim;  // Local time the change takes place
+  int zon, doff;           // Zone and clock offset after change
+  int monPrev, dayPrev, yeaPrev, timPrev;  // Local time of previous change
+  int dstPrev, zonPrev, doffPrev;          // Values in effect before change
+  flag fFirst;             // Whether first zone change, before which is LMT
+} ZoneEvent;
+
+typedef struct _ZoneTable {
+  ZoneEvent *rgze;  // All changes within a time zone area, in order
+  int cze;          // Number of changes in the list above
+  int czeAlloc;     // Number of changes allocated in the list above
+  flag fSorted;     // Whether list is sorted by local time of change
+  int dst, zon;     // Values in effect after the last change
+} ZoneTable;
+
 typedef struct _ChartInfo {
   int mon;    // Month
   int day;    // Day
@@ -1580,6 +1663,35 @@ typedef struct _ChartPositions {
   real lonMC;           // 0 longitude converted to equatorial coordinates
 } CP;
 
+typedef struct _TransitScan {
+  CONST CP *pcpN;  // Natal chart being transited
+  real mc;         // Natal chart's Midheaven, for 3D houses
+  real ob;         // Natal chart's obliquity, for 3D houses
+  int nAsp;        // Number of aspects to search for
+  int division;    // Number of segments to divide each month or day into
+  flag fNoCusp;    // Whether all transited house cusps are restricted
+  flag fProg;      // Whether searching a progressed instead of transit chart
+  flag fSkip;      // Whether segments no event can happen in aren't cast
+} TransitScan;
+
+typedef struct _EventRoot {
+  CI ci;       // Day and location that segment times are relative to
+  real hr1;    // Hours after start of day at start of segment
+  real hr2;    // Hours after start of day at end of segment
+  int obj1;    // First object, or -1 if it's the fixed position pos1
+  int obj2;    // Second object
+  real pos1;   // Position of first object when it's fixed, e.g. natal
+  real angle;  // Signed angle second object is from first when exact
+} EventRoot;
+
+typedef struct _EventSchedule {
+  real rgMove[objMax];     // Total distance each object has moved so far
+  real rgDueSign[objMax];  // Distance moved before next sign check of object
+  real *rgDue;             // Distance moved before next check of each pair
+  flag fFixed1;            // Whether first object of pairs doesn't move
+  int divCast;             // Segments before this one don't need a cast
+} EventSchedule;
+
 #ifdef GRAPH
 typedef struct _ObjDraw {
   int obj;  // The object to draw
@@ -1731,6 +1843,7 @@ typedef struct _UserSettings {
   flag fStarsList;     // -YRU0
   flag fStarMagDist;   // -YUb
   flag fStarMagAbs;    // -YUb0
+  flag fInDayRefine;   // -Yx
   flag fNoWrite;       // -0o
   flag fNoRead;        // -0i
   flag fNoQuit;        // -0q
@@ -1739,6 +1852,7 @@ typedef struct _UserSettings {
   flag fNoNetwork;     // -0n
   flag fNoExp;         // -0~
   flag fExpOff;        // -~0
+  flag fExpProfile;    // -~T
 
   // Value settings
   int   nDecanType;    // -v3
@@ -1764,6 +1878,9 @@ typedef struct _UserSettings {
   int   nScreenWidth;  // -I
   int   nWriteFormat;  // -o
   int   nListAll;      // -5e
+  int   nListPair;     // -5p
+  int   nListPairMax;  // -5p
+  real  rListPairMin;  // -5p
   real  dstDef;        // -z0
   real  zonDef;        // -z
   real  lonDef;        // -zl
@@ -1777,6 +1894,7 @@ typedef struct _UserSettings {
   char *szAstColor;    // -YkE
   char *szStarsColor;  // -YkU
   char *szStarsList;   // -YRU
+  char *szListCache;   // -5c
 
   // Value subsettings
   int   nWheelRows;        // Number of rows per house to use for -w wheel.
@@ -1806,6 +1924,11 @@ typedef struct _UserSettings {
   int   nSignDiv;          // -YRd
   int   iExpADB;           // -~5i
   int   cExpADB;           // -~5i
+  int   nThreads;          // -YM
+  real  rChebErr;          // -YW
+  char *szChebFile;        // -YW0
+  int   nPosCache;         // -YL
+  int   nPreload;          // -YH
 
   // AstroExpression hooks
   char *szExpConfig;   // -~g
@@ -1865,6 +1988,7 @@ typedef struct _InternalSettings {
   flag fSzInteract;    // Are we in middle of chart so some setting fixed?
   flag fNoEphFile;     // Have we already had a ephem file not found error?
   flag fSwissPathSet;  // Has the Swiss Ephemeris path been set yet?
+  flag fCastList;      // Are charts being cast for the chart list?
   char *szProgName;    // The name and path of the executable running.
   char *rgszLine[9];   // The command lines to run before each -Yq chart.
   char *szFileScreen;  // The file to send text output to as passed to -os.
@@ -1917,6 +2041,22 @@ typedef struct _InternalSettings {
   real rNut;           // Nutation offset.
 } IS;
 
+typedef struct _ChartContext {
+  US us;                      // User settings charts are cast with.
+  IS is;                      // Internal settings, including cast results.
+  CI rgci[cRing+1];           // Chart info for core chart and each ring.
+  CI ciTran;                  // Chart info for transit chart.
+  CI ciSave;                  // Chart info for saved chart.
+  CP rgcp[cRing+1];           // Positions for core chart and each ring.
+  byte ignore[objMax];        // Restrictions, which transit casts swap.
+  byte ignore2[objMax];       // Transit restrictions.
+  byte ignore7[rrMax];        // Rulership restrictions, which -7 changes.
+  int rgobjList[objMax];      // Display ordering of objects.
+  int rgobjList2[objMax];     // Reverse lookup of display ordering.
+  int kObjA[objMax];          // Object colors, which stars may change.
+  real rStarBright[cStar+1];  // Star brightnesses, which casts may change.
+} CC;
+
 #ifdef SWISS
 typedef struct _ExtraStar {
   real lon;           // Zodiac position.
@@ -835,7 +835,7 @@ CONST char *rgszzn[iznMax] = {
 
 char *SzCity(int iae)
 {
-  static char szCity[cchSzMax];
+  static TLOCAL char szCity[cchSzMax];
   CONST char *pchState;
   int icn, istate;
 
@@ -869,13 +869,359 @@ int ILookupCN(CONST char *szAbb, CONST CN *rgcn, int ccn)
 }
 
 
+// Header of a compiled binary atlas file, as written by the -YYc switch.
+// The file contains this header followed by the atlas entries exactly as
+// they're stored in memory, with country, state, and time zone indexes
+// already resolved, so it can be mapped into memory and used directly. The
+// city name and location indexes follow the entries, so lookups don't need
+// to build them.
+
+typedef struct _AtlasBinHeader {
+  char szMagic[8];  // File signature: "AstAtl" plus format version.
+  int cbEntry;      // Size of each AtlasEntry record.
+  int cae;          // Number of city entries following the header.
+  int icnew;        // Sizes of the country, state, and zone tables the
+  int icnus;        //   indexes in the entries refer to.
+  int icnca;
+  int izn;
+  int ctri;         // Number of buckets in the city name index.
+  int ciaeTri;      // Number of cities within all the index buckets.
+  int ccell;        // Number of cells in the city location index.
+  long cbSrc;       // Size of the atlas text file the entries came from.
+  long tmSrc;       // Modification time of the atlas text file.
+} AtlasBinHeader;
+
+#define szAtlasBinMagic "AstAtl1"
+#define cbAtlasBinHeader ((int)(sizeof(AtlasBinHeader) + 7) & ~7)
+
+pbyte pbAtlasBin = NULL;  // Compiled atlas file mapped into memory, if any.
+long cbAtlasBin = 0;
+
+// Index of city names by each run of three letters within them, which maps
+// a hash of the three letters to a range of cities within rgiaeTri that
+// contain them. Cities within a range are in atlas order.
+
+#define cAtlasTri 65536
+int *mptriiae = NULL;
+int *rgiaeTri = NULL;
+
+// Index of city locations by one degree latitude/longitude cells, which maps
+// each cell to the range of cities within rgiaeCell located inside it.
+
+#define cAtlasRow 180
+#define cAtlasCol 360
+#define cAtlasCell (cAtlasRow*cAtlasCol)
+int *mpcelliae = NULL;
+int *rgiaeCell = NULL;
+
+
+// Free the atlas city list, whether it's allocated or points within a
+// compiled atlas file mapped into memory.
+
+void FreeAtlas()
+{
+  if (pbAtlasBin != NULL) {
+    UnmapFile(pbAtlasBin, cbAtlasBin);
+    pbAtlasBin = NULL;
+  } else {
+    if (is.rgae != NULL)
+      DeallocateP(is.rgae);
+    if (mptriiae != NULL)
+      DeallocateP(mptriiae);
+    if (rgiaeTri != NULL)
+      DeallocateP(rgiaeTri);
+    if (mpcelliae != NULL)
+      DeallocateP(mpcelliae);
+    if (rgiaeCell != NULL)
+      DeallocateP(rgiaeCell);
+  }
+  is.rgae = NULL;
+  is.cae = 0;
+  mptriiae = rgiaeTri = mpcelliae = rgiaeCell = NULL;
+}
+
+
+// Return the city name index hash bucket for the three letters at the start
+// of a string, ignoring case like FEqSzSubI() does.
+
+int ITriFromSz(CONST char *sz)
+{
+  return (((int)(uchar)ChCap(sz[0]) * 31 + (uchar)ChCap(sz[1])) * 31 +
+    (uchar)ChCap(sz[2])) & (cAtlasTri-1);
+}
+
+
+// Return the city location index cell containing a latitude/longitude.
+
+int ICellFromLonLat(real lon, real lat)
+{
+  int x, y;
+
+  y = (int)RFloor(lat + rDegQuad);
+  y = Min(Max(y, 0), cAtlasRow-1);
+  x = Min((int)Mod(lon), cAtlasCol-1);
+  return y*cAtlasCol + x;
+}
+
+
+// Build the index of city names by the letter triples within them, and the
+// index of city locations by cell, if they haven't been built yet for the
+// current atlas. Each is done with a counting sort, in two linear passes
+// over the cities.
+
+flag FEnsureAtlasIndex()
+{
+  int iae, i, j;
+  CONST char *pch;
+
+  if (mptriiae != NULL)
+    return fTrue;
+  mpcelliae = RgAllocate(cAtlasCell+1, int, "atlas index");
+  if (mpcelliae == NULL)
+    return fFalse;
+  rgiaeCell = RgAllocate(Max(is.cae, 1), int, "atlas index");
+  if (rgiaeCell == NULL)
+    goto LFail;
+  mptriiae = RgAllocate(cAtlasTri+1, int, "atlas index");
+  if (mptriiae == NULL)
+    goto LFail;
+
+  // Sort the cities by location cell.
+  ClearB((pbyte)mpcelliae, sizeof(int)*(cAtlasCell+1));
+  for (iae = 0; iae < is.cae; iae++)
+    mpcelliae[ICellFromLonLat(is.rgae[iae].lon, is.rgae[iae].lat) + 1]++;
+  for (i = 0; i < cAtlasCell; i++)
+    mpcelliae[i+1] += mpcelliae[i];
+  for (iae = 0; iae < is.cae; iae++) {
+    j = ICellFromLonLat(is.rgae[iae].lon, is.rgae[iae].lat);
+    rgiaeCell[mpcelliae[j]++] = iae;
+  }
+  for (i = cAtlasCell; i > 0; i--)
+    mpcelliae[i] = mpcelliae[i-1];
+  mpcelliae[0] = 0;
+  ClearB((pbyte)mptriiae, sizeof(int)*(cAtlasTri+1));
+
+  // Count the triples in each bucket, and turn the counts into offsets.
+  for (iae = 0; iae < is.cae; iae++)
+    for (pch = is.rgae[iae].szNam; pch[0] && pch[1] && pch[2]; pch++)
+      mptriiae[ITriFromSz(pch) + 1]++;
+  for (i = 0; i < cAtlasTri; i++)
+    mptriiae[i+1] += mptriiae[i];
+  rgiaeTri = RgAllocate(Max(mptriiae[cAtlasTri], 1), int, "atlas index");
+  if (rgiaeTri == NULL)
+    goto LFail;
+
+  // Fill in the buckets, which leaves each offset at the start of the next.
+  for (iae = 0; iae < is.cae; iae++)
+    for (pch = is.rgae[iae].szNam; pch[0] && pch[1] && pch[2]; pch++) {
+      j = ITriFromSz(pch);
+      rgiaeTri[mptriiae[j]++] = iae;
+    }
+  for (i = cAtlasTri; i > 0; i--)
+    mptriiae[i] = mptriiae[i-1];
+  mptriiae[0] = 0;
+  return fTrue;
+
+LFail:
+  if (mpcelliae != NULL)
+    DeallocateP(mpcelliae);
+  if (rgiaeCell != NULL)
+    DeallocateP(rgiaeCell);
+  if (mptriiae != NULL)
+    DeallocateP(mptriiae);
+  mptriiae = mpcelliae = rgiaeCell = NULL;
+  return fFalse;
+}
+
+
+// Start enumerating the cities located within a latitude/longitude box, by
+// the cells of the city location index overlapping it. The longitude range
+// goes from the first to the second value, and may wrap around. If the index
+// isn't available, all cities in the atlas are enumerated instead.
+
+void AtlasBoxInit(AtlasBox *pab, real lon1, real lon2, real lat1, real lat2)
+{
+  int x2;
+
+  pab->i = pab->iMax = 0;
+  if (!FEnsureAtlasIndex()) {
+    pab->iMax = is.cae;
+    pab->y = pab->y2 = 0;
+    pab->ix = pab->cx = 0;
+    return;
+  }
+  if (lon2 - lon1 >= rDegMax) {
+    pab->x1 = 0;
+    pab->cx = cAtlasCol;
+  } else {
+    pab->x1 = Min((int)Mod(lon1), cAtlasCol-1);
+    x2 = (int)RFloor(Mod(lon1) + (lon2 - lon1));
+    pab->cx = Min(x2 - pab->x1 + 1, cAtlasCol);
+  }
+  pab->y = Max((int)RFloor(lat1 + rDegQuad), 0);
+  pab->y2 = Min((int)RFloor(lat2 + rDegQuad), cAtlasRow-1);
+  pab->ix = -1;
+}
+
+
+// Return the next city within the box being enumerated, or -1 when done.
+// Cities are returned a cell at a time, so they aren't in atlas order, and
+// may be outside the box within cells on the edge of it.
+
+int IaeAtlasBoxNext(AtlasBox *pab)
+{
+  int icell;
+
+  while (pab->i >= pab->iMax) {
+    if (++pab->ix >= pab->cx) {
+      pab->ix = 0;
+      if (++pab->y > pab->y2)
+        return -1;
+    }
+    icell = pab->y*cAtlasCol + (pab->x1 + pab->ix) % cAtlasCol;
+    pab->i = mpcelliae[icell];
+    pab->iMax = mpcelliae[icell+1];
+  }
+  return rgiaeCell != NULL ? rgiaeCell[pab->i++] : pab->i++;
+}
+
+
+// Get the size and modification time of the atlas text file, so compiled
+// atlases can tell whether they're out of date. Return whether it exists.
+
+flag FAtlasSourceStamp(long *pcb, long *ptm)
+{
+  FILE *file;
+
+  file = FileOpen(DEFAULT_ATLASFILE, 0, NULL);
+  if (file == NULL)
+    return fFalse;
+  GetFileStamp(file, pcb, ptm);
+  fclose(file);
+  return fTrue;
+}
+
+
+// Load the compiled binary atlas file if present, by mapping it into memory.
+// The file is rejected if it doesn't match the tables in this version of the
+// program, or if the atlas text file has changed since it was compiled.
+
+flag FLoadAtlasBin()
+{
+  char szPath[cchSzMax];
+  AtlasBinHeader *pabh;
+  pbyte pb;
+  long cb, cbSrc, tmSrc;
+
+  if (FileOpen(DEFAULT_ATLASBIN, 0, szPath) == NULL)
+    return fFalse;
+  pb = PbMapFile(szPath, NULL, &cb);
+  if (pb == NULL)
+    return fFalse;
+  pabh = (AtlasBinHeader *)pb;
+  if (cb < cbAtlasBinHeader || !FEqSz(pabh->szMagic, szAtlasBinMagic) ||
+    pabh->cbEntry != (int)sizeof(AtlasEntry) || pabh->cae <= 0 ||
+    pabh->icnew != icnewMax || pabh->icnus != icnusMax ||
+    pabh->icnca != icncaMax || pabh->izn != iznMax ||
+    pabh->ctri != cAtlasTri || pabh->ciaeTri < 0 ||
+    pabh->ccell != cAtlasCell ||
+    cb != cbAtlasBinHeader + (long)pabh->cae * pabh->cbEntry +
+    (long)(cAtlasTri+1 + pabh->ciaeTri + cAtlasCell+1 + pabh->cae) *
+    (long)sizeof(int) ||
+    (FAtlasSourceStamp(&cbSrc, &tmSrc) &&
+    (cbSrc != pabh->cbSrc || tmSrc != pabh->tmSrc))) {
+    UnmapFile(pb, cb);
+    return fFalse;
+  }
+  FreeAtlas();
+  pbAtlasBin = pb;
+  cbAtlasBin = cb;
+  is.rgae = (AtlasEntry *)(pb + cbAtlasBinHeader);
+  is.cae = pabh->cae;
+  mptriiae = (int *)&is.rgae[is.cae];
+  rgiaeTri = mptriiae + cAtlasTri+1;
+  mpcelliae = rgiaeTri + pabh->ciaeTri;
+  rgiaeCell = mpcelliae + cAtlasCell+1;
+  return fTrue;
+}
+
+
+// Write the current atlas to a compiled binary atlas file, which later runs
+// of the program will use in place of parsing the atlas text file. Implements
+// the -YYc command switch.
+
+flag FWriteAtlasBin(CONST char *szFile)
+{
+  char sz[cchSzMax];
+  AtlasBinHeader abh;
+  AtlasEntry *pae;
+  FILE *file;
+  int cae;
+  flag fRet;
+
+  if (us.fNoWrite)
+    return fFalse;
+  if (!FEnsureAtlas())
+    return fFalse;
+
+  // Don't overwrite a compiled atlas file while it's mapped into memory.
+  if (pbAtlasBin != NULL) {
+    cae = is.cae;
+    pae = RgAllocate(cae, AtlasEntry, "atlas");
+    if (pae == NULL)
+      return fFalse;
+    CopyRgb((pbyte)is.rgae, (pbyte)pae, sizeof(AtlasEntry)*cae);
+    FreeAtlas();
+    is.rgae = pae;
+    is.cae = cae;
+  }
+  if (!FEnsureAtlasIndex())
+    return fFalse;
+
+  ClearB((pbyte)&abh, sizeof(abh));
+  sprintf(abh.szMagic, "%s", szAtlasBinMagic);
+  abh.cbEntry = (int)sizeof(AtlasEntry);
+  abh.cae = is.cae;
+  abh.icnew = icnewMax; abh.icnus = icnusMax; abh.icnca = icncaMax;
+  abh.izn = iznMax;
+  abh.ctri = cAtlasTri;
+  abh.ciaeTri = mptriiae[cAtlasTri];
+  abh.ccell = cAtlasCell;
+  FAtlasSourceStamp(&abh.cbSrc, &abh.tmSrc);
+
+  file = fopen(szFile, "wb");
+  if (file == NULL) {
+    sprintf(sz, "Atlas file '%s' can not be created.", szFile);
+    PrintError(sz);
+    return fFalse;
+  }
+  ClearB((pbyte)sz, cbAtlasBinHeader);
+  CopyRgb((pbyte)&abh, (pbyte)sz, sizeof(abh));
+  fRet = fwrite(sz, cbAtlasBinHeader, 1, file) == 1 &&
+    fwrite(is.rgae, sizeof(AtlasEntry), is.cae, file) == (size_t)is.cae &&
+    fwrite(mptriiae, sizeof(int), cAtlasTri+1, file) == cAtlasTri+1 &&
+    fwrite(rgiaeTri, sizeof(int), abh.ciaeTri, file) == (size_t)abh.ciaeTri &&
+    fwrite(mpcelliae, sizeof(int), cAtlasCell+1, file) == cAtlasCell+1 &&
+    fwrite(rgiaeCell, sizeof(int), is.cae, file) == (size_t)is.cae;
+  fclose(file);
+  if (!fRet) {
+    sprintf(sz, "Atlas file '%s' couldn't be written.", szFile);
+    PrintError(sz);
+  }
+  return fRet;
+}
+
+
 // Load the atlas information file if it hasn't been loaded yet. Return
-// whether loading has succeeded, i.e. whether city list is allocated.
+// whether loading has succeeded, i.e. whether city list is allocated. A
+// compiled atlas is used if one is available, since that loads instantly.
 
 flag FEnsureAtlas()
 {
   if (is.rgae != NULL)
     return fTrue;
+  if (FLoadAtlasBin())
+    return fTrue;
   if (!FProcessSwitchFile(DEFAULT_ATLASFILE, NULL))
     return fFalse;
   return is.rgae != NULL;
@@ -922,11 +1268,7 @@ flag FLoadAtlas(FILE *file, int cae)
 #endif
 
   // Free previous city list if present, and allocate new list.
-  is.cae = 0;
-  if (is.rgae != NULL) {
-    DeallocateP(is.rgae);
-    is.rgae = NULL;
-  }
+  FreeAtlas();
   is.rgae = RgAllocate(cae, AtlasEntry, "atlas");
   if (is.rgae == NULL)
     return fFalse;
@@ -1049,6 +1391,7 @@ flag FLoadZoneRules(FILE *file, int irunMax, int irueMax)
   RuleEntry *prue;
 
   // Free previous rule lists if present, and allocate new lists.
+  FreeZoneTables();
   is.crun = is.crue = 0;
   if (is.rgrun != NULL) {
     DeallocateP(is.rgrun);
@@ -1223,6 +1566,7 @@ flag FLoadZoneChanges(FILE *file, int izcnMax, int izceMax)
   ZoneChange *pzc;
 
   // Free previous zone change entry list if present, and allocate new list.
+  FreeZoneTables();
   is.czcn = is.czce = 0;
   if (is.rgzc != NULL) {
     DeallocateP(is.rgzc);
@@ -1388,6 +1732,7 @@ flag FLoadZoneLinks(FILE *file, int czl)
   int i, iznFrom, iznTo, izn, izc;
 
   // Initialize list to invalid values (clear any previous data).
+  FreeZoneTables();
   for (i = 0; i < iznMax; i++)
     mpznzc[i] = -1;
 
@@ -1476,7 +1821,7 @@ flag DisplayAtlasLookup(CONST char *szIn, size_t lDialog, int *piae)
 {
   AtlasEntry *pae;
   char szCity[cchSzMax], sz[cchSzMax], *pch1, *pch2, *pch;
-  int rgiae[ilistMax], rgn[ilistMax], ilistHi,
+  int rgiae[ilistMax], rgn[ilistMax], ilistHi, *rgiaeCand, ilo, ihi, icand,
     clist = 0, icn, istateUS, istateCA, iae, nPower, i, j, fSav;
   flag fTimezoneChanges;
   real zon;
@@ -1536,8 +1881,28 @@ flag DisplayAtlasLookup(CONST char *szIn, size_t lDialog, int *piae)
       }
   }
 
-  // Loop over all cities in atlas, seeing how well they match input string.
-  for (iae = 0; iae < is.cae; iae++) {
+  // Narrow the search to cities containing the rarest letter triple in the
+  // input string, if it's long enough to have any. Otherwise search all.
+  ilo = 0; ihi = is.cae; rgiaeCand = NULL;
+  if (CchSz(szCity) >= 3 && FEnsureAtlasIndex()) {
+    for (pch = szCity; pch[2]; pch++) {
+      j = ITriFromSz(pch);
+      if (rgiaeCand == NULL || mptriiae[j+1] - mptriiae[j] < ihi - ilo) {
+        ilo = mptriiae[j]; ihi = mptriiae[j+1];
+        rgiaeCand = rgiaeTri;
+      }
+    }
+  }
+
+  // Loop over candidate cities, seeing how well they match input string.
+  for (icand = ilo; icand < ihi; icand++) {
+    if (rgiaeCand != NULL) {
+      // Cities with a triple more than once are in the bucket repeatedly.
+      if (icand > ilo && rgiaeCand[icand] == rgiaeCand[icand-1])
+        continue;
+      iae = rgiaeCand[icand];
+    } else
+      iae = icand;
     pae = &is.rgae[iae];
     nPower = 0;
     if (FEqSzI(szCity, pae->szNam)) {
@@ -1653,11 +2018,12 @@ flag DisplayAtlasNearby(real lon, real lat, size_t lDialog, int *piae,
   flag fAstroGraph)
 {
   AtlasEntry *pae;
+  AtlasBox ab;
   char sz[cchSzMax], *pch;
-  int rgiae[ilistMax], rgn[ilistMax], ilistHi, clist = 0, iae, nDist,
+  int rgiae[ilistMax], rgn[ilistMax], ilistHi, clist, iae, nDist,
     i, j, fSav;
   flag fTimezoneChanges;
-  real rDist, zon;
+  real rCirc, rRad, dLon, rDist, zon;
 #ifdef WIN
   HWND hdlg = (HWND)lDialog;
 #endif
@@ -1666,28 +2032,51 @@ flag DisplayAtlasNearby(real lon, real lat, size_t lDialog, int *piae,
     return fFalse;
   ilistHi = (lDialog != 0 ? *piae : (piae != NULL ? 1 :
     (us.nAtlasList > 0 ? Min(us.nAtlasList, ilistMax) : ilistMax)));
+  rCirc = us.fEuroDist ? 40075.0 : 24901.0;
 
-  // Loop over all cities in atlas, computing their distance to location.
-  for (iae = 0; iae < is.cae; iae++) {
-    pae = &is.rgae[iae];
-    rDist = SphDistance(lon, lat, pae->lon, pae->lat) / 360.0 *
-      (us.fEuroDist ? 40075.0 : 24901.0);
-    nDist = (int)rDist;
-    for (i = 0; i < clist; i++)
-      if (nDist < rgn[i])
-        break;
-    if (i >= ilistHi)
-      continue;
-    // Insert city in list, in order sorted by nearness.
-    if (i < clist)
-      for (j = Min(clist+1, ilistHi-1); j > i; j--) {
-        rgiae[j] = rgiae[j-1];
-        rgn[j] = rgn[j-1];
-      }
-    rgiae[i] = iae;
-    rgn[i] = nDist;
+  // Loop over the cities in a box around the location, large enough to
+  // contain all points within a radius of it, computing their distance to
+  // location. The radius grows until the list is full, and the radius is
+  // beyond any city that could tie with the farthest one in the list.
+  rRad = 1.0;
+  loop {
+    clist = 0;
+    if (rRad >= rDegHalf || RAbs(lat) + rRad >= rDegQuad - 0.001)
+      dLon = rDegHalf;
+    else
+      dLon = RAsinD(RSinD(rRad) / RCosD(lat)) + 0.001;
+    AtlasBoxInit(&ab, lon - dLon, lon + dLon, lat - rRad - 0.001,
+      lat + rRad + 0.001);
+    while ((iae = IaeAtlasBoxNext(&ab)) >= 0) {
+      pae = &is.rgae[iae];
+      rDist = SphDistance(lon, lat, pae->lon, pae->lat) / rDegMax * rCirc;
+      nDist = (int)rDist;
+      for (i = 0; i < clist; i++)
+        if (nDist < rgn[i] || (nDist == rgn[i] && iae < rgiae[i]))
+          break;
+      if (i >= ilistHi)
+        continue;
+      // Insert city in list, in order sorted by nearness, then atlas order.
+      if (i < clist)
+        for (j = Min(clist+1, ilistHi-1); j > i; j--) {
+          rgiae[j] = rgiae[j-1];
+          rgn[j] = rgn[j-1];
+        }
+      rgiae[i] = iae;
+      rgn[i] = nDist;
+      if (clist < ilistHi)
+        clist++;
+    }
+    if (rRad >= rDegHalf || ilistHi <= 0)
+      break;
     if (clist < ilistHi)
-      clist++;
+      rRad = Min(rRad * 2.0, rDegHalf);
+    else {
+      rDist = ((real)rgn[clist-1] + 1.01) / rCirc * rDegMax;
+      if (rRad >= rDist)
+        break;
+      rRad = Min(rDist, rDegHalf);
+    }
   }
 
   // Display header.
@@ -1784,6 +2173,11 @@ void AdjustTime(int *mon, int *day, int *yea, int *tim)
 
 #define ichngMax 4
 #define RTim(tim) ((real)(tim) / 3600.0)
+#define SetZoneEvent(ze, f) \
+  ze.mon = mon; ze.day = day; ze.yea = yea; ze.tim = tim; ze.zon = zon; \
+  ze.doff = doff; ze.monPrev = monPrev; ze.dayPrev = dayPrev; \
+  ze.yeaPrev = yeaPrev; ze.timPrev = timPrev; ze.dstPrev = dstPrev; \
+  ze.zonPrev = zonPrev; ze.doffPrev = doffPrev; ze.fFirst = (f)
 
 // Set the Daylight Time and time zone values in a chart, since the period
 // they apply to has been determined. However, if near the endpoints of the
@@ -1833,6 +2227,176 @@ flag FSetDstZon(CI *ci, int izn,
 }
 
 
+// Tables of all the time zone and Daylight Saving changes within each time
+// zone area, generated once per area when first needed, so determining the
+// values in effect at a chart's time is a binary search. The tables are
+// shared by all threads. Each is generated completely before it's added to
+// rgpzt with the mutex held, and is never changed after that, so it can be
+// read without the mutex. Each thread counts its own lookups. Any table
+// being generated by the current thread is pointed to by pztBuild.
+
+ZoneTable *rgpzt[iznMax];
+TLOCAL int rgcztLookup[iznMax];  // Number of lookups done within each area.
+TLOCAL ZoneTable *pztBuild = NULL;
+#ifdef THREADS
+pthread_mutex_t mutexZoneTable = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+// Free all the time zone change tables, such as when the zone change
+// information they were generated from gets reloaded.
+
+void FreeZoneTables()
+{
+  int izn;
+
+#ifdef THREADS
+  pthread_mutex_lock(&mutexZoneTable);
+#endif
+  for (izn = 0; izn < iznMax; izn++)
+    if (rgpzt[izn] != NULL) {
+      if (rgpzt[izn]->rgze != NULL)
+        DeallocatePCore(rgpzt[izn]->rgze);
+      DeallocatePCore(rgpzt[izn]);
+      rgpzt[izn] = NULL;
+    }
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexZoneTable);
+#endif
+  ClearB((pbyte)rgcztLookup, sizeof(rgcztLookup));
+}
+
+
+// Append a change to the time zone change table being generated.
+
+flag FZoneTableAdd(CONST ZoneEvent *pze)
+{
+  ZoneTable *pzt = pztBuild;
+  ZoneEvent *rgze, *pzePrev;
+  int cze;
+
+  if (pzt->cze >= pzt->czeAlloc) {
+    cze = Max(pzt->czeAlloc * 2, 64);
+    rgze = (ZoneEvent *)PAllocateCore(cze * sizeof(ZoneEvent));
+    if (rgze == NULL)
+      return fFalse;
+    if (pzt->rgze != NULL) {
+      CopyRgb((pbyte)pzt->rgze, (pbyte)rgze, pzt->cze * sizeof(ZoneEvent));
+      DeallocatePCore(pzt->rgze);
+    }
+    pzt->rgze = rgze;
+    pzt->czeAlloc = cze;
+  }
+  if (pzt->cze > 0) {
+    pzePrev = &pzt->rgze[pzt->cze-1];
+    if (pze->yea < pzePrev->yea || (pze->yea == pzePrev->yea &&
+      (pze->mon < pzePrev->mon || (pze->mon == pzePrev->mon &&
+      (pze->day < pzePrev->day || (pze->day == pzePrev->day &&
+      pze->tim < pzePrev->tim))))))
+      pzt->fSorted = fFalse;
+  }
+  pzt->rgze[pzt->cze++] = *pze;
+  return fTrue;
+}
+
+
+// Return the time zone change table for a time zone area, generating it if
+// it hasn't been yet. That's done by running through all changes as if
+// looking up a chart set after all of them, recording each along the way.
+// Return NULL if the table couldn't be generated.
+
+ZoneTable *PztEnsureZone(int izn)
+{
+  ZoneTable *pzt;
+  CI ci;
+  flag fRet;
+
+#ifdef THREADS
+  pthread_mutex_lock(&mutexZoneTable);
+#endif
+  pzt = rgpzt[izn];
+  if (pzt == NULL) {
+    pzt = (ZoneTable *)PAllocateCore(sizeof(ZoneTable));
+    if (pzt != NULL) {
+      ClearB((pbyte)pzt, sizeof(ZoneTable));
+      pzt->fSorted = fTrue;
+      ClearB((pbyte)&ci, sizeof(CI));
+      ci.mon = 1; ci.day = 1; ci.yea = 9999;
+      pztBuild = pzt;
+      fRet = DisplayTimezoneChanges(izn, 0, &ci);
+      pztBuild = NULL;
+      if (fRet)
+        rgpzt[izn] = pzt;
+      else {
+        if (pzt->rgze != NULL)
+          DeallocatePCore(pzt->rgze);
+        DeallocatePCore(pzt);
+        pzt = NULL;
+      }
+    }
+  }
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexZoneTable);
+#endif
+  return pzt;
+}
+
+
+// Return whether a time zone change takes place after a chart's time, in
+// the same way FSetDstZon() checks.
+
+flag FZoneEventAfter(CONST ZoneEvent *pze, CONST CI *ci)
+{
+  return pze->yea > ci->yea || (pze->yea == ci->yea && (pze->mon > ci->mon ||
+    (pze->mon == ci->mon && (pze->day > ci->day ||
+    (pze->day == ci->day && RTim(pze->tim) > ci->tim)))));
+}
+
+
+// Set the time zone and Daylight Time in a chart for its time, by finding
+// the first change after it in the time zone area's table of changes.
+// Return false if the table couldn't be generated.
+
+flag FZoneTableLookup(int izn, CI *ci)
+{
+  ZoneTable *pzt;
+  ZoneEvent *pze;
+  int lo, hi, mid;
+
+  pzt = PztEnsureZone(izn);
+  if (pzt == NULL)
+    return fFalse;
+  if (pzt->fSorted) {
+    lo = 0; hi = pzt->cze;
+    while (lo < hi) {
+      mid = (lo + hi) >> 1;
+      if (FZoneEventAfter(&pzt->rgze[mid], ci))
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+  } else
+    for (lo = 0; lo < pzt->cze && !FZoneEventAfter(&pzt->rgze[lo], ci); lo++)
+      ;
+
+  // If ci date after all time zones are defined, then go with final values.
+  if (lo >= pzt->cze) {
+    ci->dst = RTim(pzt->dst); ci->zon = RTim(pzt->zon);
+    return fTrue;
+  }
+  // If ci date before any time zones were defined, then default to LMT.
+  pze = &pzt->rgze[lo];
+  if (pze->fFirst) {
+    ci->dst = 0.0; ci->zon = zonLMT;
+    return fTrue;
+  }
+  FSetDstZon(ci, izn, pze->mon, pze->day, pze->yea, pze->tim, pze->zon,
+    pze->doff, pze->monPrev, pze->dayPrev, pze->yeaPrev, pze->timPrev,
+    pze->dstPrev, pze->zonPrev, pze->doffPrev);
+  return fTrue;
+}
+
+
 // Given a time zone area, display a list of time zone and Daylight Saving
 // time changes within it. Display it in text or within a Windows dialog.
 // Implements the -Nz switch. Can also do the important task of determining
@@ -1848,12 +2412,20 @@ flag DisplayTimezoneChanges(int iznIn, size_t lDialog, CI *ci)
     iyea, yea2, irue, crue, cn, ici, idMon, dd, i, j, k;
   ZoneChange *pzc, *pzc2;
   RuleEntry *pru;
+  ZoneEvent ze;
 #ifdef WIN
   HWND hdlg = (HWND)lDialog;
 #endif
 
   if (!FEnsureTimezoneChanges())
     return fFalse;
+  // Determining values for a chart is done with the area's table of changes.
+  // The table is only generated on the second lookup within an area, since
+  // a single lookup is faster to do directly below. If the table can't be
+  // generated, the values are determined directly below too.
+  if (ci != NULL && lDialog == 0 && iznIn >= 0 && pztBuild == NULL &&
+    ++rgcztLookup[iznIn] > 1 && FZoneTableLookup(iznIn, ci))
+    return fTrue;
 
   // Loop over all possible time zone areas, or just the one specified.
   if (lDialog == 0 && iznIn < 0) {
@@ -1913,6 +2485,12 @@ flag DisplayTimezoneChanges(int iznIn, size_t lDialog, CI *ci)
       goto LSkip;
     cn++;
     if (ci != NULL && lDialog == 0) {
+      if (pztBuild != NULL) {
+        SetZoneEvent(ze, cn <= 1);
+        if (!FZoneTableAdd(&ze))
+          return fFalse;
+        goto LSkip;
+      }
       // If ci set, then just set correct time zone and Daylight offset.
       // If ci date before any time zones were defined, then default to LMT.
       if (cn <= 1 && (yea > ci->yea || (yea == ci->yea && (mon > ci->mon ||
@@ -2052,6 +2630,12 @@ LSkip:
         AdjustTime(&mon, &day, &yea, &tim);
         doff = offPrev - off;
         if (ci != NULL && lDialog == 0) {
+          if (pztBuild != NULL) {
+            SetZoneEvent(ze, fFalse);
+            if (!FZoneTableAdd(&ze))
+              return fFalse;
+            continue;
+          }
           // If ci set, then just set correct time zone and Daylight offset.
           if (FSetDstZon(ci, izn, mon, day, yea, tim, zon, doff,
             monPrev, dayPrev, yeaPrev, timPrev, dstPrev, zonPrev, doffPrev))
@@ -2093,7 +2677,11 @@ LSkip:
 
   // If ci date after all time zones are defined, then go with final values.
   if (ci != NULL && lDialog == 0) {
-    ci->dst = RTim(dst); ci->zon = RTim(zon);
+    if (pztBuild != NULL) {
+      pztBuild->dst = dst; pztBuild->zon = zon;
+    } else {
+      ci->dst = RTim(dst); ci->zon = RTim(zon);
+    }
   }
   return fTrue;
 }
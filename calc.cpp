@@ -912,6 +912,306 @@ void ProcessPlanet(int ind, real aber)
 
 
 #ifdef EPHEM
+// Bounded cache of object positions computed by the ephemeris, so searches
+// and relationship charts which ask for the same object at the same time
+// more than once only compute it once. Each thread has its own cache, with
+// the least recently used position thrown out when it's full. The whole
+// cache is thrown out whenever a setting affecting positions changes.
+// Values which change with time are part of each position's key instead.
+
+typedef struct _PosCacheSig {
+  real rOffset;     // -s and -Ys zodiac offsets
+  real rOffsetAll;
+  real rDeltaT;     // -Yz0
+  real lon, lat, elv;  // Location, used with -YV
+  int nSwissEph;
+  flag fPlacalcPla, fPlacalcAst, fSidereal, fSidereal2, fTruePos, fTopoPos,
+    fBarycenter, fTrueNode, fNoNutation, fParallel;
+} PCS;
+
+typedef struct _PosCacheEntry {
+  real jd;          // Time position is for
+  int ind;          // Object
+  int indCent;      // Central object
+  flag fSwiss;      // Whether computed by Swiss Ephemeris instead of Placalc
+  real rSid, rOB;   // Sidereal offset and obliquity, which vary with time
+  int rgnCust[4];   // Ephemeris mapping of custom objects, which -Ye changes
+  real rgr[6];      // Longitude, latitude, speed, distance, and other speeds
+  int iPrev, iNext; // Neighbors in list from most to least recently used
+  int iChain;       // Next entry in the same hash bucket
+} PCE;
+
+typedef struct _PosCache {
+  PCE *rgpce;       // The entries
+  int *rgiBucket;   // First entry in each hash bucket
+  int cpce;         // Number of entries in use
+  int cpceMax;      // Room for entries
+  int cBucket;      // Number of hash buckets, a power of two
+  int iHead, iTail; // Most and least recently used entries
+  PCS pcs;          // Settings positions in the cache were computed with
+  long cHit, cMiss; // Statistics since the program started
+} PC;
+
+TLOCAL PC pc;
+long cPosCacheHit = 0, cPosCacheMiss = 0;
+#ifdef THREADS
+pthread_mutex_t mutexPosCache = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+// Return the hash bucket of an object at a time.
+
+int IPosCacheHash(real jd, int ind, int indCent)
+{
+  dword dw[2], h;
+
+  CopyRgb((pbyte)&jd, (pbyte)dw, sizeof(dw));
+  h = dw[0] ^ (dw[1] * 0x9E3779B1) ^ ((dword)ind << 8) ^ (dword)indCent;
+  h ^= h >> 15; h *= 0x2C1B3C6D; h ^= h >> 12;
+  return (int)(h & (dword)(pc.cBucket - 1));
+}
+
+
+// Empty the current thread's position cache, freeing it if it's resized or
+// turned off. Statistics are kept.
+
+void PosCacheClear(void)
+{
+  int i;
+
+  if (pc.rgpce != NULL && pc.cpceMax != us.nPosCache) {
+    DeallocateP(pc.rgpce);
+    DeallocateP(pc.rgiBucket);
+    pc.rgpce = NULL;
+    pc.rgiBucket = NULL;
+  }
+  pc.cpce = 0;
+  pc.iHead = pc.iTail = -1;
+  if (pc.rgiBucket != NULL)
+    for (i = 0; i < pc.cBucket; i++)
+      pc.rgiBucket[i] = -1;
+}
+
+
+// Make sure the position cache is allocated and matches the current
+// settings, clearing it if not. Called once per chart cast, since settings
+// can't change while one is being cast. Return false if the cache is off.
+
+flag FPosCacheEnsure(void)
+{
+  PCS pcs;
+  pbyte pb1, pb2;
+  int i;
+
+  if (us.nPosCache <= 0) {
+    if (pc.rgpce != NULL)
+      PosCacheClear();
+    return fFalse;
+  }
+  ClearB((pbyte)&pcs, sizeof(PCS));
+  pcs.rOffset = us.rZodiacOffset; pcs.rOffsetAll = us.rZodiacOffsetAll;
+  pcs.rDeltaT = us.rDeltaT;
+  if (us.fTopoPos) {
+    pcs.lon = OO; pcs.lat = AA; pcs.elv = us.elvDef;
+  }
+  pcs.nSwissEph = us.nSwissEph;
+  pcs.fPlacalcPla = us.fPlacalcPla; pcs.fPlacalcAst = us.fPlacalcAst;
+  pcs.fSidereal = us.fSidereal; pcs.fSidereal2 = us.fSidereal2;
+  pcs.fTruePos = us.fTruePos; pcs.fTopoPos = us.fTopoPos;
+  pcs.fBarycenter = us.fBarycenter; pcs.fTrueNode = us.fTrueNode;
+  pcs.fNoNutation = us.fNoNutation; pcs.fParallel = us.fParallel;
+  if (pc.rgpce == NULL || pc.cpceMax != us.nPosCache) {
+    PosCacheClear();
+    pc.cpceMax = us.nPosCache;
+    for (pc.cBucket = 1; pc.cBucket < pc.cpceMax; pc.cBucket <<= 1)
+      ;
+    pc.rgpce = RgAllocate(pc.cpceMax, PCE, "position cache");
+    pc.rgiBucket = RgAllocate(pc.cBucket, int, "position cache");
+    if (pc.rgpce == NULL || pc.rgiBucket == NULL) {
+      if (pc.rgpce != NULL)
+        DeallocateP(pc.rgpce);
+      if (pc.rgiBucket != NULL)
+        DeallocateP(pc.rgiBucket);
+      pc.rgpce = NULL; pc.rgiBucket = NULL;
+      us.nPosCache = 0;
+      return fFalse;
+    }
+    for (i = 0; i < pc.cBucket; i++)
+      pc.rgiBucket[i] = -1;
+    pc.pcs = pcs;
+  } else {
+    pb1 = (pbyte)&pcs; pb2 = (pbyte)&pc.pcs;
+    for (i = 0; i < (int)sizeof(PCS) && pb1[i] == pb2[i]; i++)
+      ;
+    if (i < (int)sizeof(PCS)) {
+      PosCacheClear();
+      pc.pcs = pcs;
+    }
+  }
+  return fTrue;
+}
+
+
+// Unlink an entry from the list of entries ordered by when last used.
+
+void PosCacheUnlink(int i)
+{
+  PCE *pce = &pc.rgpce[i];
+
+  if (pce->iPrev >= 0)
+    pc.rgpce[pce->iPrev].iNext = pce->iNext;
+  else
+    pc.iHead = pce->iNext;
+  if (pce->iNext >= 0)
+    pc.rgpce[pce->iNext].iPrev = pce->iPrev;
+  else
+    pc.iTail = pce->iPrev;
+}
+
+
+// Link an entry to the front of the list, as the most recently used.
+
+void PosCacheLinkHead(int i)
+{
+  PCE *pce = &pc.rgpce[i];
+
+  pce->iPrev = -1;
+  pce->iNext = pc.iHead;
+  if (pc.iHead >= 0)
+    pc.rgpce[pc.iHead].iPrev = i;
+  pc.iHead = i;
+  if (pc.iTail < 0)
+    pc.iTail = i;
+}
+
+
+// Fill out what an object is mapped to in the ephemeris, if it's a custom
+// object whose meaning can be redefined. Return false if the object's
+// position shouldn't be cached at all.
+
+flag FPosCacheCust(int ind, int *rgn)
+{
+  rgn[0] = rgn[1] = rgn[2] = rgn[3] = 0;
+#ifdef SWISS
+  if (FCust(ind)) {
+    ind -= custLo;
+    rgn[0] = rgObjSwiss[ind]; rgn[1] = rgTypSwiss[ind];
+    rgn[2] = rgPntSwiss[ind]; rgn[3] = rgFlgSwiss[ind];
+
+    // Flag 32 makes just this object topocentric, but location is only part
+    // of the cache settings when -YV is on for all objects.
+    if ((rgn[3] & 32) && !us.fTopoPos)
+      return fFalse;
+  }
+#endif
+  return fTrue;
+}
+
+
+// Look up an object's position at a time in the position cache, which
+// FPosCacheEnsure() should have readied for this cast. Return false if it
+// isn't there, in which case it needs to be computed.
+
+flag FPosCacheGet(int ind, real jd, int indCent, flag fSwiss, real *rgr)
+{
+  int rgn[4], i;
+  PCE *pce;
+
+  if (pc.rgpce == NULL || !FPosCacheCust(ind, rgn))
+    return fFalse;
+  for (i = pc.rgiBucket[IPosCacheHash(jd, ind, indCent)]; i >= 0;
+    i = pce->iChain) {
+    pce = &pc.rgpce[i];
+    if (pce->jd == jd && pce->ind == ind && pce->indCent == indCent &&
+      pce->fSwiss == fSwiss && pce->rSid == is.rSid && pce->rOB == is.OB &&
+      pce->rgnCust[0] == rgn[0] && pce->rgnCust[1] == rgn[1] &&
+      pce->rgnCust[2] == rgn[2] && pce->rgnCust[3] == rgn[3]) {
+      CopyRgb((pbyte)pce->rgr, (pbyte)rgr, sizeof(pce->rgr));
+      if (pc.iHead != i) {
+        PosCacheUnlink(i);
+        PosCacheLinkHead(i);
+      }
+      pc.cHit++;
+      return fTrue;
+    }
+  }
+  pc.cMiss++;
+  return fFalse;
+}
+
+
+// Add a newly computed position to the position cache, throwing out the
+// least recently used position if the cache is full.
+
+void PosCacheSet(int ind, real jd, int indCent, flag fSwiss, CONST real *rgr)
+{
+  int rgn[4], i, j, *pi;
+  PCE *pce;
+
+  if (pc.rgpce == NULL || !FPosCacheCust(ind, rgn))
+    return;
+  if (pc.cpce < pc.cpceMax)
+    i = pc.cpce++;
+  else {
+    i = pc.iTail;
+    PosCacheUnlink(i);
+    pce = &pc.rgpce[i];
+    for (pi = &pc.rgiBucket[IPosCacheHash(pce->jd, pce->ind,
+      pce->indCent)]; *pi != i; pi = &pc.rgpce[*pi].iChain)
+      ;
+    *pi = pce->iChain;
+  }
+  pce = &pc.rgpce[i];
+  pce->jd = jd; pce->ind = ind; pce->indCent = indCent;
+  pce->fSwiss = fSwiss; pce->rSid = is.rSid; pce->rOB = is.OB;
+  CopyRgb((pbyte)rgn, (pbyte)pce->rgnCust, sizeof(pce->rgnCust));
+  CopyRgb((pbyte)rgr, (pbyte)pce->rgr, sizeof(pce->rgr));
+  j = IPosCacheHash(jd, ind, indCent);
+  pce->iChain = pc.rgiBucket[j];
+  pc.rgiBucket[j] = i;
+  PosCacheLinkHead(i);
+}
+
+
+// Free the current thread's position cache, and add its statistics to the
+// totals for the program. Called as each thread finishes.
+
+void PosCacheClose(void)
+{
+  if (pc.rgpce != NULL) {
+    DeallocateP(pc.rgpce);
+    DeallocateP(pc.rgiBucket);
+    pc.rgpce = NULL; pc.rgiBucket = NULL;
+  }
+#ifdef THREADS
+  pthread_mutex_lock(&mutexPosCache);
+#endif
+  cPosCacheHit += pc.cHit; cPosCacheMiss += pc.cMiss;
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexPosCache);
+#endif
+  pc.cHit = pc.cMiss = 0;
+}
+
+
+// Print how many positions were found in the position cache over the run of
+// the program, to help decide how large the cache should be.
+
+void PrintPosCacheStats(void)
+{
+  char sz[cchSzMax];
+  long cTotal;
+
+  PosCacheClose();
+  cTotal = cPosCacheHit + cPosCacheMiss;
+  if (cTotal <= 0)
+    return;
+  sprintf(sz, "Position cache of %d: %ld hits, %ld misses (%.1f%% hit rate).",
+    us.nPosCache, cPosCacheHit, cPosCacheMiss,
+    (real)cPosCacheHit * 100.0 / (real)cTotal);
+  PrintNotice(sz);
+}
+
+
 #ifdef JPLWEB
 CONST int rgObjJPL[cThing+1] = {0/*399*/, 10, 301,
   199, 299, 499, 599, 699, 799, 899, 999, nMillion + 2060,
@@ -931,8 +1231,8 @@ CONST int rgObjJPL[cThing+1] = {0/*399*/, 10, 301,
 void ComputeEphem(real t)
 {
   int objCentCalc, objOrbit, imax, i, j;
-  real r1, r2, r3, r4, r5, r6, dist1, dist2, objPla, altPla, objEar, altEar,
-    rT;
+  real jd, r1, r2, r3, r4, r5, r6, rgr[6], dist1, dist2, objPla, altPla,
+    objEar, altEar, rT;
   flag fSwiss = !us.fPlacalcPla, fJPLPla, fJPL, fRet;
   PT3R ptPla, ptEar, vEar;
 #ifdef JPLWEB
@@ -949,6 +1249,11 @@ void ComputeEphem(real t)
     FJPL(FCust(objCentCalc) && rgTypSwiss[objCentCalc - custLo] == 4))
     objCentCalc = oSun;
 
+  // All objects are computed for the same moment, so Swiss Ephemeris can
+  // share the Earth's position, nutation, and precession between them.
+
+  jd = JulianDayFromTime(t);
+  FPosCacheEnsure();
   imax = Min(oNorm, is.nObj); imax = Max(imax, oSun);
   for (i = oEar; i <= imax; i++) {
     if ((ignore[i] && i > oMoo && (i != oNod || ignore[oSou])) ||
@@ -976,20 +1281,34 @@ void ComputeEphem(real t)
     } else
 #endif
     {
+      objOrbit = objCentCalc;
 #ifdef SWISS
       if (fSwiss) {
         objOrbit = us.fMoonMove ? ObjOrbit(i) : -1;
         if (objOrbit < 0 || objOrbit == oSun)
           objOrbit = objCentCalc;
-        fRet = FSwissPlanet(i, JulianDayFromTime(t), objOrbit,
-          &r1, &r2, &r3, &r4, &r5, &r6);
       }
+#endif
+      if (FPosCacheGet(i, jd, objOrbit, fSwiss, rgr)) {
+        r1 = rgr[0]; r2 = rgr[1]; r3 = rgr[2];
+        r4 = rgr[3]; r5 = rgr[4]; r6 = rgr[5];
+        fRet = fTrue;
+      } else {
+#ifdef SWISS
+        if (fSwiss)
+          fRet = FSwissPlanet(i, jd, objOrbit, &r1, &r2, &r3, &r4, &r5, &r6);
 #endif
 #ifdef PLACALC
-      if (!fSwiss)
-        fRet = FPlacalcPlanet(i, JulianDayFromTime(t), objCentCalc != oEar,
-          &r1, &r2, &r3, &r4, &r5, &r6);
+        if (!fSwiss)
+          fRet = FPlacalcPlanet(i, jd, objCentCalc != oEar,
+            &r1, &r2, &r3, &r4, &r5, &r6);
 #endif
+        if (fRet) {
+          rgr[0] = r1; rgr[1] = r2; rgr[2] = r3;
+          rgr[3] = r4; rgr[4] = r5; rgr[5] = r6;
+          PosCacheSet(i, jd, objOrbit, fSwiss, rgr);
+        }
+      }
     }
     if (!fRet)
       continue;
@@ -1154,183 +1473,473 @@ void ComputeEphem(real t)
 #endif
 
 
-// This is probably the main routine in all of Astrolog. It generates a chart,
-// calculating the positions of all the celestial bodies and house cusps,
-// based on the current chart information, and saves them for use by any of
-// the display routines.
+// Persistent cache of cast charts, as enabled with -5c. Charts cast for the
+// chart list are saved to a file along with the settings they were cast
+// with, so later runs over the same chart list with the same settings can
+// load each chart's positions instead of casting it again. The file is
+// memory mapped, and holds records sorted by a hash of each chart's info.
+// Charts cast during this run are kept in memory until the program exits,
+// when they're merged with the ones in the file and the file is rewritten.
+
+#define szCastMagic "AstCast"
+
+typedef struct _CastCacheSig {
+  int nObj, objCenter, nHouseSystem, nHouse3D, nSwissEph, nDwad, objOnAsc,
+    objRot1, objRot2, nArabicNight;
+  flag fSidereal, fSidereal2, fHouse3D, fEquator, fEquator2, fDecan, fFlip,
+    fGeodetic, fNavamsa, fEphemFiles, fPlacalcAst, fPlacalcPla, fMatrixPla,
+    fTruePos, fTopoPos, fRefract, fBarycenter, fMoonMove, fTrueNode,
+    fNoNutation, fHouseAngle, fPolarAsc, fObjRotWhole, fSolarWhole,
+    fVelocity, fSectorApprox, fDst;
+  real rZodiacOffset, rZodiacOffsetAll, rDeltaT, rHarmonic, rCuspAddition,
+    rObjAddition, elvDef, tmpDef;
+  byte ignore[objMax];
+  real force[objMax];
+  int rgnCust[cCust][4];
+} CCS;
+
+typedef struct _CastCacheEntry {
+  dword hash;            // Hash of the chart info, which records sort by
+  int mon, day, yea;     // Chart info the chart was cast for
+  real tim, dst, zon, lon, lat;
+  real JD, T, Tp, MC, Asc, RA, Vtx, EP, OB, rOff, rNut, rSid;
+  int nHouseSystem;      // Values CastChart() leaves in the is structure
+} CCE;                   // Followed by positions of each object in chart
+
+typedef struct _CastCacheFile {
+  char szMagic[8];       // File type and version
+  int cbSig, cbRec, cobj;
+  long crec;             // Number of records, followed by settings, then them
+} CCF;
+
+typedef struct _CastCache {
+  flag fSig;             // Whether settings charts are cached with are known
+  CCS ccs;               // Settings charts in the cache were cast with
+  int cobj;              // Number of objects saved for each chart
+  int cbRec;             // Size of each record in bytes
+  pbyte pbFile;          // Contents of the cache file mapped into memory
+  long cbFile;
+  CONST byte *rgrecFile; // Records in the file, sorted by hash
+  long crecFile;
+  pbyte rgrecNew;        // Records for charts cast during this run
+  int crecNew, crecNewMax;
+  int *rgiBucket;        // First new record in each hash bucket
+  int *rgiChain;         // Next new record in the same hash bucket
+} CCA;
+
+CCA cca;
+#ifdef THREADS
+pthread_mutex_t mutexCastCache = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
-real CastChart(int nContext)
+#define PcceFile(i) ((CCE *)(cca.rgrecFile + (long)(i) * cca.cbRec))
+#define PcceNew(i)  ((CCE *)(cca.rgrecNew + (long)(i) * cca.cbRec))
+
+// Return the hash of the parts of a chart's info which affect its positions.
+
+dword CastCacheHash(CONST CI *pci)
 {
-  CI ciSav;
-  real housetemp[cSign+1], r, r2;
-  int i, k, k2;
+  int rgn[3];
+  real rgr[5];
+  dword hash = 2166136261u;
+  int i;
 
-  is.nContext = nContext;
-#ifdef EXPRESS
-  // Notify AstroExpression a chart is about to be cast.
-  if (!us.fExpOff && FSzSet(us.szExpCast1))
-    ParseExpression(us.szExpCast1);
-#endif
+  rgn[0] = pci->mon; rgn[1] = pci->day; rgn[2] = pci->yea;
+  rgr[0] = pci->tim; rgr[1] = pci->dst; rgr[2] = pci->zon;
+  rgr[3] = pci->lon; rgr[4] = pci->lat;
+  for (i = 0; i < (int)sizeof(rgn); i++)
+    hash = (hash ^ ((pbyte)rgn)[i]) * 16777619u;
+  for (i = 0; i < (int)sizeof(rgr); i++)
+    hash = (hash ^ ((pbyte)rgr)[i]) * 16777619u;
+  return hash;
+}
 
-  // Hack: If month is negative, then know chart was read in through a -o0
-  // position file, so planet positions are already in the arrays.
 
-  if (FNoTimeOrSpace(ciCore)) {
-    is.MC = planet[oMC]; is.Asc = planet[oAsc];
-    ComputeInHouses();
-    return 0.0;
+// Return whether a record in the cache is for the given chart info.
+
+flag FCastCacheMatch(CONST CCE *pcce, dword hash, CONST CI *pci)
+{
+  return pcce->hash == hash && pcce->mon == pci->mon &&
+    pcce->day == pci->day && pcce->yea == pci->yea && pcce->tim == pci->tim &&
+    pcce->dst == pci->dst && pcce->zon == pci->zon && pcce->lon == pci->lon &&
+    pcce->lat == pci->lat;
+}
+
+
+// Copy the positions of the current chart to or from a cache record.
+
+void CastCacheCopy(pbyte pb, flag fSave)
+{
+  CCE *pcce = (CCE *)pb;
+  pbyte rgpb[10];
+  int rgcb[10], cobj = cca.cobj, i;
+
+  if (fSave) {
+    pcce->JD = is.JD; pcce->T = is.T; pcce->Tp = is.Tp; pcce->MC = is.MC;
+    pcce->Asc = is.Asc; pcce->RA = is.RA; pcce->Vtx = is.Vtx;
+    pcce->EP = is.EP; pcce->OB = is.OB; pcce->rOff = is.rOff;
+    pcce->rNut = is.rNut; pcce->rSid = is.rSid;
+    pcce->nHouseSystem = is.nHouseSystem;
+  } else {
+    is.JD = pcce->JD; is.T = pcce->T; is.Tp = pcce->Tp; is.MC = pcce->MC;
+    is.Asc = pcce->Asc; is.RA = pcce->RA; is.Vtx = pcce->Vtx;
+    is.EP = pcce->EP; is.OB = pcce->OB; is.rOff = pcce->rOff;
+    is.rNut = pcce->rNut; is.rSid = pcce->rSid;
+    is.nHouseSystem = pcce->nHouseSystem;
+  }
+  rgpb[0] = (pbyte)cp0.obj;    rgcb[0] = cobj * sizeof(real);
+  rgpb[1] = (pbyte)cp0.alt;    rgcb[1] = cobj * sizeof(real);
+  rgpb[2] = (pbyte)cp0.dir;    rgcb[2] = cobj * sizeof(real);
+  rgpb[3] = (pbyte)cp0.diralt; rgcb[3] = cobj * sizeof(real);
+  rgpb[4] = (pbyte)cp0.dirlen; rgcb[4] = cobj * sizeof(real);
+  rgpb[5] = (pbyte)cp0.dist;   rgcb[5] = cobj * sizeof(real);
+  rgpb[6] = (pbyte)cp0.pt;     rgcb[6] = cobj * sizeof(PT3R);
+  rgpb[7] = (pbyte)cp0.cusp;   rgcb[7] = sizeof(cp0.cusp);
+  rgpb[8] = (pbyte)cp0.cusp3;  rgcb[8] = sizeof(cp0.cusp3);
+  rgpb[9] = (pbyte)cp0.house;  rgcb[9] = cobj * sizeof(int);
+  pb += sizeof(CCE);
+  for (i = 0; i < 10; i++) {
+    if (fSave)
+      CopyRgb(rgpb[i], pb, rgcb[i]);
+    else
+      CopyRgb(pb, rgpb[i], rgcb[i]);
+    pb += rgcb[i];
   }
+  if (fSave)
+    *(real *)pb = cp0.lonMC;
+  else
+    cp0.lonMC = *(real *)pb;
+}
 
-  // Hack: Time zone 24 means to have the time of day be in Local Mean Time
-  // (LMT). This is done by making the time zone value reflect the logical
-  // offset from UTC as indicated by the chart's longitude value.
 
-  ciSav = ciCore;
-  is.JD = (real)MdyToJulian(MM, DD, YY);
-  if (ZZ == zonLMT)
-    ZZ = OO / 15.0;
-  else if (ZZ == zonLAT)
-    ZZ = OO / 15.0 - SwissLatLmt(is.JD);
-  if (SS == dstAuto)
-    SS = (real)is.fDst;
-  TT = RSgn(TT)*RFloor(RAbs(TT))+RFract(RAbs(TT)) + (ZZ - SS);
-  AA = Min(AA, rDegQuad-rSmall);     // Make sure chart isn't being cast on
-  AA = Max(AA, -(rDegQuad-rSmall));  // precise North or South Pole.
+// Map the cache file into memory, if it exists and contains charts cast
+// with the current settings.
 
-  ClearB((pbyte)&cp0, sizeof(CP));     // On ecliptic unless say otherwise.
-  ClearB((pbyte)space, sizeof(space));
+void CastCacheOpen(void)
+{
+  CONST CCF *pccf;
 
-  is.T = (is.JD + TT/24.0) + (us.rCuspAddition/24.0);
-  if (us.fProgress && us.nProgress != ptSolarArc) {
+  cca.pbFile = PbMapFile(us.szListCache, NULL, &cca.cbFile);
+  if (cca.pbFile == NULL)
+    return;
+  pccf = (CONST CCF *)cca.pbFile;
+  if (cca.cbFile < (long)(sizeof(CCF) + sizeof(CCS)) ||
+    !FEqSz(pccf->szMagic, szCastMagic) || pccf->cbSig != (int)sizeof(CCS) ||
+    pccf->cbRec != cca.cbRec || pccf->cobj != cca.cobj || pccf->crec < 0 ||
+    cca.cbFile != (long)(sizeof(CCF) + sizeof(CCS)) + pccf->crec*cca.cbRec ||
+    memcmp(cca.pbFile + sizeof(CCF), &cca.ccs, sizeof(CCS)) != 0)
+    return;
+  cca.rgrecFile = cca.pbFile + sizeof(CCF) + sizeof(CCS);
+  cca.crecFile = pccf->crec;
+}
 
-    // For ptCast, is.Tp is time that progressed chart cusps cast for.
-    // For ptMixed, is.Tp is base chart time to solar arc cusps from.
-    is.Tp = is.T;
-    if (us.nProgress == ptCast)
-      is.Tp += ((is.JDp - is.Tp) / (us.rProgDay * us.rProgCusp));
-    is.Tp = (is.Tp - 2415020.5) / 36525.0;
 
-    // Determine actual time that a progressed chart is to be cast for.
-    is.T += ((is.JDp - is.T) / us.rProgDay);
+// Return whether the chart about to be cast can use the chart cache, which
+// is when -5c is set, and the current settings are the ones the cache has
+// charts for. The first time, the cache is set up for the current settings.
+
+flag FCastCacheEnsure(void)
+{
+  CCS ccs;
+  int i;
+  flag f;
 
+  if (!FSzSet(us.szListCache) || us.fStar || FStar(us.objCenter) ||
+    us.fProgress)
+    return fFalse;
 #ifdef EXPRESS
-    // Adjust progression times with AstroExpressions.
-    if (!us.fExpOff && FSzSet(us.szExpProg)) {
-      ExpSetR(iLetterX, is.JDp);
-      ExpSetR(iLetterY, is.Tp);
-      ExpSetR(iLetterZ, is.T);
-      ParseExpression(us.szExpProg);
-      is.Tp = RExpGet(iLetterY);
-      is.T  = RExpGet(iLetterZ);
-    }
+  // AstroExpressions can change positions or have side effects.
+  if (!us.fExpOff && (FSzSet(us.szExpCast1) || FSzSet(us.szExpCast2) ||
+    FSzSet(us.szExpObj) || FSzSet(us.szExpHou) || FSzSet(us.szExpSort)))
+    return fFalse;
 #endif
-  }
-  is.T -= ((us.rCuspAddition - us.rObjAddition) / 24.0);
-  is.T = (is.T - 2415020.5) / 36525.0;
-
-  // Go calculate house cusp and angle positions.
 
+  ClearB((pbyte)&ccs, sizeof(CCS));
+  ccs.nObj = is.nObj; ccs.objCenter = us.objCenter;
+  ccs.nHouseSystem = us.nHouseSystem; ccs.nHouse3D = us.nHouse3D;
+  ccs.nSwissEph = us.nSwissEph; ccs.nDwad = us.nDwad;
+  ccs.objOnAsc = us.objOnAsc; ccs.objRot1 = us.objRot1;
+  ccs.objRot2 = us.objRot2; ccs.nArabicNight = us.nArabicNight;
+  ccs.fSidereal = us.fSidereal; ccs.fSidereal2 = us.fSidereal2;
+  ccs.fHouse3D = us.fHouse3D; ccs.fEquator = us.fEquator;
+  ccs.fEquator2 = us.fEquator2; ccs.fDecan = us.fDecan;
+  ccs.fFlip = us.fFlip; ccs.fGeodetic = us.fGeodetic;
+  ccs.fNavamsa = us.fNavamsa; ccs.fEphemFiles = us.fEphemFiles;
+  ccs.fPlacalcAst = us.fPlacalcAst; ccs.fPlacalcPla = us.fPlacalcPla;
+  ccs.fMatrixPla = us.fMatrixPla; ccs.fTruePos = us.fTruePos;
+  ccs.fTopoPos = us.fTopoPos; ccs.fRefract = us.fRefract;
+  ccs.fBarycenter = us.fBarycenter; ccs.fMoonMove = us.fMoonMove;
+  ccs.fTrueNode = us.fTrueNode; ccs.fNoNutation = us.fNoNutation;
+  ccs.fHouseAngle = us.fHouseAngle; ccs.fPolarAsc = us.fPolarAsc;
+  ccs.fObjRotWhole = us.fObjRotWhole; ccs.fSolarWhole = us.fSolarWhole;
+  ccs.fVelocity = us.fVelocity; ccs.fSectorApprox = us.fSectorApprox;
+  ccs.fDst = is.fDst;
+  ccs.rZodiacOffset = us.rZodiacOffset;
+  ccs.rZodiacOffsetAll = us.rZodiacOffsetAll; ccs.rDeltaT = us.rDeltaT;
+  ccs.rHarmonic = us.rHarmonic; ccs.rCuspAddition = us.rCuspAddition;
+  ccs.rObjAddition = us.rObjAddition; ccs.elvDef = us.elvDef;
+  ccs.tmpDef = us.tmpDef;
+  CopyRgb(ignore, ccs.ignore, sizeof(ignore));
+  CopyRgb((pbyte)force, (pbyte)ccs.force, sizeof(force));
 #ifdef SWISS
-  if (FCmSwissAny()) {
-    SwissHouse(us.fProgress && us.nProgress != ptSolarArc ? is.Tp : is.T,
-      OO, AA, us.nHouseSystem,
-      &is.Asc, &is.MC, &is.RA, &is.Vtx, &is.EP, &is.OB, &is.rOff, &is.rNut);
-  } else
+  for (i = 0; i < cCust; i++) {
+    ccs.rgnCust[i][0] = rgObjSwiss[i]; ccs.rgnCust[i][1] = rgTypSwiss[i];
+    ccs.rgnCust[i][2] = rgPntSwiss[i]; ccs.rgnCust[i][3] = rgFlgSwiss[i];
+  }
 #endif
-  {
-#ifdef MATRIX
-    is.rOff = ProcessInput();
-    ComputeVariables(&is.Vtx);
-    if (us.fGeodetic)                // Check for -G geodetic chart.
-      is.RA = Mod(-OO);
-    is.MC  = CuspMidheaven();        // Calculate Ascendant & Midheaven.
-    is.Asc = CuspAscendant();
-    is.EP  = CuspEastPoint();
-    ComputeHouses(us.nHouseSystem);  // Go calculate house cusps.
+
+#ifdef THREADS
+  pthread_mutex_lock(&mutexCastCache);
 #endif
+  if (!cca.fSig) {
+    cca.ccs = ccs;
+    cca.fSig = fTrue;
+    cca.cobj = Max(is.nObj, cuspHi) + 1;
+    i = sizeof(CCE) + cca.cobj * (sizeof(real)*6 + sizeof(PT3R) +
+      sizeof(int)) + sizeof(cp0.cusp) + sizeof(cp0.cusp3) + sizeof(real);
+    cca.cbRec = (i + sizeof(real) - 1) / sizeof(real) * sizeof(real);
+    CastCacheOpen();
   }
-  // This value (often same as is.RA) is frequently used, so compute once.
-  cp0.lonMC = Tropical(is.MC); r = 0.0;
-  EclToEqu(&cp0.lonMC, &r);
+  f = memcmp(&ccs, &cca.ccs, sizeof(CCS)) == 0;
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexCastCache);
+#endif
+  return f;
+}
 
-#ifdef MATRIX
-  // Go calculate planet, Moon, and North Node positions.
 
-  if (FCmMatrix() || (FCmPlacalc() && us.fUranian)) {
-    ComputePlanets();
-    if (!ignore[oMoo] || !ignore[oNod] || !ignore[oSou] || !ignore[oFor]) {
-      ComputeLunar(&planet[oMoo], &planetalt[oMoo],
-        &planet[oNod], &planetalt[oNod]);
-      ret[oNod] = -1.0;
-    }
+// Look up a chart in the chart cache, and if it's there, load its positions
+// as if it had just been cast. Return false if it needs to be cast.
+
+flag FCastCacheGet(CONST CI *pci)
+{
+  dword hash = CastCacheHash(pci);
+  long lo = 0, hi = cca.crecFile - 1, mid;
+  CCE *pcce = NULL;
+  int i;
+
+  // Binary search the records in the file, which don't change.
+  while (lo < hi) {
+    mid = (lo + hi) >> 1;
+    if (PcceFile(mid)->hash < hash)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
+  for (; lo < cca.crecFile && PcceFile(lo)->hash == hash; lo++)
+    if (FCastCacheMatch(PcceFile(lo), hash, pci)) {
+      ClearB((pbyte)&cp0, sizeof(CP));
+      CastCacheCopy((pbyte)PcceFile(lo), fFalse);
+      SortPlanets();
+      return fTrue;
+    }
+
+  // Check the records for charts cast earlier in this run.
+#ifdef THREADS
+  pthread_mutex_lock(&mutexCastCache);
+#endif
+  if (cca.crecNew > 0)
+    for (i = cca.rgiBucket[hash & (cca.crecNewMax-1)]; i >= 0;
+      i = cca.rgiChain[i])
+      if (FCastCacheMatch(PcceNew(i), hash, pci)) {
+        pcce = PcceNew(i);
+        ClearB((pbyte)&cp0, sizeof(CP));
+        CastCacheCopy((pbyte)pcce, fFalse);
+        break;
+      }
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexCastCache);
 #endif
+  if (pcce != NULL)
+    SortPlanets();
+  return pcce != NULL;
+}
 
-  // Go calculate star positions if -U switch in effect.
 
-  if (us.fStar || FStar(us.objCenter))
-    ComputeStars(is.T, (us.fSidereal ? us.rZodiacOffset : -is.rOff) +
-      us.rZodiacOffsetAll);
+// Add the chart just cast to the chart cache.
 
-#ifdef EPHEM
-  // Compute more accurate ephemeris positions for certain objects.
+void CastCacheSet(CONST CI *pci)
+{
+  CCE *pcce;
+  pbyte pb;
+  int *rgi, cMax, i;
+  dword hash = CastCacheHash(pci);
 
-  if (us.fEphemFiles)
-    ComputeEphem(is.T);
+#ifdef THREADS
+  pthread_mutex_lock(&mutexCastCache);
 #endif
+  // Grow the records, and their hash table, by doubling when full.
+  if (cca.crecNew >= cca.crecNewMax) {
+    cMax = Max(cca.crecNewMax * 2, 256);
+    // These may be freed by another thread, so aren't counted as
+    // allocations of this thread.
+    pb = (pbyte)PAllocateCore((long)cMax * cca.cbRec);
+    rgi = (int *)PAllocateCore(cMax * 2 * sizeof(int));
+    if (pb == NULL || rgi == NULL) {
+      if (pb != NULL)
+        DeallocatePCore(pb);
+      if (rgi != NULL)
+        DeallocatePCore(rgi);
+      goto LDone;
+    }
+    if (cca.rgrecNew != NULL) {
+      CopyRgb(cca.rgrecNew, pb, cca.crecNew * cca.cbRec);
+      DeallocatePCore(cca.rgrecNew);
+      DeallocatePCore(cca.rgiBucket);
+    }
+    cca.rgrecNew = pb;
+    cca.rgiBucket = rgi; cca.rgiChain = rgi + cMax;
+    cca.crecNewMax = cMax;
+    for (i = 0; i < cMax; i++)
+      cca.rgiBucket[i] = -1;
+    for (i = 0; i < cca.crecNew; i++) {
+      pcce = PcceNew(i);
+      cca.rgiChain[i] = cca.rgiBucket[pcce->hash & (cMax-1)];
+      cca.rgiBucket[pcce->hash & (cMax-1)] = i;
+    }
+  }
+  pcce = PcceNew(cca.crecNew);
+  ClearB((pbyte)pcce, cca.cbRec);
+  pcce->hash = hash;
+  pcce->mon = pci->mon; pcce->day = pci->day; pcce->yea = pci->yea;
+  pcce->tim = pci->tim; pcce->dst = pci->dst; pcce->zon = pci->zon;
+  pcce->lon = pci->lon; pcce->lat = pci->lat;
+  CastCacheCopy((pbyte)pcce, fTrue);
+  cca.rgiChain[cca.crecNew] = cca.rgiBucket[hash & (cca.crecNewMax-1)];
+  cca.rgiBucket[hash & (cca.crecNewMax-1)] = cca.crecNew;
+  cca.crecNew++;
+LDone:
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexCastCache);
+#endif
+  return;
+}
 
-  // Certain objects are positioned directly opposite to other objects.
 
-  i = (us.objCenter != oSun ? oSun : oEar);
-  planet[us.objCenter] = Mod(planet[i] + rDegHalf);
-  planetalt[us.objCenter] = -planetalt[i];
-  ret[us.objCenter] = ret[i];
-  retalt[us.objCenter] = -retalt[i];
-  if (!us.fEphemFiles) {
-    planet[oSou] = Mod(planet[oNod] + rDegHalf);
-    if (!us.fVelocity) {
-      ret[oNod] = ret[oSou] = -0.053;
-      ret[oMoo] = 12.2;
-    } else
-      ret[oNod] = ret[oSou] = ret[oMoo] = 1.0;
-  }
+// Save any charts cast during this run to the chart cache file, merged with
+// the ones already there, then free the cache. Called when program exits.
 
-  // Calculate position of Part of Fortune.
+void CastCacheClose(void)
+{
+  char sz[cchSzMax];
+  FILE *file;
+  CCF ccf;
+  int *rgi = NULL, gap, i, j, k;
+  long iFile = 0;
+  dword hash;
+
+  if (cca.crecNew > 0 && !us.fNoWrite) {
+    // Sort the new records by hash, with a Shell sort over their indexes.
+    rgi = RgAllocate(cca.crecNew, int, "chart cache");
+    if (rgi == NULL)
+      goto LDone;
+    for (i = 0; i < cca.crecNew; i++)
+      rgi[i] = i;
+    for (gap = 1; gap < cca.crecNew / 3; gap = gap*3 + 1)
+      ;
+    for (; gap > 0; gap /= 3)
+      for (i = gap; i < cca.crecNew; i++) {
+        k = rgi[i];
+        hash = PcceNew(k)->hash;
+        for (j = i; j >= gap && PcceNew(rgi[j - gap])->hash > hash; j -= gap)
+          rgi[j] = rgi[j - gap];
+        rgi[j] = k;
+      }
 
-  if (!ignore[oFor]) {
-    r = MinDifference(planet[oSun], planet[oMoo]);
-    r2 = ret[oMoo] - ret[oSun];
-    planetalt[oFor] = us.fHouse3D ? planetalt[oMoo] - planetalt[oSun] : 0.0;
-    retalt[oFor] = us.fHouse3D ? retalt[oMoo] - retalt[oSun] : 0.0;
-    // Invert formula for night charts. Note since planet positions are still
-    // being computed, house placements haven't been determined yet.
-    i = us.nHouseSystem; us.nHouseSystem = hsCampanus;
-    if (us.nArabicNight < 0 || (us.nArabicNight == 0 &&
-      NHousePlaceIn(planet[oSun], planetalt[oSun]) < sLib)) {
-      neg(r); neg(r2);
-      neg(planetalt[oFor]); neg(retalt[oFor]);
+    // Write to a temporary file, since the old file may still be mapped.
+    sprintf(sz, "%s.tmp", us.szListCache);
+    file = fopen(sz, "wb");
+    if (file == NULL) {
+      PrintWarning("Couldn't create chart cache file.");
+      goto LDone;
     }
-    us.nHouseSystem = i;
-    planet[oFor] = Mod(r + is.Asc);
-    ret[oFor] += r2;                 // Already contains ret[oAsc].
+    ClearB((pbyte)&ccf, sizeof(CCF));
+    sprintf(ccf.szMagic, "%s", szCastMagic);
+    ccf.cbSig = sizeof(CCS); ccf.cbRec = cca.cbRec; ccf.cobj = cca.cobj;
+    ccf.crec = cca.crecFile + cca.crecNew;
+    fwrite(&ccf, sizeof(CCF), 1, file);
+    fwrite(&cca.ccs, sizeof(CCS), 1, file);
+    for (i = 0; i < cca.crecNew; i++) {
+      hash = PcceNew(rgi[i])->hash;
+      for (; iFile < cca.crecFile && PcceFile(iFile)->hash <= hash; iFile++)
+        fwrite(PcceFile(iFile), cca.cbRec, 1, file);
+      fwrite(PcceNew(rgi[i]), cca.cbRec, 1, file);
+    }
+    for (; iFile < cca.crecFile; iFile++)
+      fwrite(PcceFile(iFile), cca.cbRec, 1, file);
+    i = ferror(file);
+    fclose(file);
+    if (cca.pbFile != NULL) {
+      UnmapFile(cca.pbFile, cca.cbFile);
+      cca.pbFile = NULL;
+    }
+    remove(us.szListCache);
+    if (i != 0 || rename(sz, us.szListCache) != 0)
+      PrintWarning("Couldn't write chart cache file.");
   }
 
-  // Fill in "planet" positions corresponding to house cusps.
-
-  planet[oVtx] = is.Vtx; planet[oEP] = is.EP;
-  for (i = 1; i <= cSign; i++)
-    planet[cuspLo + i - 1] = chouse[i];
-  if (!us.fHouseAngle) {
-    planet[oAsc] = is.Asc; planet[oMC] = is.MC;
-    planet[oDes] = Mod(is.Asc + rDegHalf);
-    planet[oNad] = Mod(is.MC + rDegHalf);
-  }
-  for (i = oFor; i <= cuspHi; i++) {
-    r = FCmSwissAny() ? ret[i] : (rDegMax + 1.0);
-    if (us.fVelocity)
-      r /= (rDegMax + 1.0);
-    ret[i] = r;
+LDone:
+  if (rgi != NULL)
+    DeallocateP(rgi);
+  if (cca.pbFile != NULL)
+    UnmapFile(cca.pbFile, cca.cbFile);
+  if (cca.rgrecNew != NULL) {
+    DeallocatePCore(cca.rgrecNew);
+    DeallocatePCore(cca.rgiBucket);
   }
+  ClearB((pbyte)&cca, sizeof(CCA));
+}
+
+
+// Set up the time and location of the current chart for casting it: Set
+// is.JD, resolve the time zone and Daylight Time settings, adjust the time
+// to UTC, and keep the latitude off the poles. Also clear the positions of
+// the chart about to be cast. This changes ciCore, which the caller should
+// restore after casting.
+
+void SetCastTime(void)
+{
+  is.JD = (real)MdyToJulian(MM, DD, YY);
+  if (ZZ == zonLMT)
+    ZZ = OO / 15.0;
+  else if (ZZ == zonLAT)
+    ZZ = OO / 15.0 - SwissLatLmt(is.JD);
+  if (SS == dstAuto)
+    SS = (real)is.fDst;
+  TT = RSgn(TT)*RFloor(RAbs(TT))+RFract(RAbs(TT)) + (ZZ - SS);
+  AA = Min(AA, rDegQuad-rSmall);     // Make sure chart isn't being cast on
+  AA = Max(AA, -(rDegQuad-rSmall));  // precise North or South Pole.
+
+  ClearB((pbyte)&cp0, sizeof(CP));     // On ecliptic unless say otherwise.
+  ClearB((pbyte)space, sizeof(space));
+}
+
+
+// Return whether the chart settings modify object positions after they've
+// been computed, such that CastChart() needs to call AdjustPositions().
+
+flag FAdjustPositions(void)
+{
+  int i;
+
+  if (us.fEquator || us.fEquator2 || us.fProgress || us.rHarmonic != 1.0 ||
+    us.objRot1 != us.objRot2 || us.fObjRotWhole || us.objOnAsc ||
+    us.fFlip || us.fDecan || us.nDwad > 0 || us.fNavamsa)
+    return fTrue;
+  for (i = 0; i <= is.nObj; i++)
+    if (force[i] != 0.0)
+      return fTrue;
+  return fFalse;
+}
+
+
+// Modify the base positions calculated for a chart based on what type of
+// chart is being generated, as part of casting it.
+
+void AdjustPositions(void)
+{
+  real housetemp[cSign+1], r, r2;
+  int i, k, k2;
 
   // Transform ecliptic to equatorial coordinates if -sr in effect.
 
@@ -1414,54 +2023,238 @@ real CastChart(int nContext)
       }
     }
 
-  // If -1 or -2 solar chart in effect, then rotate the houses accordingly.
+  // If -1 or -2 solar chart in effect, then rotate the houses accordingly.
+
+  if (us.objOnAsc) {
+    r = planet[NAbs(us.objOnAsc)-1];
+    if (us.fSolarWhole)
+      r = (real)((SFromZ(r)-1)*30);
+    r -= (us.objOnAsc > 0 ? is.Asc : is.MC);
+    for (i = 1; i <= cSign; i++)
+      chouse[i] = Mod(chouse[i] + r + rSmall);
+  }
+
+  // If -f domal chart switch in effect, switch planet and house positions.
+
+  if (us.fFlip) {
+    ComputeInHouses();
+    for (i = 0; i <= is.nObj; i++) {
+      k = inhouse[i];
+      inhouse[i] = SFromZ(planet[i]);
+      planet[i] = ZFromS(k)+MinDistance(chouse[k], planet[i]) /
+        MinDistance(chouse[k], chouse[Mod12(k+1)])*30.0;
+    }
+    for (i = 1; i <= cSign; i++) {
+      k = NHousePlaceIn2D(ZFromS(i));
+      housetemp[i] = ZFromS(k)+MinDistance(chouse[k], ZFromS(i)) /
+        MinDistance(chouse[k], chouse[Mod12(k+1)])*30.0;
+    }
+    for (i = 1; i <= cSign; i++)
+      chouse[i] = housetemp[i];
+  }
+
+  // If -3 decan chart switch in effect, edit planet positions accordingly.
+
+  if (us.fDecan)
+    for (i = 0; i <= is.nObj; i++)
+      planet[i] = Decan(planet[i]);
+
+  // If -4 dwad chart switch in effect, edit planet positions accordingly.
+
+  if (us.nDwad > 0)
+    for (k = 0; k < us.nDwad; k++)
+      for (i = 0; i <= is.nObj; i++)
+        planet[i] = Dwad(planet[i]);
+
+  // If -9 navamsa chart switch in effect, edit planet positions accordingly.
+
+  if (us.fNavamsa)
+    for (i = 0; i <= is.nObj; i++)
+      planet[i] = Navamsa(planet[i]);
+}
+
+
+// This is probably the main routine in all of Astrolog. It generates a chart,
+// calculating the positions of all the celestial bodies and house cusps,
+// based on the current chart information, and saves them for use by any of
+// the display routines.
+
+real CastChart(int nContext)
+{
+  CI ciSav;
+  real r, r2;
+  int i, k;
+  flag fCache;
+#ifdef EXPRESS
+  flag fInvariant;
+#endif
+
+  is.nContext = nContext;
+#ifdef EXPRESS
+  // Notify AstroExpression a chart is about to be cast.
+  if (!us.fExpOff && FSzSet(us.szExpCast1))
+    ParseExpression(us.szExpCast1);
+#endif
+
+  // Hack: If month is negative, then know chart was read in through a -o0
+  // position file, so planet positions are already in the arrays.
+
+  if (FNoTimeOrSpace(ciCore)) {
+    is.MC = planet[oMC]; is.Asc = planet[oAsc];
+    ComputeInHouses();
+    return 0.0;
+  }
+
+  // Hack: Time zone 24 means to have the time of day be in Local Mean Time
+  // (LMT). This is done by making the time zone value reflect the logical
+  // offset from UTC as indicated by the chart's longitude value.
+
+  // If the chart was cast before with the same settings, as saved in the -5c
+  // chart cache, then just load its positions.
+
+  fCache = is.fCastList && nContext > 0 && FCastCacheEnsure();
+  if (fCache && FCastCacheGet(&ciCore))
+    return is.T;
+
+  ciSav = ciCore;
+  SetCastTime();
+  is.T = (is.JD + TT/24.0) + (us.rCuspAddition/24.0);
+  if (us.fProgress && us.nProgress != ptSolarArc) {
+
+    // For ptCast, is.Tp is time that progressed chart cusps cast for.
+    // For ptMixed, is.Tp is base chart time to solar arc cusps from.
+    is.Tp = is.T;
+    if (us.nProgress == ptCast)
+      is.Tp += ((is.JDp - is.Tp) / (us.rProgDay * us.rProgCusp));
+    is.Tp = (is.Tp - 2415020.5) / 36525.0;
+
+    // Determine actual time that a progressed chart is to be cast for.
+    is.T += ((is.JDp - is.T) / us.rProgDay);
+
+#ifdef EXPRESS
+    // Adjust progression times with AstroExpressions.
+    if (!us.fExpOff && FSzSet(us.szExpProg)) {
+      ExpSetR(iLetterX, is.JDp);
+      ExpSetR(iLetterY, is.Tp);
+      ExpSetR(iLetterZ, is.T);
+      ParseExpression(us.szExpProg);
+      is.Tp = RExpGet(iLetterY);
+      is.T  = RExpGet(iLetterZ);
+    }
+#endif
+  }
+  is.T -= ((us.rCuspAddition - us.rObjAddition) / 24.0);
+  is.T = (is.T - 2415020.5) / 36525.0;
+
+  // Go calculate house cusp and angle positions.
+
+#ifdef SWISS
+  if (FCmSwissAny()) {
+    SwissHouse(us.fProgress && us.nProgress != ptSolarArc ? is.Tp : is.T,
+      OO, AA, us.nHouseSystem,
+      &is.Asc, &is.MC, &is.RA, &is.Vtx, &is.EP, &is.OB, &is.rOff, &is.rNut);
+  } else
+#endif
+  {
+#ifdef MATRIX
+    is.rOff = ProcessInput();
+    ComputeVariables(&is.Vtx);
+    if (us.fGeodetic)                // Check for -G geodetic chart.
+      is.RA = Mod(-OO);
+    is.MC  = CuspMidheaven();        // Calculate Ascendant & Midheaven.
+    is.Asc = CuspAscendant();
+    is.EP  = CuspEastPoint();
+    ComputeHouses(us.nHouseSystem);  // Go calculate house cusps.
+#endif
+  }
+  // This value (often same as is.RA) is frequently used, so compute once.
+  cp0.lonMC = Tropical(is.MC); r = 0.0;
+  EclToEqu(&cp0.lonMC, &r);
+
+#ifdef MATRIX
+  // Go calculate planet, Moon, and North Node positions.
+
+  if (FCmMatrix() || (FCmPlacalc() && us.fUranian)) {
+    ComputePlanets();
+    if (!ignore[oMoo] || !ignore[oNod] || !ignore[oSou] || !ignore[oFor]) {
+      ComputeLunar(&planet[oMoo], &planetalt[oMoo],
+        &planet[oNod], &planetalt[oNod]);
+      ret[oNod] = -1.0;
+    }
+  }
+#endif
+
+  // Go calculate star positions if -U switch in effect.
+
+  if (us.fStar || FStar(us.objCenter))
+    ComputeStars(is.T, (us.fSidereal ? us.rZodiacOffset : -is.rOff) +
+      us.rZodiacOffsetAll);
+
+#ifdef EPHEM
+  // Compute more accurate ephemeris positions for certain objects.
+
+  if (us.fEphemFiles)
+    ComputeEphem(is.T);
+#endif
+
+  // Certain objects are positioned directly opposite to other objects.
 
-  if (us.objOnAsc) {
-    r = planet[NAbs(us.objOnAsc)-1];
-    if (us.fSolarWhole)
-      r = (real)((SFromZ(r)-1)*30);
-    r -= (us.objOnAsc > 0 ? is.Asc : is.MC);
-    for (i = 1; i <= cSign; i++)
-      chouse[i] = Mod(chouse[i] + r + rSmall);
+  i = (us.objCenter != oSun ? oSun : oEar);
+  planet[us.objCenter] = Mod(planet[i] + rDegHalf);
+  planetalt[us.objCenter] = -planetalt[i];
+  ret[us.objCenter] = ret[i];
+  retalt[us.objCenter] = -retalt[i];
+  if (!us.fEphemFiles) {
+    planet[oSou] = Mod(planet[oNod] + rDegHalf);
+    if (!us.fVelocity) {
+      ret[oNod] = ret[oSou] = -0.053;
+      ret[oMoo] = 12.2;
+    } else
+      ret[oNod] = ret[oSou] = ret[oMoo] = 1.0;
   }
 
-  // If -f domal chart switch in effect, switch planet and house positions.
+  // Calculate position of Part of Fortune.
 
-  if (us.fFlip) {
-    ComputeInHouses();
-    for (i = 0; i <= is.nObj; i++) {
-      k = inhouse[i];
-      inhouse[i] = SFromZ(planet[i]);
-      planet[i] = ZFromS(k)+MinDistance(chouse[k], planet[i]) /
-        MinDistance(chouse[k], chouse[Mod12(k+1)])*30.0;
-    }
-    for (i = 1; i <= cSign; i++) {
-      k = NHousePlaceIn2D(ZFromS(i));
-      housetemp[i] = ZFromS(k)+MinDistance(chouse[k], ZFromS(i)) /
-        MinDistance(chouse[k], chouse[Mod12(k+1)])*30.0;
+  if (!ignore[oFor]) {
+    r = MinDifference(planet[oSun], planet[oMoo]);
+    r2 = ret[oMoo] - ret[oSun];
+    planetalt[oFor] = us.fHouse3D ? planetalt[oMoo] - planetalt[oSun] : 0.0;
+    retalt[oFor] = us.fHouse3D ? retalt[oMoo] - retalt[oSun] : 0.0;
+    // Invert formula for night charts. Note since planet positions are still
+    // being computed, house placements haven't been determined yet.
+    i = us.nHouseSystem; us.nHouseSystem = hsCampanus;
+    if (us.nArabicNight < 0 || (us.nArabicNight == 0 &&
+      NHousePlaceIn(planet[oSun], planetalt[oSun]) < sLib)) {
+      neg(r); neg(r2);
+      neg(planetalt[oFor]); neg(retalt[oFor]);
     }
-    for (i = 1; i <= cSign; i++)
-      chouse[i] = housetemp[i];
+    us.nHouseSystem = i;
+    planet[oFor] = Mod(r + is.Asc);
+    ret[oFor] += r2;                 // Already contains ret[oAsc].
   }
 
-  // If -3 decan chart switch in effect, edit planet positions accordingly.
-
-  if (us.fDecan)
-    for (i = 0; i <= is.nObj; i++)
-      planet[i] = Decan(planet[i]);
-
-  // If -4 dwad chart switch in effect, edit planet positions accordingly.
+  // Fill in "planet" positions corresponding to house cusps.
 
-  if (us.nDwad > 0)
-    for (k = 0; k < us.nDwad; k++)
-      for (i = 0; i <= is.nObj; i++)
-        planet[i] = Dwad(planet[i]);
+  planet[oVtx] = is.Vtx; planet[oEP] = is.EP;
+  for (i = 1; i <= cSign; i++)
+    planet[cuspLo + i - 1] = chouse[i];
+  if (!us.fHouseAngle) {
+    planet[oAsc] = is.Asc; planet[oMC] = is.MC;
+    planet[oDes] = Mod(is.Asc + rDegHalf);
+    planet[oNad] = Mod(is.MC + rDegHalf);
+  }
+  for (i = oFor; i <= cuspHi; i++) {
+    r = FCmSwissAny() ? ret[i] : (rDegMax + 1.0);
+    if (us.fVelocity)
+      r /= (rDegMax + 1.0);
+    ret[i] = r;
+  }
 
-  // If -9 navamsa chart switch in effect, edit planet positions accordingly.
+  // Modify the base positions calculated above based on what type of chart
+  // is being generated, e.g. equatorial, progressed, harmonic, or domal.
 
-  if (us.fNavamsa)
-    for (i = 0; i <= is.nObj; i++)
-      planet[i] = Navamsa(planet[i]);
+  if (FAdjustPositions())
+    AdjustPositions();
 
   // Sort planet and star positions now that all positions are finalized.
 
@@ -1471,10 +2264,13 @@ real CastChart(int nContext)
   SortPlanets();
 
 #ifdef EXPRESS
-  // Adjust final planet and house positions with AstroExpressions.
+  // Adjust final planet and house positions with AstroExpressions. Ones that
+  // always return the same constant can't change anything so aren't run, but
+  // their @V-@Z variables are still set, since other expressions may use them.
 
   if (!us.fExpOff) {
     if (FSzSet(us.szExpObj)) {
+      fInvariant = FExpInvariant(us.szExpObj);
       k = Max(is.nObj, o12h);
       for (i = 0; i <= k; i++) if (!ignore[i] || FCusp(i)) {
         ExpSetN(iLetterV, i);
@@ -1482,6 +2278,8 @@ real CastChart(int nContext)
         ExpSetR(iLetterX, planetalt[i]);
         ExpSetR(iLetterY, ret[i]);
         ExpSetR(iLetterZ, retalt[i]);
+        if (fInvariant)
+          continue;
         ParseExpression(us.szExpObj);
         planet[i]    = Mod(RExpGet(iLetterW));
         planetalt[i] = RExpGet(iLetterX);
@@ -1491,15 +2289,19 @@ real CastChart(int nContext)
         retalt[i]    = RExpGet(iLetterZ);
       }
     }
-    if (FSzSet(us.szExpHou))
+    if (FSzSet(us.szExpHou)) {
+      fInvariant = FExpInvariant(us.szExpHou);
       for (i = 1; i <= cSign; i++) {
         ExpSetN(iLetterX, i);
         ExpSetR(iLetterY, chouse[i]);
         ExpSetR(iLetterZ, chouse3[i]);
+        if (fInvariant)
+          continue;
         ParseExpression(us.szExpHou);
         chouse[i]  = Mod(RExpGet(iLetterY));
         chouse3[i] = Mod(RExpGet(iLetterZ));
       }
+    }
   }
 #endif
 
@@ -1509,11 +2311,57 @@ real CastChart(int nContext)
   if (!us.fExpOff && FSzSet(us.szExpCast2))
     ParseExpression(us.szExpCast2);
 #endif
+  if (fCache)
+    CastCacheSet(&ciSav);
   ciCore = ciSav;
   return is.T;
 }
 
 
+// Like CastChart(), but only compute the positions of unrestricted objects
+// that come from the ephemeris, skipping houses, stars, and everything done
+// to positions afterward. This is for quickly moving a couple of objects
+// many times, e.g. when solving for the exact time of an aspect. Return
+// false if the settings adjust positions in ways that need a full cast.
+
+flag FCastObjectsOnly(void)
+{
+  CI ciSav;
+  real r;
+  int i;
+
+  if (!FCmSwissAny() || FNoTimeOrSpace(ciCore) || FAdjustPositions())
+    return fFalse;
+#ifdef EXPRESS
+  if (!us.fExpOff && (FSzSet(us.szExpCast1) || FSzSet(us.szExpCast2) ||
+    FSzSet(us.szExpObj)))
+    return fFalse;
+#endif
+  for (i = 0; i <= is.nObj; i++)
+    if (!ignore[i] && (!FThing(i) || i > oNorm))
+      return fFalse;
+
+  ciSav = ciCore;
+  SetCastTime();
+  is.T = (is.JD + TT/24.0) + (us.rObjAddition/24.0);
+  is.T = (is.T - 2415020.5) / 36525.0;
+
+  // SwissHouse() also gets the obliquity and sidereal offset objects need.
+  SwissHouse(is.T, OO, AA, us.nHouseSystem,
+    &is.Asc, &is.MC, &is.RA, &is.Vtx, &is.EP, &is.OB, &is.rOff, &is.rNut);
+  cp0.lonMC = Tropical(is.MC); r = 0.0;
+  EclToEqu(&cp0.lonMC, &r);
+  ComputeEphem(is.T);
+  i = (us.objCenter != oSun ? oSun : oEar);
+  planet[us.objCenter] = Mod(planet[i] + rDegHalf);
+  planetalt[us.objCenter] = -planetalt[i];
+  ret[us.objCenter] = ret[i];
+  retalt[us.objCenter] = -retalt[i];
+  ciCore = ciSav;
+  return fTrue;
+}
+
+
 // Calculate the position of each planet with respect to the Gauquelin
 // sectors. This is used by the sector charts. Fill out the planet position
 // array where one degree means 1/10 the way across one of the 36 sectors.
@@ -1656,6 +2504,194 @@ LRetry:
 }
 
 
+/*
+******************************************************************************
+** Chart Context Routines.
+******************************************************************************
+*/
+
+// Point the chart ring lookup tables at the current thread's own chart info
+// and positions. When compiled with threads, each thread has its own copy of
+// all the chart globals, so every thread needs to call this once first.
+
+void InitChartContext(void)
+{
+  rgpci[0] = &ciCore; rgpci[1] = &ciMain; rgpci[2] = &ciTwin;
+  rgpci[3] = &ciThre; rgpci[4] = &ciFour; rgpci[5] = &ciFive;
+  rgpci[6] = &ciHexa;
+  rgpcp[0] = &cp0; rgpcp[1] = &cp1; rgpcp[2] = &cp2;
+  rgpcp[3] = &cp3; rgpcp[4] = &cp4; rgpcp[5] = &cp5;
+  rgpcp[6] = &cp6;
+}
+
+
+// Save the current thread's chart context, which is everything a chart cast
+// reads or writes: The settings, the chart info, and resulting positions.
+
+void SaveChartContext(CC *pcc)
+{
+  int i;
+
+  pcc->us = us;
+  pcc->is = is;
+  for (i = 0; i <= cRing; i++) {
+    pcc->rgci[i] = *rgpci[i];
+    pcc->rgcp[i] = *rgpcp[i];
+  }
+  pcc->ciTran = ciTran;
+  pcc->ciSave = ciSave;
+  CopyRgb((pbyte)ignore,  (pbyte)pcc->ignore,  sizeof(ignore));
+  CopyRgb((pbyte)ignore2, (pbyte)pcc->ignore2, sizeof(ignore2));
+  CopyRgb((pbyte)rgobjList,  (pbyte)pcc->rgobjList,  sizeof(rgobjList));
+  CopyRgb((pbyte)rgobjList2, (pbyte)pcc->rgobjList2, sizeof(rgobjList2));
+  CopyRgb((pbyte)kObjA, (pbyte)pcc->kObjA, sizeof(kObjA));
+  CopyRgb((pbyte)rStarBright, (pbyte)pcc->rStarBright, sizeof(rStarBright));
+  CopyRgb((pbyte)ignore7, (pbyte)pcc->ignore7, sizeof(ignore7));
+}
+
+
+// Make a chart context current for this thread. After this, CastChart(),
+// ComputeEphem(), ComputeHouses(), and ComputeInHouses() all work against
+// the context, independently of charts being cast by any other threads.
+
+void LoadChartContext(CONST CC *pcc)
+{
+  int i;
+
+  us = pcc->us;
+  is = pcc->is;
+  for (i = 0; i <= cRing; i++) {
+    *rgpci[i] = pcc->rgci[i];
+    *rgpcp[i] = pcc->rgcp[i];
+  }
+  ciTran = pcc->ciTran;
+  ciSave = pcc->ciSave;
+  CopyRgb((pbyte)pcc->ignore,  (pbyte)ignore,  sizeof(ignore));
+  CopyRgb((pbyte)pcc->ignore2, (pbyte)ignore2, sizeof(ignore2));
+  CopyRgb((pbyte)pcc->rgobjList,  (pbyte)rgobjList,  sizeof(rgobjList));
+  CopyRgb((pbyte)pcc->rgobjList2, (pbyte)rgobjList2, sizeof(rgobjList2));
+  CopyRgb((pbyte)pcc->kObjA, (pbyte)kObjA, sizeof(kObjA));
+  CopyRgb((pbyte)pcc->rStarBright, (pbyte)rStarBright, sizeof(rStarBright));
+  CopyRgb((pbyte)pcc->ignore7, (pbyte)ignore7, sizeof(ignore7));
+}
+
+
+// Return how many threads charts may be cast on at once. Only the Swiss
+// Ephemeris keeps its state per thread, and AstroExpressions share their
+// variables, so anything else means charts have to be cast one at a time.
+
+int NThreadCount(void)
+{
+#ifdef THREADS
+  char **ppch;
+  int n;
+
+  if (!FCmSwissAny() || FCmJPLWeb())
+    return 1;
+  if (!us.fExpOff)
+    for (ppch = &us.szExpConfig; ppch <= &us.szExpADB; ppch++)
+      if (FSzSet(*ppch))
+        return 1;
+  n = us.nThreads;
+  if (n <= 0)
+    n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  return Max(n, 1);
+#else
+  return 1;
+#endif
+}
+
+
+#ifdef THREADS
+typedef struct _ThreadJobs {
+  void (*pfn)(int, void *);  // Routine to call for each job.
+  void *pv;                  // Data passed along to the routine.
+  int cjob;                  // Total number of jobs.
+  int ijob;                  // Next job to be handed out.
+  CONST CC *pcc;             // Chart context of the starting thread.
+  pthread_mutex_t mutex;     // Guards handing out of jobs.
+} TJ;
+
+// The main routine for each worker thread. Copy over the context of the
+// thread that started the jobs, then keep taking jobs until none are left.
+
+void *PvThreadJobs(void *pv)
+{
+  TJ *ptj = (TJ *)pv;
+  int ijob;
+
+  InitChartContext();
+  LoadChartContext(ptj->pcc);
+  is.fSwissPathSet = fFalse;  // Swiss Ephemeris state is per thread.
+  loop {
+    pthread_mutex_lock(&ptj->mutex);
+    ijob = ptj->ijob++;
+    pthread_mutex_unlock(&ptj->mutex);
+    if (ijob >= ptj->cjob)
+      break;
+    (*ptj->pfn)(ijob, ptj->pv);
+  }
+  if (grid != NULL) {
+    DeallocateP(grid);
+    grid = NULL;
+  }
+  GridRelationClose();
+#ifdef EPHEM
+  PosCacheClose();
+#endif
+  SwissClose();
+  return NULL;
+}
+#endif
+
+
+// Run a number of independent jobs, spread over as many threads as
+// NThreadCount() allows. Each job gets its own index, and each worker thread
+// starts with a copy of the calling thread's chart context. Doesn't return
+// until all jobs are done. Jobs are just run in order if no threads.
+
+void RunThreadJobs(int cjob, void (*pfn)(int, void *), void *pv)
+{
+#ifdef THREADS
+  pthread_t *rgth = NULL;
+  CC *pcc = NULL;
+  TJ tj;
+  int cth, ith = 0, cthRun = 0;
+#endif
+  int ijob;
+
+#ifdef THREADS
+  cth = Min(NThreadCount(), cjob);
+  if (cth > 1) {
+    rgth = RgAllocate(cth, pthread_t, "threads");
+    if (rgth != NULL)
+      pcc = RgAllocate(1, CC, "chart context");
+    if (pcc != NULL) {
+      SaveChartContext(pcc);
+      tj.pfn = pfn; tj.pv = pv; tj.cjob = cjob; tj.ijob = 0; tj.pcc = pcc;
+      pthread_mutex_init(&tj.mutex, NULL);
+      for (ith = 0; ith < cth; ith++)
+        if (pthread_create(&rgth[ith], NULL, PvThreadJobs, &tj) != 0)
+          break;
+      // If not all threads could be created, the ones that were will still
+      // keep going until every job is done.
+      cthRun = ith;
+      while (ith > 0)
+        pthread_join(rgth[--ith], NULL);
+      pthread_mutex_destroy(&tj.mutex);
+      DeallocateP(pcc);
+    }
+    if (rgth != NULL)
+      DeallocateP(rgth);
+    if (cthRun > 0)
+      return;
+  }
+#endif
+  for (ijob = 0; ijob < cjob; ijob++)
+    (*pfn)(ijob, pv);
+}
+
+
 /*
 ******************************************************************************
 ** Aspect Calculations.
@@ -1786,7 +2822,7 @@ int GetAspect(CONST real *planet1, CONST real *planet2,
 
 #ifdef EXPRESS
     // Adjust orb with AstroExpression, if one defined.
-    if (!us.fExpOff && FSzSet(us.szExpAsp)) {
+    if (!us.fExpOff && FSzSet(us.szExpAsp) && !FExpInvariant(us.szExpAsp)) {
       ExpSetN(iLetterV, i);
       ExpSetN(iLetterW, asp);
       ExpSetN(iLetterX, j);
@@ -1870,7 +2906,7 @@ int GetParallel(CONST real *planet1, CONST real *planet2,
 
 #ifdef EXPRESS
     // Adjust parallel orb with AstroExpression, if one defined.
-    if (!us.fExpOff && FSzSet(us.szExpAsp)) {
+    if (!us.fExpOff && FSzSet(us.szExpAsp) && !FExpInvariant(us.szExpAsp)) {
       ExpSetN(iLetterV, i);
       ExpSetN(iLetterW, asp + cAspect);
       ExpSetN(iLetterX, j);
@@ -1939,7 +2975,7 @@ int GetDistance(CONST PT3R *space1, CONST PT3R *space2,
 
 #ifdef EXPRESS
     // Adjust orb with AstroExpression, if one defined.
-    if (!us.fExpOff && FSzSet(us.szExpAsp)) {
+    if (!us.fExpOff && FSzSet(us.szExpAsp) && !FExpInvariant(us.szExpAsp)) {
       ExpSetN(iLetterV, i);
       ExpSetN(iLetterW, -asp);
       ExpSetN(iLetterX, j);
@@ -1962,26 +2998,255 @@ int GetDistance(CONST PT3R *space1, CONST PT3R *space2,
 }
 
 
+// Return whether the aspect kernel can be used to fill in aspects, which is
+// the case when the grid is of longitude aspects, and no AstroExpression can
+// change the orbs.
+
+flag FAspectKernel(void)
+{
+  if (us.fParallel || us.fDistance)
+    return fFalse;
+#ifdef EXPRESS
+  if (!us.fExpOff && FSzSet(us.szExpAsp) && !FExpInvariant(us.szExpAsp))
+    return fFalse;
+#endif
+  return fTrue;
+}
+
+
+// Fill out the aspect kernel arrays with the unrestricted aspects, and with
+// the objects in one chart, which form the columns of the grid.
+
+void AspectKernelInit(AK *pak, CONST real *rgpos, CONST real *rgalt,
+  flag fRelation)
+{
+  int obj, asp, o, k, i;
+  real pos;
+
+  pak->cobj = 0;
+  for (obj = 0; obj <= is.nObj; obj++) {
+    if (FIgnore(obj) && (!fRelation || FIgnore2(obj)))
+      continue;
+    o = Min(obj, oNorm1);
+    pak->rgobj[pak->cobj] = obj;
+    pak->rgpos[pak->cobj] = rgpos[obj];
+    pak->rgalt[pak->cobj] = rgalt[obj];
+    pak->rgorb[pak->cobj] = rObjOrb[o];
+    pak->rgadd[pak->cobj] = rObjAdd[o];
+    pak->cobj++;
+  }
+  pak->casp = 0;
+  for (asp = 1; asp <= us.nAsp; asp++) {
+    if (FIgnoreA(asp))
+      continue;
+    pak->rgasp[pak->casp] = asp;
+    pak->rgang[pak->casp] = rAspAngle[asp];
+    pak->rgorbAsp[pak->casp] = rAspOrb[asp];
+    pak->casp++;
+  }
+
+  // Index the star columns, which are always last, by zodiac position.
+  // Positions are sorted with an insertion sort since there are few stars.
+  for (k = 0; k < pak->cobj && !FStar(pak->rgobj[k]); k++)
+    ;
+  pak->kStar = k;
+  pak->cstar = 0;
+  pak->orbStar = pak->addStar = 0.0;
+  if (us.fAspect3D)
+    return;
+  for (; k < pak->cobj; k++) {
+    pos = pak->rgpos[k];
+    if (!(pos >= 0.0 && pos < rDegMax)) {
+      pak->cstar = 0;
+      return;
+    }
+    for (i = pak->cstar; i > 0 && pak->rgposStar[i-1] > pos; i--) {
+      pak->rgposStar[i] = pak->rgposStar[i-1];
+      pak->rgkStar[i] = pak->rgkStar[i-1];
+    }
+    pak->rgposStar[i] = pos;
+    pak->rgkStar[i] = k;
+    pak->cstar++;
+    pak->orbStar = Max(pak->orbStar, pak->rgorb[k]);
+    pak->addStar = Max(pak->addStar, pak->rgadd[k]);
+  }
+}
+
+
+// Return the index of the first star in the aspect kernel's star index whose
+// zodiac position is at or after the given position, via binary search.
+
+int IStarIndex(CONST AK *pak, real pos)
+{
+  int iLo = 0, iHi = pak->cstar, i;
+
+  while (iLo < iHi) {
+    i = (iLo + iHi) >> 1;
+    if (pak->rgposStar[i] < pos)
+      iLo = i + 1;
+    else
+      iHi = i;
+  }
+  return iLo;
+}
+
+
+// Determine which objects in the aspect kernel within a range of columns may
+// have an aspect to the object at the given position, setting its entries in
+// the rgf array. If fFirst set, the object is the first one passed to
+// GetOrb(), which affects the order orbs are summed and hence the exact orb.
+// Orbs are compared the same way GetAspect() does, so a pair of objects is
+// only flagged if GetAspect() would consider them, although GetAspect() may
+// still reject them for other reasons, such as with FAcceptAspect().
+
+flag FAspectKernelRow(AK *pak, int obj, real pos, real alt, flag fFirst,
+  int kLo, int kHi)
+{
+  int k, iasp, kEnd = kHi, i, j, n;
+  real orbRow, addRow, ang, orbAsp, orb, r, pos2, rLo, rHi;
+  byte f = 0;
+
+  orbRow = rObjOrb[Min(obj, oNorm1)];
+  addRow = rObjAdd[Min(obj, oNorm1)];
+  // Star columns are handled separately below, if they're indexed.
+  if (pak->cstar > 0 && !us.fAspect3D)
+    kEnd = Max(kLo, Min(kHi, pak->kStar));
+  if (!us.fAspect3D) {
+    for (k = kLo; k < kEnd; k++) {
+      r = RAbs(pos - pak->rgpos[k]);
+      pak->rgdist[k] = r <= rDegHalf ? r : rDegMax - r;
+    }
+  } else {
+    for (k = kLo; k < kEnd; k++)
+      pak->rgdist[k] = fFirst ?
+        SphDistance(pos, alt, pak->rgpos[k], pak->rgalt[k]) :
+        SphDistance(pak->rgpos[k], pak->rgalt[k], pos, alt);
+  }
+  for (k = kLo; k < kHi; k++)
+    pak->rgf[k] = 0;
+  for (iasp = 0; iasp < pak->casp; iasp++) {
+    ang = pak->rgang[iasp];
+    orbAsp = Min(pak->rgorbAsp[iasp], orbRow);
+    if (fFirst) {
+      for (k = kLo; k < kEnd; k++) {
+        orb = Min(orbAsp, pak->rgorb[k]);
+        orb = orb + addRow + pak->rgadd[k];
+        pak->rgf[k] |= (RAbs(pak->rgdist[k] - ang) < orb);
+      }
+    } else {
+      for (k = kLo; k < kEnd; k++) {
+        orb = Min(orbAsp, pak->rgorb[k]);
+        orb = orb + pak->rgadd[k] + addRow;
+        pak->rgf[k] |= (RAbs(pak->rgdist[k] - ang) < orb);
+      }
+    }
+    if (kEnd >= kHi)
+      continue;
+
+    // Look up the stars within the largest possible orb of each side of the
+    // aspect angle, and compare just those as above. Ranges that cross 0
+    // degrees Aries are searched in two pieces.
+    orb = Min(orbAsp, pak->orbStar) + addRow + pak->addStar + rSmall;
+    for (j = 0; j < 2; j++) {
+      if (j > 0 && (ang <= 0.0 || ang >= rDegHalf))
+        break;
+      pos2 = Mod(j > 0 ? pos - ang : pos + ang);
+      for (n = -1; n <= 1; n++) {
+        rLo = pos2 - orb + (real)n*rDegMax;
+        rHi = pos2 + orb + (real)n*rDegMax;
+        if (rHi < 0.0 || rLo >= rDegMax)
+          continue;
+        for (i = IStarIndex(pak, rLo);
+          i < pak->cstar && pak->rgposStar[i] <= rHi; i++) {
+          k = pak->rgkStar[i];
+          if (k < kLo || k >= kHi)
+            continue;
+          r = RAbs(pos - pak->rgpos[k]);
+          pak->rgdist[k] = r <= rDegHalf ? r : rDegMax - r;
+          r = Min(orbAsp, pak->rgorb[k]);
+          r = fFirst ? r + addRow + pak->rgadd[k] : r + pak->rgadd[k] + addRow;
+          pak->rgf[k] |= (RAbs(pak->rgdist[k] - ang) < r);
+        }
+      }
+    }
+  }
+  for (k = kLo; k < kHi; k++)
+    f |= pak->rgf[k];
+  return f != 0;
+}
+
+
+// Settings which affect the contents of a relationship aspect grid.
+
+typedef struct _GridRelationSig {
+  int nObj, nAsp, nAppSep, nRel, objRequire, objCenter;
+  flag fParallel, fDistance, fAspect3D, fAspectLat, fSmartCusp, fEquator2,
+    fParallel2, fCmSwiss;
+  real OB;
+  byte ignore[objMax], ignore2[objMax], ignorea[cAspect+1];
+  real rAspAngle[cAspect+1], rAspOrb[cAspect+1], rObjOrb[oNorm+2],
+    rObjAdd[oNorm+2];
+} GRS;
+
+// What the current relationship aspect grid was computed from. When only
+// some objects in the second chart have moved since, such as when stepping
+// through transits to a natal chart, only their entries need updating.
+
+typedef struct _GridRelationCache {
+  flag fValid;           // Whether the grid matches what's here
+  GRS grs;               // Settings the grid was computed with
+  real obj1[objMax], alt1[objMax], dir1[objMax], diralt1[objMax],
+    dirlen1[objMax];     // Positions of objects in the first chart
+  PT3R pt1[objMax];
+  real obj2[objMax], alt2[objMax], dir2[objMax], diralt2[objMax],
+    dirlen2[objMax];     // Positions of objects in the second chart
+  PT3R pt2[objMax];
+  AK ak;                 // Kernel for first chart, if FAspectKernel() true
+} GRC;
+
+TLOCAL GRC *pgrc = NULL;
+
+
 // Fill in the aspect grid based on the aspects taking place among the planets
 // in the present chart. Also fill in the midpoint grid.
 
 flag FCreateGrid(flag fFlip)
 {
-  int x, y, k, asp;
+  AK ak;
+  int x, y, k, asp, kx, ky;
   real l, rOrb, rT;
+  flag fKernel;
 
   if (!FEnsureGrid())
     return fFalse;
   ClearB((pbyte)grid, sizeof(GridInfo));
-
-  for (y = 0; y <= is.nObj; y++) if (!FIgnore(y))
-    for (x = 0; x <= is.nObj; x++) if (!FIgnore(x))
+  if (pgrc != NULL)
+    pgrc->fValid = fFalse;
+  fKernel = FAspectKernel();
+  if (fKernel)
+    AspectKernelInit(&ak, planet, planetalt, fFalse);
+
+  ky = 0;
+  for (y = 0; y <= is.nObj; y++) if (!FIgnore(y)) {
+
+    // Rule out objects that can't aspect this one.
+    if (fKernel) {
+      if (fFlip)
+        FAspectKernelRow(&ak, y, planet[y], planetalt[y], fFalse,
+          ky+1, ak.cobj);
+      else
+        FAspectKernelRow(&ak, y, planet[y], planetalt[y], fFalse, 0, ky);
+    }
+    kx = 0;
+    for (x = 0; x <= is.nObj; x++) if (!FIgnore(x)) {
 
       // The parameter 'flip' determines what half of the grid is filled in
       // with the aspects and what half is filled in with the midpoints.
 
       if (fFlip ? x > y : x < y) {
-        if (us.fParallel)
+        if (fKernel && !ak.rgf[kx])
+          asp = 0;
+        else if (us.fParallel)
           asp = GetParallel(planet, planet, planetalt, planetalt,
             retalt, retalt, x, y, &rOrb);
         else if (us.fDistance)
@@ -2007,26 +3272,186 @@ flag FCreateGrid(flag fFlip)
         grid->n[x][y] = k;
         grid->v[x][y] = l - (real)((k-1)*30);
       }
+      kx++;
+    }
+    ky++;
+  }
+  return fTrue;
+}
+
+
+// Compare or save the position of an object in the first or second chart
+// against the position the current relationship grid was computed with.
+
+flag FGridRelationObj(CONST CP *pcp, int obj, flag fSecond, flag fSave)
+{
+  real *obj0, *alt0, *dir0, *diralt0, *dirlen0;
+  PT3R *pt0;
+
+  if (!fSecond) {
+    obj0 = pgrc->obj1; alt0 = pgrc->alt1; dir0 = pgrc->dir1;
+    diralt0 = pgrc->diralt1; dirlen0 = pgrc->dirlen1; pt0 = pgrc->pt1;
+  } else {
+    obj0 = pgrc->obj2; alt0 = pgrc->alt2; dir0 = pgrc->dir2;
+    diralt0 = pgrc->diralt2; dirlen0 = pgrc->dirlen2; pt0 = pgrc->pt2;
+  }
+  if (fSave) {
+    obj0[obj] = pcp->obj[obj]; alt0[obj] = pcp->alt[obj];
+    dir0[obj] = pcp->dir[obj]; diralt0[obj] = pcp->diralt[obj];
+    dirlen0[obj] = pcp->dirlen[obj]; pt0[obj] = pcp->pt[obj];
+    return fTrue;
+  }
+  return obj0[obj] == pcp->obj[obj] && alt0[obj] == pcp->alt[obj] &&
+    dir0[obj] == pcp->dir[obj] && diralt0[obj] == pcp->diralt[obj] &&
+    dirlen0[obj] == pcp->dirlen[obj] && pt0[obj].x == pcp->pt[obj].x &&
+    pt0[obj].y == pcp->pt[obj].y && pt0[obj].z == pcp->pt[obj].z;
+}
+
+
+// Bring the relationship aspect grid up to date with the current positions
+// in cp1 and cp2, by recomputing only the entries for objects in cp2 which
+// moved since the last call. Return false if the whole grid needs to be
+// computed instead, because the first chart or any settings changed.
+
+flag FGridRelationUpdate(void)
+{
+  GRS grs;
+  int rgobj[objMax], cobj, obj, o, x, y, k, asp;
+  real rOrb;
+  flag fKernel, fFull = fFalse;
+
+  if (pgrc == NULL) {
+    pgrc = (GRC *)PAllocate(sizeof(GRC), "grid cache");
+    if (pgrc == NULL)
+      return fFalse;
+    pgrc->fValid = fFalse;
+  }
+#ifdef EXPRESS
+  // An AstroExpression can change orbs based on anything, unless constant.
+  if (!us.fExpOff && FSzSet(us.szExpAsp) && !FExpInvariant(us.szExpAsp)) {
+    pgrc->fValid = fFalse;
+    return fFalse;
+  }
+#endif
+
+  // Determine the settings the grid is being computed with.
+  ClearB((pbyte)&grs, sizeof(GRS));
+  grs.nObj = is.nObj; grs.nAsp = us.nAsp; grs.nAppSep = us.nAppSep;
+  grs.nRel = us.nRel; grs.objRequire = us.objRequire;
+  grs.objCenter = us.objCenter;
+  grs.fParallel = us.fParallel; grs.fDistance = us.fDistance;
+  grs.fAspect3D = us.fAspect3D; grs.fAspectLat = us.fAspectLat;
+  grs.fSmartCusp = us.fSmartCusp; grs.fEquator2 = us.fEquator2;
+  grs.fParallel2 = us.fParallel2; grs.fCmSwiss = FCmSwissAny();
+  grs.OB = us.fParallel ? is.OB : 0.0;
+  CopyRgb(ignore, grs.ignore, sizeof(ignore));
+  CopyRgb(ignore2, grs.ignore2, sizeof(ignore2));
+  CopyRgb(ignorea, grs.ignorea, sizeof(ignorea));
+  CopyRgb((pbyte)rAspAngle, (pbyte)grs.rAspAngle, sizeof(rAspAngle));
+  CopyRgb((pbyte)rAspOrb, (pbyte)grs.rAspOrb, sizeof(rAspOrb));
+  CopyRgb((pbyte)rObjOrb, (pbyte)grs.rObjOrb, sizeof(rObjOrb));
+  CopyRgb((pbyte)rObjAdd, (pbyte)grs.rObjAdd, sizeof(rObjAdd));
+
+  cobj = 0;
+  for (obj = 0; obj <= is.nObj; obj++)
+    if (!FIgnore(obj) || !FIgnore2(obj))
+      rgobj[cobj++] = obj;
+  fKernel = FAspectKernel();
+
+  // If the settings or the first chart changed, the whole grid is redone.
+  if (!pgrc->fValid || memcmp(&grs, &pgrc->grs, sizeof(GRS)) != 0)
+    fFull = fTrue;
+  for (k = 0; k < cobj && !fFull; k++)
+    fFull = !FGridRelationObj(&cp1, rgobj[k], fFalse, fFalse);
+  if (fFull) {
+    pgrc->grs = grs;
+    for (k = 0; k < cobj; k++) {
+      FGridRelationObj(&cp1, rgobj[k], fFalse, fTrue);
+      FGridRelationObj(&cp2, rgobj[k], fTrue, fTrue);
+    }
+    if (fKernel)
+      AspectKernelInit(&pgrc->ak, cp1.obj, cp1.alt, fTrue);
+    pgrc->fValid = fTrue;
+    return fFalse;
+  }
+
+  // Update the entries for each object in the second chart which moved.
+  // These form a column of the grid, or a row in the case of parallels,
+  // since GetParallel() takes the second chart's object as its first index.
+  for (k = 0; k < cobj; k++) {
+    obj = rgobj[k];
+    if (FGridRelationObj(&cp2, obj, fTrue, fFalse))
+      continue;
+    FGridRelationObj(&cp2, obj, fTrue, fTrue);
+    if (fKernel)
+      FAspectKernelRow(&pgrc->ak, obj, cp2.obj[obj], cp2.alt[obj], fFalse,
+        0, pgrc->ak.cobj);
+    for (o = 0; o < cobj; o++) {
+      x = us.fParallel ? rgobj[o] : obj;
+      y = us.fParallel ? obj : rgobj[o];
+      if (fKernel && !pgrc->ak.rgf[o])
+        asp = 0;
+      else if (us.fParallel)
+        asp = GetParallel(cp1.obj, cp2.obj, cp1.alt, cp2.alt,
+          cp1.diralt, cp2.diralt, y, x, &rOrb);
+      else if (us.fDistance)
+        asp = GetDistance(cp1.pt, cp2.pt, cp1.dirlen, cp2.dirlen,
+          y, x, &rOrb);
+      else
+        asp = GetAspect(cp1.obj, cp2.obj, cp1.alt, cp2.alt,
+          cp1.dir, cp2.dir, y, x, &rOrb);
+      grid->n[x][y] = asp;
+      grid->v[x][y] = asp > 0 ? rOrb : 0.0;
+    }
+  }
   return fTrue;
 }
 
 
+// Free the relationship grid cache. Called as each thread finishes.
+
+void GridRelationClose(void)
+{
+  if (pgrc != NULL) {
+    DeallocateP(pgrc);
+    pgrc = NULL;
+  }
+}
+
+
 // This is similar to the previous function; however, this time fill in the
 // grid based on the aspects (or midpoints if 'fMidpoint' set) taking place
 // among the planets in two different charts, as in the -g -r0 combination.
 
 flag FCreateGridRelation(flag fMidpoint)
 {
-  int x, y, k, asp;
+  AK ak;
+  int x, y, k, asp, kx;
   real l, rOrb, rT;
+  flag fKernel;
 
   if (!FEnsureGrid())
     return fFalse;
+
+  // If only objects in the second chart moved, just update their entries.
+  if (!fMidpoint && FGridRelationUpdate())
+    return fTrue;
+  if (fMidpoint && pgrc != NULL)
+    pgrc->fValid = fFalse;
   ClearB((pbyte)grid, sizeof(GridInfo));
+  fKernel = !fMidpoint && FAspectKernel();
+  if (fKernel)
+    AspectKernelInit(&ak, cp2.obj, cp2.alt, fTrue);
 
-  for (y = 0; y <= is.nObj; y++) if (!FIgnore(y) || !FIgnore2(y))
-    for (x = 0; x <= is.nObj; x++) if (!FIgnore(x) || !FIgnore2(x))
+  for (y = 0; y <= is.nObj; y++) if (!FIgnore(y) || !FIgnore2(y)) {
+    if (fKernel &&
+      !FAspectKernelRow(&ak, y, cp1.obj[y], cp1.alt[y], fTrue, 0, ak.cobj))
+      continue;
+    kx = 0;
+    for (x = 0; x <= is.nObj; x++) if (!FIgnore(x) || !FIgnore2(x)) {
       if (!fMidpoint) {
+        if (fKernel && !ak.rgf[kx++])
+          continue;
         // Aspect grids are represented using x,y coordinates, however note
         // that relationship aspect grids have chart #1 down the Y axis.
         if (us.fParallel)
@@ -2051,6 +3476,8 @@ flag FCreateGridRelation(flag fMidpoint)
         grid->n[x][y] = k;
         grid->v[x][y] = l - (real)((k-1)*30);
       }
+    }
+  }
   return fTrue;
 }
 
@@ -2352,6 +3779,24 @@ void SwissEnsurePath()
 }
 
 
+TLOCAL int nSwissSidMode = -1;
+
+// Set the sidereal mode Swiss Ephemeris computes with, unless it's already
+// in effect. Setting it throws away every position Swiss Ephemeris has saved,
+// so doing so for each object would keep the objects of one chart from
+// sharing work such as the position of the Earth at that time.
+
+void SwissSetSidMode(void)
+{
+  int n = !us.fSidereal2 ? SE_SIDM_FAGAN_BRADLEY : SE_SIDBIT_SSY_PLANE;
+
+  if (n != nSwissSidMode) {
+    swe_set_sid_mode(n, 0.0, 0.0);
+    nSwissSidMode = n;
+  }
+}
+
+
 CONST int rgObjSwissDef[cCust] = {SE_VULCAN - SE_FICT_OFFSET_1,
   SE_CUPIDO   - SE_FICT_OFFSET_1, SE_HADES    - SE_FICT_OFFSET_1,
   SE_ZEUS     - SE_FICT_OFFSET_1, SE_KRONOS   - SE_FICT_OFFSET_1,
@@ -2376,6 +3821,468 @@ int rgTypSwiss[cCust];
 int rgPntSwiss[cCust];
 int rgFlgSwiss[cCust];
 
+// Chebyshev polynomial cache of Swiss Ephemeris positions. When a chart or
+// search knows the range of time it will compute positions within, each
+// object's longitude, latitude, distance, and their speeds are fitted once to
+// piecewise Chebyshev polynomials over that window, after which positions
+// within it are evaluated from the polynomials instead of the full Swiss
+// Ephemeris pipeline. The cache is shared by all threads.
+
+#define cChebCoef  13         // Coefficients in each fitted polynomial
+#define cChebCheck 6          // Times checked against the fit per segment
+#define cChebMax   256        // Most objects with fits in the window
+#define rChebSpan  64.0       // Longest segment, in days
+#define rChebMin   (1.0/64.0) // Shortest segment before giving up, in days
+#define szChebMagic "AstChb2"
+
+typedef struct _ChebSeg {
+  double jd1, jd2;                 // Time span of the segment
+  double rgc[6][cChebCoef];        // Coefficients for each coordinate
+} ChebSeg;
+
+typedef struct _ChebObj {
+  int iobj;       // Swiss Ephemeris object index
+  int iobjCent;   // Central object index, or -1 for the Earth or Sun
+  int iflag;      // Swiss Ephemeris flags positions are computed with
+  int nSid;       // Sidereal mode, which isn't part of the flags
+  int cseg;       // Number of segments, sorted by time
+  flag fFail;     // Whether the fit failed, so positions aren't cached
+  ChebSeg *rgseg; // The segments
+} ChebObj;
+
+typedef struct _ChebCache {
+  double jd1, jd2;              // Time window positions are cached within
+  double rErr;                  // Largest error allowed, in degrees
+  int cobj;                     // Number of objects fitted
+  int csegMax;                  // Room for segments being fitted
+  flag fOn;                     // Whether a window is active
+  flag fDirty;                  // Whether any fits aren't saved to file yet
+  ChebObj rgobj[cChebMax];
+#ifdef THREADS
+  pthread_mutex_t mutex;        // Guards adding of fitted objects
+#endif
+} ChebCache;
+
+ChebCache cheb;
+
+// Objects are only ever added to the end of the list, and each is filled in
+// before the count is increased to include it, so threads can search the
+// objects counted so far without locking.
+#ifdef THREADS
+#define CChebObj() __atomic_load_n(&cheb.cobj, __ATOMIC_ACQUIRE)
+#define SetCChebObj(n) __atomic_store_n(&cheb.cobj, (n), __ATOMIC_RELEASE)
+#else
+#define CChebObj() cheb.cobj
+#define SetCChebObj(n) (cheb.cobj = (n))
+#endif
+
+// Compute the raw Swiss Ephemeris coordinates of an object, the same way
+// FSwissPlanet() does, for fitting purposes.
+
+int NChebCalc(CONST ChebObj *pco, double jde, double *xx, char *serr)
+{
+  if (pco->iobjCent < 0)
+    return swe_calc(jde, pco->iobj, pco->iflag, xx, serr);
+  return swe_calc_pctr(jde, pco->iobj, pco->iobjCent, pco->iflag, xx, serr);
+}
+
+
+// Evaluate a Chebyshev series at u within -1 to 1, with Clenshaw's method.
+
+double RChebEval(CONST double *rgc, double u)
+{
+  double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+  int i;
+
+  for (i = cChebCoef-1; i >= 1; i--) {
+    b2 = b1; b1 = b0;
+    b0 = 2.0*u*b1 - b2 + rgc[i];
+  }
+  return u*b0 - b1 + rgc[0];
+}
+
+
+// Evaluate all six coordinates of a fitted segment at a time.
+
+void ChebEvalSeg(CONST ChebSeg *pcs, double jde, double *xx)
+{
+  double u;
+  int i;
+
+  u = 2.0*(jde - pcs->jd1)/(pcs->jd2 - pcs->jd1) - 1.0;
+  for (i = 0; i < 6; i++)
+    xx[i] = RChebEval(pcs->rgc[i], u);
+  xx[0] = Mod(xx[0]);
+}
+
+
+// Return how far off a fitted position is from the actual one, relative to
+// the allowed error. Speeds are allowed to be off by ten times the error
+// per day, since they aren't used for anything as precise as positions.
+
+double RChebOff(CONST double *xx, CONST double *xxFit, double rErr)
+{
+  double r, rT;
+
+  r = MinDistance(xx[0], xxFit[0]);
+  r = Max(r, RAbs(xx[1] - xxFit[1]));
+  if (xx[2] > 0.0)
+    r = Max(r, RAbs(xx[2] - xxFit[2]) / xx[2] * rDegRad);
+  rT = Max(RAbs(xx[3] - xxFit[3]), RAbs(xx[4] - xxFit[4]));
+  if (xx[2] > 0.0)
+    rT = Max(rT, RAbs(xx[5] - xxFit[5]) / xx[2] * rDegRad);
+  return Max(r, rT / 10.0) / rErr;
+}
+
+
+// Fit one segment of an object's motion, checking the fit at times between
+// its nodes. Return the fit's error relative to the allowed error, or a
+// negative number if Swiss Ephemeris couldn't compute the object.
+
+double RChebFitSeg(CONST ChebObj *pco, ChebSeg *pcs, double jd1, double jd2)
+{
+  double rgx[cChebCoef][6], xx[6], xxFit[6], u, r, rMax = 0.0;
+  char serr[AS_MAXCH];
+  int i, j, k;
+
+  pcs->jd1 = jd1; pcs->jd2 = jd2;
+  for (k = 0; k < cChebCoef; k++) {
+    u = cos(rPi * ((double)k + 0.5) / (double)cChebCoef);
+    if (NChebCalc(pco, jd1 + (u + 1.0) * 0.5 * (jd2 - jd1), rgx[k],
+      serr) < 0)
+      return -1.0;
+    // Unwrap longitude so it's continuous across the Aries point.
+    if (k > 0)
+      rgx[k][0] = rgx[k-1][0] + MinDifference(rgx[k-1][0], rgx[k][0]);
+  }
+  for (i = 0; i < 6; i++)
+    for (j = 0; j < cChebCoef; j++) {
+      r = 0.0;
+      for (k = 0; k < cChebCoef; k++)
+        r += rgx[k][i] *
+          cos(rPi * (double)j * ((double)k + 0.5) / (double)cChebCoef);
+      pcs->rgc[i][j] = r * (j == 0 ? 1.0 : 2.0) / (double)cChebCoef;
+    }
+  for (k = 0; k < cChebCheck; k++) {
+    u = jd1 + (jd2 - jd1) * (double)k / (double)(cChebCheck-1);
+    if (NChebCalc(pco, u, xx, serr) < 0)
+      return -1.0;
+    ChebEvalSeg(pcs, u, xxFit);
+    rMax = Max(rMax, RChebOff(xx, xxFit, cheb.rErr));
+  }
+  return rMax;
+}
+
+
+// Fit an object over the whole window, splitting segments in half until each
+// fits within the allowed error. Return false if it can't be fitted. Since
+// any thread may fit an object and a different one frees it, segments are
+// allocated directly instead of being counted by PAllocate().
+
+flag FChebFitObj(ChebObj *pco)
+{
+  ChebSeg cs, *rgsegT;
+  double jd1, jd2, r;
+  int csegMax = 0;
+
+  pco->cseg = 0; pco->rgseg = NULL; pco->fFail = fTrue;
+  jd1 = cheb.jd1;
+  while (jd1 < cheb.jd2) {
+    jd2 = Min(jd1 + rChebSpan, cheb.jd2);
+    loop {
+      r = RChebFitSeg(pco, &cs, jd1, jd2);
+      if (r < 0.0 || (r > 1.0 && jd2 - jd1 <= rChebMin))
+        goto LFail;
+      if (r <= 1.0)
+        break;
+      jd2 = jd1 + (jd2 - jd1) * 0.5;
+    }
+    if (pco->cseg >= csegMax) {
+      csegMax = Max(csegMax << 1, 16);
+      rgsegT = (ChebSeg *)PAllocateCore(sizeof(ChebSeg) * csegMax);
+      if (rgsegT == NULL)
+        goto LFail;
+      if (pco->rgseg != NULL) {
+        CopyRgb((pbyte)pco->rgseg, (pbyte)rgsegT, sizeof(ChebSeg) *
+          pco->cseg);
+        DeallocatePCore(pco->rgseg);
+      }
+      pco->rgseg = rgsegT;
+    }
+    pco->rgseg[pco->cseg++] = cs;
+    jd1 = jd2;
+  }
+  pco->fFail = fFalse;
+  return fTrue;
+
+LFail:
+  if (pco->rgseg != NULL)
+    DeallocatePCore(pco->rgseg);
+  pco->cseg = 0; pco->rgseg = NULL;
+  return fFalse;
+}
+
+
+// Fill in the header identifying a cache file's fits: the window, the
+// allowed error, which ephemeris computed them, and the sizes of the records
+// that follow, so files written under other settings or layouts are rejected.
+
+void ChebHeader(double *rgr)
+{
+  rgr[0] = cheb.jd1; rgr[1] = cheb.jd2; rgr[2] = cheb.rErr;
+  rgr[3] = (double)us.nSwissEph;
+  rgr[4] = (double)(us.nSwissEph <= 0 ? SEFLG_SWIEPH :
+    (us.nSwissEph == 1 ? SEFLG_MOSEPH : SEFLG_JPLEPH));
+  rgr[5] = (double)cChebCoef;
+  rgr[6] = (double)sizeof(ChebObj);
+  rgr[7] = (double)sizeof(ChebSeg);
+}
+
+
+// Return whether an object's fits read from a cache file are consistent with
+// the window: a sane number of segments, and once they're read, each sorted
+// and within the window.
+
+flag FChebValidObj(CONST ChebObj *pco)
+{
+  int csegMax, i;
+
+  csegMax = (int)((cheb.jd2 - cheb.jd1) / rChebMin) + 1;
+  if (pco->fFail ? pco->cseg != 0 : !FBetween(pco->cseg, 1, csegMax))
+    return fFalse;
+  if (pco->rgseg == NULL)
+    return fTrue;
+  for (i = 0; i < pco->cseg; i++) {
+    if (!(pco->rgseg[i].jd1 < pco->rgseg[i].jd2) ||
+      pco->rgseg[i].jd1 < cheb.jd1 || pco->rgseg[i].jd2 > cheb.jd2 ||
+      (i > 0 && pco->rgseg[i].jd1 != pco->rgseg[i-1].jd2))
+      return fFalse;
+  }
+  return fTrue;
+}
+
+
+// Read fits saved by a prior run over the same window. Only files matching
+// the window, allowed error, and ephemeris are used. If the file doesn't
+// match or is damaged, anything read from it is dropped and the fits are
+// redone, so the file is rewritten when the window ends.
+
+void ChebLoad(CONST char *szFile)
+{
+  FILE *file;
+  char szMagic[8];
+  double rgr[8], rgrKey[8];
+  int cobj, i;
+  ChebObj *pco;
+
+  file = fopen(szFile, "rb");
+  if (file == NULL)
+    return;
+  ChebHeader(rgrKey);
+  if (fread(szMagic, sizeof(szMagic), 1, file) != 1 ||
+    !FEqRgch(szMagic, szChebMagic, sizeof(szMagic)-1, fFalse) ||
+    szMagic[sizeof(szMagic)-1] != chNull ||
+    fread(rgr, sizeof(rgr), 1, file) != 1)
+    goto LFail;
+  for (i = 0; i < 8; i++)
+    if (rgr[i] != rgrKey[i])
+      goto LFail;
+  if (fread(&cobj, sizeof(int), 1, file) != 1 || !FBetween(cobj, 0, cChebMax))
+    goto LFail;
+  for (i = 0; i < cobj; i++) {
+    pco = &cheb.rgobj[cheb.cobj];
+    if (fread(pco, sizeof(ChebObj), 1, file) != 1)
+      goto LFail;
+    pco->rgseg = NULL;
+    if (!FChebValidObj(pco))
+      goto LFail;
+    if (pco->cseg > 0) {
+      pco->rgseg = (ChebSeg *)PAllocateCore(sizeof(ChebSeg) * pco->cseg);
+      if (pco->rgseg == NULL)
+        goto LFail;
+      cheb.cobj++;
+      if (fread(pco->rgseg, sizeof(ChebSeg), pco->cseg, file) !=
+        (size_t)pco->cseg || !FChebValidObj(pco))
+        goto LFail;
+    } else
+      cheb.cobj++;
+  }
+  // The file should end right after the last object.
+  if (getc(file) != EOF)
+    goto LFail;
+  fclose(file);
+  return;
+
+LFail:
+  for (i = 0; i < cheb.cobj; i++)
+    if (cheb.rgobj[i].rgseg != NULL)
+      DeallocatePCore(cheb.rgobj[i].rgseg);
+  cheb.cobj = 0;
+  cheb.fDirty = fTrue;
+  fclose(file);
+}
+
+
+// Write the window's fits to a file, for reuse by later runs.
+
+void ChebSave(CONST char *szFile)
+{
+  FILE *file;
+  char szMagic[8];
+  double rgr[8];
+  int i;
+
+  if (us.fNoWrite)
+    return;
+  file = fopen(szFile, "wb");
+  if (file == NULL) {
+    PrintWarning("Couldn't create Chebyshev cache file.");
+    return;
+  }
+  ClearB((pbyte)szMagic, sizeof(szMagic));
+  sprintf(szMagic, "%s", szChebMagic);
+  ChebHeader(rgr);
+  fwrite(szMagic, sizeof(szMagic), 1, file);
+  fwrite(rgr, sizeof(rgr), 1, file);
+  fwrite(&cheb.cobj, sizeof(int), 1, file);
+  for (i = 0; i < cheb.cobj; i++) {
+    fwrite(&cheb.rgobj[i], sizeof(ChebObj), 1, file);
+    if (cheb.rgobj[i].cseg > 0)
+      fwrite(cheb.rgobj[i].rgseg, sizeof(ChebSeg), cheb.rgobj[i].cseg, file);
+  }
+  fclose(file);
+}
+
+
+// Start caching positions within a range of Julian Days, if enabled with
+// -YW. Return whether a window was started, in which case ChebEnd() should
+// be called after positions within it are no longer needed. Windows don't
+// nest, so a window already in effect is left alone.
+
+flag FChebBegin(real jd1, real jd2)
+{
+  if (us.rChebErr <= 0.0 || cheb.fOn || !FCmSwissAny() || FCmJPLWeb() ||
+    jd2 <= jd1)
+    return fFalse;
+  // Pad the window so Delta T and time zones can't move times outside it.
+  cheb.jd1 = RFloor(jd1) - 2.0; cheb.jd2 = RFloor(jd2) + 3.0;
+  cheb.rErr = us.rChebErr / 3600.0;
+  cheb.cobj = 0;
+  cheb.fDirty = fFalse;
+#ifdef THREADS
+  pthread_mutex_init(&cheb.mutex, NULL);
+#endif
+  if (FSzSet(us.szChebFile))
+    ChebLoad(us.szChebFile);
+  cheb.fOn = fTrue;
+  return fTrue;
+}
+
+
+// Stop caching positions, saving the fits to file if any are new.
+
+void ChebEnd(void)
+{
+  int i;
+
+  if (!cheb.fOn)
+    return;
+  if (cheb.fDirty && FSzSet(us.szChebFile))
+    ChebSave(us.szChebFile);
+  for (i = 0; i < cheb.cobj; i++)
+    if (cheb.rgobj[i].rgseg != NULL)
+      DeallocatePCore(cheb.rgobj[i].rgseg);
+  cheb.cobj = 0;
+#ifdef THREADS
+  pthread_mutex_destroy(&cheb.mutex);
+#endif
+  cheb.fOn = fFalse;
+}
+
+
+// Return the fitted object with the given Swiss Ephemeris object and flags,
+// searching within a range of the list of fitted objects. Return NULL if
+// it's not there.
+
+ChebObj *PcoChebFind(int ilo, int ihi, int iobj, int iobjCent, int iflag,
+  int nSid)
+{
+  ChebObj *pco;
+  int i;
+
+  for (i = ilo; i < ihi; i++) {
+    pco = &cheb.rgobj[i];
+    if (pco->iobj == iobj && pco->iobjCent == iobjCent &&
+      pco->iflag == iflag && pco->nSid == nSid)
+      return pco;
+  }
+  return NULL;
+}
+
+
+// Given Swiss Ephemeris object and flags, look up the object's coordinates
+// at a time from the fitted polynomials, fitting the object first if this is
+// the first time it's been asked for in the window. Return false if the
+// position isn't cached, in which case Swiss Ephemeris should compute it.
+
+flag FChebPlanet(double jde, int iobj, int iobjCent, int iflag, double *xx)
+{
+  ChebObj co, *pco;
+  CONST ChebSeg *pcs;
+  int nSid, cobj, lo, hi, mid;
+
+  if (!cheb.fOn || jde < cheb.jd1 || jde >= cheb.jd2 ||
+    (iflag & SEFLG_TOPOCTR))
+    return fFalse;
+  nSid = (iflag & SEFLG_SIDEREAL) ? us.fSidereal2 : 0;
+  cobj = CChebObj();
+  pco = PcoChebFind(0, cobj, iobj, iobjCent, iflag, nSid);
+  if (pco == NULL) {
+    if (cobj >= cChebMax)
+      return fFalse;
+
+    // Fit the object without holding the lock, since that takes a while,
+    // then add it unless another thread added the same object meanwhile.
+    co.iobj = iobj; co.iobjCent = iobjCent;
+    co.iflag = iflag; co.nSid = nSid;
+    FChebFitObj(&co);
+#ifdef THREADS
+    pthread_mutex_lock(&cheb.mutex);
+#endif
+    pco = PcoChebFind(cobj, cheb.cobj, iobj, iobjCent, iflag, nSid);
+    if (pco == NULL && cheb.cobj < cChebMax) {
+      pco = &cheb.rgobj[cheb.cobj];
+      *pco = co;
+      co.rgseg = NULL;
+      cheb.fDirty = fTrue;
+      SetCChebObj(cheb.cobj + 1);
+    }
+#ifdef THREADS
+    pthread_mutex_unlock(&cheb.mutex);
+#endif
+    if (co.rgseg != NULL)
+      DeallocatePCore(co.rgseg);
+  }
+  if (pco == NULL || pco->fFail)
+    return fFalse;
+
+  // Binary search for the segment containing the time.
+  lo = 0; hi = pco->cseg - 1;
+  while (lo < hi) {
+    mid = (lo + hi + 1) >> 1;
+    if (pco->rgseg[mid].jd1 <= jde)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  pcs = &pco->rgseg[lo];
+  if (jde < pcs->jd1 || jde > pcs->jd2)
+    return fFalse;
+  ChebEvalSeg(pcs, jde, xx);
+  return fTrue;
+}
+
+
 // Given an object index and a Julian Day time, get ecliptic longitude and
 // latitude of the object and its velocity and distance from the Earth or
 // Sun. This basically just calls the Swiss Ephemeris calculation function to
@@ -2390,7 +4297,7 @@ flag FSwissPlanet(int ind, real jd, int indCent,
   int iobj, iobjCent, iflag, nRet, nTyp, nPnt = 0, nFlg = 0, ix;
   double jde, xx[6], xnasc[6], xndsc[6], xperi[6], xaphe[6], *px;
   char serr[AS_MAXCH], szErr[AS_MAXCH + cchSzDef];
-  static int nSwissEph = 0;
+  static TLOCAL int nSwissEph = 0;
   flag fHelio = (indCent != oEar);
 
   // Reset Swiss Ephemeris if changing computation method.
@@ -2462,8 +4369,7 @@ flag FSwissPlanet(int ind, real jd, int indCent,
   iflag |= (us.nSwissEph <= 0 ? SEFLG_SWIEPH :
     (us.nSwissEph == 1 ? SEFLG_MOSEPH : SEFLG_JPLEPH));
   if (us.fSidereal) {
-    swe_set_sid_mode(!us.fSidereal2 ? SE_SIDM_FAGAN_BRADLEY :
-      SE_SIDBIT_SSY_PLANE, 0.0, 0.0);
+    SwissSetSidMode();
     iflag |= SEFLG_SIDEREAL;
   }
   if (fHelio && !FNodal(ind))
@@ -2488,7 +4394,8 @@ flag FSwissPlanet(int ind, real jd, int indCent,
   if (nPnt == 0) {
     if (indCent <= oSun || indCent > oNorm || FNodal(ind) || FNodal(indCent)) {
       // Normal geocentric or heliocentric position.
-      nRet = swe_calc(jde, iobj, iflag, xx, serr);
+      nRet = FChebPlanet(jde, iobj, -1, iflag, xx) ? iflag :
+        swe_calc(jde, iobj, iflag, xx, serr);
     } else {
       // Alternate position orbiting an unusual central object.
       if (indCent <= oPlu)
@@ -2528,7 +4435,8 @@ flag FSwissPlanet(int ind, real jd, int indCent,
       // Can happen if object customized to be a COB.
       if (iobj == iobjCent)
         return fFalse;
-      nRet = swe_calc_pctr(jde, iobj, iobjCent, iflag, xx, serr);
+      nRet = FChebPlanet(jde, iobj, iobjCent, iflag, xx) ? iflag :
+        swe_calc_pctr(jde, iobj, iobjCent, iflag, xx, serr);
     }
   } else {
     nRet = swe_nod_aps(jde, iobj, iflag, us.fTrueNode ? SE_NODBIT_OSCU :
@@ -2697,6 +4605,19 @@ CONST char *szStarNameSwiss[cStar+1] = {"",
   "", "", "", "Kaus Australis", "", "", "", "", "", "",
   "", "", "", "", "", "", ",M31", ",ze-1Ret", ",SgrA*", ",GA"};
 
+// Swiss Ephemeris handles of the stars, and the names they were looked up
+// from, so each star only has to be searched for in the catalog once.
+static TLOCAL int32 rgStarHandle[cStar+1];
+static TLOCAL char rgszStarHandle[cStar+1][cchSzDef];
+static TLOCAL flag fStarHandle = fFalse;
+
+// Positions of every star in the Swiss Ephemeris catalog at one time, as
+// computed all together when SwissComputeStar() starts a new list of stars.
+static TLOCAL int32 *rgistarAll = NULL;
+static TLOCAL double *rgxxStarAll = NULL;
+static TLOCAL int cStarAll = 0, cStarAllMax = 0, iflagStarAll = 0;
+static TLOCAL real jdStarAll = 0.0;
+
 // Compute fixed star locations. Given a time, call Swiss Ephemeris to
 // compute them. This is similar to FSwissPlanet() in that it knows about
 // and translates between Astrolog and Swiss Ephemeris defintions.
@@ -2704,18 +4625,25 @@ CONST char *szStarNameSwiss[cStar+1] = {"",
 void SwissComputeStars(real jd, flag fInitBright)
 {
   char sz[cchSzDef], serr[AS_MAXCH];
-  int i, iflag;
-  double xx[6], mag;
+  int i, j, iflag, rgi[cStar];
+  int32 rgistar[cStar], cistar = 0;
+  double rgxx[cStar*6], *xx, mag;
 
+  if (!is.fSwissPathSet)
+    fStarHandle = fFalse;
   SwissEnsurePath();
+  if (!fStarHandle) {
+    for (i = 1; i <= cStar; i++)
+      rgszStarHandle[i][0] = chNull;
+    fStarHandle = fTrue;
+  }
   if (!fInitBright) {
     jd = JulianDayFromTime(jd);
     iflag = SEFLG_SPEED;
     iflag |= (us.nSwissEph <= 0 ? SEFLG_SWIEPH :
       (us.nSwissEph == 1 ? SEFLG_MOSEPH : SEFLG_JPLEPH));
     if (us.fSidereal) {
-      swe_set_sid_mode(!us.fSidereal2 ? SE_SIDM_FAGAN_BRADLEY :
-        SE_SIDBIT_SSY_PLANE, 0.0, 0.0);
+      SwissSetSidMode();
       iflag |= SEFLG_SIDEREAL;
     }
     if (us.objCenter != oEar)
@@ -2741,9 +4669,19 @@ void SwissComputeStars(real jd, flag fInitBright)
         sprintf(sz, "%s", szObjName[oNorm+i]);
     } else
       sprintf(sz, "%s", szStarCustom[i]);
+    if (!FEqSz(sz, rgszStarHandle[i])) {
+      rgStarHandle[i] = swi_fixstar_handle(sz, serr);
+      sprintf(rgszStarHandle[i], "%s", sz);
+    }
+    rgi[cistar] = i;
+    rgistar[cistar++] = rgStarHandle[i];
+  }
 
-    // Compute the star location or get the star's brightness.
-    swe_fixstar2(sz, jd, iflag, xx, serr);
+  // Compute all the star locations at once, and get their brightnesses.
+  swi_fixstar_batch(rgistar, cistar, jd, iflag, rgxx, serr);
+  for (j = 0; j < cistar; j++) {
+    i = rgi[j];
+    xx = &rgxx[j*6];
     if (!fInitBright) {
       planet[oNorm+i] = Mod(xx[0] + (us.fSidereal ? us.rZodiacOffset : 0.0) +
         us.rZodiacOffsetAll);
@@ -2762,7 +4700,7 @@ void SwissComputeStars(real jd, flag fInitBright)
         kObjA[oNorm+i] = KStarA(rStarBright[i]);
     } else {
       rStarBrightDistDef[i] = xx[2];
-      swe_fixstar2_mag(sz, &mag, serr);
+      swi_fixstar_name_mag(rgistar[j], NULL, &mag);
       rStarBrightDef[i] = rStarBright[i] = mag;
     }
   }
@@ -2774,11 +4712,12 @@ void SwissComputeStars(real jd, flag fInitBright)
 
 flag SwissComputeStar(real jd, ES *pes)
 {
-  char serr[AS_MAXCH], *pch;
+  char serr[AS_MAXCH], sz[cchSzDef], *pch;
   int iflag, isz = 0, i;
-  double xx[6], dist1, dist2;
-  static real lonPrev = 0.0, latPrev = 0.0;
-  static int istar = 1;
+  int32 *rgistar;
+  double *xx, dist1, dist2;
+  static TLOCAL real lonPrev = 0.0, latPrev = 0.0;
+  static TLOCAL int istar = 1;
 
   // Calling with empty parameters means initialize to first star.
   if (pes == NULL) {
@@ -2796,8 +4735,7 @@ flag SwissComputeStar(real jd, ES *pes)
   iflag |= (us.nSwissEph <= 0 ? SEFLG_SWIEPH :
     (us.nSwissEph == 1 ? SEFLG_MOSEPH : SEFLG_JPLEPH));
   if (us.fSidereal) {
-    swe_set_sid_mode(!us.fSidereal2 ? SE_SIDM_FAGAN_BRADLEY :
-      SE_SIDBIT_SSY_PLANE, 0.0, 0.0);
+    SwissSetSidMode();
     iflag |= SEFLG_SIDEREAL;
   }
   if (us.objCenter != oEar)
@@ -2806,18 +4744,57 @@ flag SwissComputeStar(real jd, ES *pes)
     iflag |= SEFLG_TRUEPOS;
   if (us.fNoNutation)
     iflag |= SEFLG_NONUT;
-LNext:
-  sprintf(pes->sz, "%d", istar);
 
-  // Compute the star coordinates and get the star's brightness.
-  if (us.fStarMagDist) {
-    if (swe_fixstar2(pes->sz, rJD2000,
-      SEFLG_SPEED | SEFLG_SWIEPH | SEFLG_HELCTR, xx, serr) < 0)
+  // Compute every star in the catalog together when starting a new list,
+  // which is much faster than computing them one at a time.
+  if (istar == 1 || jd != jdStarAll || iflag != iflagStarAll ||
+    rgxxStarAll == NULL) {
+    SwissEnsurePath();
+    for (cStarAll = 0;; cStarAll++) {
+      if (cStarAll >= cStarAllMax) {
+        i = Max(cStarAllMax * 2, 1024);
+        rgistar = RgAllocate(i, int32, "stars");
+        if (rgistar == NULL)
+          return fFalse;
+        if (rgistarAll != NULL) {
+          CopyRgb((pbyte)rgistarAll, (pbyte)rgistar,
+            cStarAllMax * sizeof(int32));
+          DeallocateP(rgistarAll);
+        }
+        rgistarAll = rgistar;
+        cStarAllMax = i;
+      }
+      sprintf(sz, "%d", cStarAll + 1);
+      if ((rgistarAll[cStarAll] = swi_fixstar_handle(sz, serr)) < 0)
+        break;
+    }
+
+    // Each star has 6 coordinates followed by its distance at J2000.
+    if (rgxxStarAll != NULL)
+      DeallocateP(rgxxStarAll);
+    rgxxStarAll = RgAllocate(cStarAllMax * 7, double, "stars");
+    if (rgxxStarAll == NULL)
       return fFalse;
-    dist1 = xx[2];
+    jdStarAll = jd; iflagStarAll = iflag;
+    if (us.fStarMagDist) {
+      if (swi_fixstar_batch(rgistarAll, cStarAll, rJD2000,
+        SEFLG_SPEED | SEFLG_SWIEPH | SEFLG_HELCTR, rgxxStarAll, serr) < 0)
+        cStarAll = 0;
+      for (i = 0; i < cStarAll; i++)
+        rgxxStarAll[cStarAllMax*6 + i] = rgxxStarAll[i*6 + 2];
+    }
+    if (swi_fixstar_batch(rgistarAll, cStarAll, jd, iflag, rgxxStarAll,
+      serr) < 0)
+      cStarAll = 0;
   }
-  if (swe_fixstar2(pes->sz, jd, iflag, xx, serr) < 0)
+
+LNext:
+  // Get the star coordinates and the star's brightness.
+  if (istar > cStarAll)
     return fFalse;
+  xx = &rgxxStarAll[(istar-1)*6];
+  if (us.fStarMagDist)
+    dist1 = rgxxStarAll[cStarAllMax*6 + istar-1];
   pes->lon = Mod(xx[0] + (us.fSidereal ? us.rZodiacOffset : 0.0) +
     us.rZodiacOffsetAll);
   pes->lat = xx[1];
@@ -2835,7 +4812,7 @@ LNext:
     if (us.fStarMagDist)
       dist2 = us.fStarMagAbs ? 10.0 * rPCToAU : PtLen(pes->pt);
   }
-  if (swe_fixstar2_mag(pes->sz, &pes->mag, serr) < 0)
+  if (swi_fixstar_name_mag(rgistarAll[istar-1], pes->sz, &pes->mag) < 0)
     return fFalse;
   if (pes->mag == 0.0)
     pes->mag = rStarNot;
@@ -2937,16 +4914,80 @@ flag SwissTestStar(char *sz)
 }
 
 
+#define cAstJob   64    // Asteroids computed by each thread job
+#define cAstBlock 1024  // Asteroids computed at once by SwissComputeAsteroid()
+
+// A list of asteroids to compute at one time, with positions of each stored
+// in parallel arrays, as passed to the jobs of SwissComputeAsteroids().
+
+typedef struct _AsteroidBatch {
+  CONST int *rgast;  // Number of each asteroid
+  int cast;          // Number of asteroids in the batch
+  real jd;           // Time to compute positions for
+  real *rglon;       // Zodiac position of each asteroid
+  real *rglat;       // Latitude of each asteroid
+  real *rgdir;       // Velocity of each asteroid
+  real *rgdist;      // Distance of each asteroid
+  flag *rgf;         // Whether each asteroid could be computed
+} AB;
+
+#ifdef GRAPH
+// The block of asteroids SwissComputeAsteroid() is currently going through.
+static TLOCAL pbyte pbAstBlock = NULL;
+static TLOCAL int iastBlock = 0, castBlock = 0;
+static TLOCAL real jdAstBlock = 0.0;
+#endif
+
+// Compute a run of asteroids in a batch. Called by RunThreadJobs() on worker
+// threads, which each have their own Swiss Ephemeris state, although the
+// asteroid ephemeris files themselves are mapped into memory only once.
+
+void SwissAsteroidJob(int ijob, void *pv)
+{
+  AB *pab = (AB *)pv;
+  int i, iMax;
+  real r5, r6;
+  flag fNoEphFile = is.fNoEphFile;
+
+  // Errors get reported by the caller, so don't print them from here.
+  is.fNoEphFile = fTrue;
+  i = ijob * cAstJob;
+  iMax = Min(i + cAstJob, pab->cast);
+  for (; i < iMax; i++)
+    pab->rgf[i] = FSwissPlanet(pab->rgast[i] + SE_AST_OFFSET, pab->jd,
+      us.objCenter, &pab->rglon[i], &pab->rglat[i], &pab->rgdir[i],
+      &pab->rgdist[i], &r5, &r6);
+  is.fNoEphFile = fNoEphFile;
+}
+
+
+// Compute a list of asteroids at one Julian Day, spread over as many threads
+// as allowed. Positions are stored as FSwissPlanet() returns them. An
+// asteroid's flag is set to false if it couldn't be computed.
+
+void SwissComputeAsteroids(CONST int *rgast, int cast, real jd,
+  real *rglon, real *rglat, real *rgdir, real *rgdist, flag *rgf)
+{
+  AB ab;
+
+  ab.rgast = rgast; ab.cast = cast; ab.jd = jd;
+  ab.rglon = rglon; ab.rglat = rglat; ab.rgdir = rgdir; ab.rgdist = rgdist;
+  ab.rgf = rgf;
+  RunThreadJobs((cast + cAstJob - 1) / cAstJob, SwissAsteroidJob, &ab);
+}
+
+
 #ifdef GRAPH
 // Compute one asteroid location. Given an asteroid number and time, call
 // Swiss Ephemeris to compute it. This is similar to SwissComputeStars().
 
 flag SwissComputeAsteroid(real jd, ES *pes, flag fBack)
 {
-  int iflag, isz = 0, i;
-  real r1, r2, r3, r4, r5, r6, rDiff;
+  int iflag, isz = 0, i, iLo, iHi, *rgast;
+  real r1, r2, r3, r4, r5, r6, rDiff, *rgr;
   char sz[cchSzDef], *pch;
-  static int iast = 1;
+  flag *rgf;
+  static TLOCAL int iast = 1;
 
   // Determine Swiss Ephemeris flags.
   jd = JulianDayFromTime(jd);
@@ -2954,8 +4995,7 @@ flag SwissComputeAsteroid(real jd, ES *pes, flag fBack)
   iflag |= (us.nSwissEph <= 0 ? SEFLG_SWIEPH :
     (us.nSwissEph == 1 ? SEFLG_MOSEPH : SEFLG_JPLEPH));
   if (us.fSidereal) {
-    swe_set_sid_mode(!us.fSidereal2 ? SE_SIDM_FAGAN_BRADLEY :
-      SE_SIDBIT_SSY_PLANE, 0.0, 0.0);
+    SwissSetSidMode();
     iflag |= SEFLG_SIDEREAL;
   }
   if (us.objCenter != oEar)
@@ -2971,12 +5011,41 @@ LNext:
 #endif
   if (pes == NULL) {
     iast = fBack ? gs.nAstHi : gs.nAstLo;
+    castBlock = 0;
     return fTrue;
   } else if (iast < Max(gs.nAstLo, 1) || iast > gs.nAstHi)
     return fFalse;
 
-  // Compute the asteroid coordinates.
-  if (!FSwissPlanet(iast + SE_AST_OFFSET, jd, us.objCenter,
+  // Asteroids are computed a block at a time on several threads. Compute
+  // the next block in the direction being gone if past the current one.
+  if (pbAstBlock == NULL) {
+    pbAstBlock = PAllocate(cAstBlock * (sizeof(int) + sizeof(real)*4 +
+      sizeof(flag)), "asteroids");
+    if (pbAstBlock == NULL)
+      return fFalse;
+  }
+  rgr = (real *)pbAstBlock;
+  rgast = (int *)&rgr[cAstBlock*4];
+  rgf = (flag *)&rgast[cAstBlock];
+  i = iast - iastBlock;
+  if (castBlock <= 0 || jd != jdAstBlock || i < 0 || i >= castBlock) {
+    iLo = fBack ? Max(iast - cAstBlock + 1, Max(gs.nAstLo, 1)) : iast;
+    iHi = fBack ? iast : Min(iast + cAstBlock - 1, gs.nAstHi);
+    castBlock = iHi - iLo + 1;
+    for (i = 0; i < castBlock; i++)
+      rgast[i] = iLo + i;
+    SwissComputeAsteroids(rgast, castBlock, jd, &rgr[0], &rgr[cAstBlock],
+      &rgr[cAstBlock*2], &rgr[cAstBlock*3], rgf);
+    iastBlock = iLo; jdAstBlock = jd;
+    i = iast - iastBlock;
+  }
+
+  // Get the asteroid coordinates. If it couldn't be computed, try again here
+  // so any error gets reported the same as before.
+  if (rgf[i]) {
+    r1 = rgr[i]; r2 = rgr[cAstBlock + i];
+    r3 = rgr[cAstBlock*2 + i]; r4 = rgr[cAstBlock*3 + i];
+  } else if (!FSwissPlanet(iast + SE_AST_OFFSET, jd, us.objCenter,
     &r1, &r2, &r3, &r4, &r5, &r6))
     return fFalse;
   pes->lon = Mod(r1 + is.rSid);
@@ -3105,8 +5174,7 @@ flag FSwissPlanetData(real jd, int ind, real *rPhase, real *rDiam, real *rMag)
   iflag |= (us.nSwissEph <= 0 ? SEFLG_SWIEPH :
     (us.nSwissEph == 1 ? SEFLG_MOSEPH : SEFLG_JPLEPH));
   if (us.fSidereal) {
-    swe_set_sid_mode(!us.fSidereal2 ? SE_SIDM_FAGAN_BRADLEY :
-      SE_SIDBIT_SSY_PLANE, 0.0, 0.0);
+    SwissSetSidMode();
     iflag |= SEFLG_SIDEREAL;
   }
   if (ind <= oSun && us.fBarycenter)
@@ -3176,6 +5244,150 @@ void SwissRevJul(real jd, int gregflag,
 {
   swe_revjul(jd, gregflag, jyear, jmon, jday, jut);
 }
+
+
+// Wrapper around Swiss Ephemeris close routine. Releases ephemeris files and
+// other state opened by the current thread.
+
+void SwissClose()
+{
+#ifdef GRAPH
+  if (pbAstBlock != NULL) {
+    DeallocateP(pbAstBlock);
+    pbAstBlock = NULL;
+  }
+  castBlock = 0;
+#endif
+  if (rgistarAll != NULL) {
+    DeallocateP(rgistarAll);
+    rgistarAll = NULL;
+  }
+  if (rgxxStarAll != NULL) {
+    DeallocateP(rgxxStarAll);
+    rgxxStarAll = NULL;
+  }
+  cStarAll = cStarAllMax = 0;
+  fStarHandle = fFalse;
+  swe_close();
+  nSwissSidMode = -1;
+}
+
+
+// Release the ephemeris files shared in memory by all threads. Only done
+// when exiting, after every thread has closed its own ephemeris state.
+
+void SwissUnmapFiles()
+{
+  SwissPreloadWait();
+  swi_unmap_files();
+}
+
+
+#ifdef THREADS
+// Ephemeris preload running in the background, which only the main thread
+// starts and waits for.
+
+typedef struct _SwissPreloadJob {
+  CC *pcc;       // Chart context of the starting thread.
+  real jd1;      // Ephemeris time range to preload.
+  real jd2;
+  int32 mask;    // Swiss Ephemeris bodies to preload.
+  pthread_t th;  // The thread doing the preload.
+  flag fRun;     // Whether the thread has been started.
+} SwissPreloadJob;
+
+SwissPreloadJob spj = {NULL, 0.0, 0.0, 0, 0, fFalse};
+
+void *PvSwissPreload(void *pv)
+{
+  CONST SwissPreloadJob *pspj = (CONST SwissPreloadJob *)pv;
+  char serr[AS_MAXCH];
+
+  InitChartContext();
+  LoadChartContext(pspj->pcc);
+  is.fSwissPathSet = fFalse;  // Swiss Ephemeris state is per thread.
+  SwissEnsurePath();
+  swi_preload_range(pspj->jd1, pspj->jd2, pspj->mask, serr);
+  SwissClose();
+  return NULL;
+}
+#endif
+
+
+// Decode the ephemeris segments a search or ephemeris over a range of Julian
+// Days will need into memory before starting it, if enabled with -YH. With
+// -YH 2 this is done on a thread of its own, so the computation can start
+// right away and pick up segments as they become ready.
+
+void SwissPreload(real jd1, real jd2)
+{
+  char serr[AS_MAXCH];
+  int32 mask = 1 << SE_SUN;
+  int obj;
+
+  if (us.nPreload <= 0 || !FCmSwissAny() || us.nSwissEph > 0 || jd2 <= jd1)
+    return;
+  SwissPreloadWait();
+  // Pad the range so Delta T and time zones can't move times outside it.
+  jd1 += swe_deltat(jd1) - 2.0; jd2 += swe_deltat(jd2) + 3.0;
+  for (obj = oChi; obj <= oPho; obj++) {
+    if (ignore[obj] && ignore2[obj])
+      continue;
+    if (obj == oChi)
+      mask |= 1 << SE_CHIRON;
+    else if (FBetween(obj, oCer, oVes))
+      mask |= 1 << (SE_CERES + obj - oCer);
+    else if (obj == oPho)
+      mask |= 1 << SE_PHOLUS;
+  }
+#ifdef THREADS
+  if (us.nPreload >= 2) {
+    spj.pcc = RgAllocate(1, CC, "chart context");
+    if (spj.pcc != NULL) {
+      SaveChartContext(spj.pcc);
+      spj.jd1 = jd1; spj.jd2 = jd2; spj.mask = mask;
+      spj.fRun = pthread_create(&spj.th, NULL, PvSwissPreload, &spj) == 0;
+      if (spj.fRun)
+        return;
+      DeallocateP(spj.pcc);
+    }
+  }
+#endif
+  SwissEnsurePath();
+  swi_preload_range(jd1, jd2, mask, serr);
+}
+
+
+// Wait for an ephemeris preload running in the background to finish.
+
+void SwissPreloadWait()
+{
+#ifdef THREADS
+  if (!spj.fRun)
+    return;
+  pthread_join(spj.th, NULL);
+  DeallocateP(spj.pcc);
+  spj.fRun = fFalse;
+#endif
+}
+
+
+// Print how many ephemeris segments were preloaded over the run of the
+// program, and how much memory they take.
+
+void PrintPreloadStats(void)
+{
+  char sz[cchSzDef];
+  int32 cb, cseg;
+
+  SwissPreloadWait();
+  cb = swi_preload_size(&cseg);
+  if (cseg <= 0)
+    return;
+  sprintf(sz, "Ephemeris preload: %d segments in %d KB of memory.",
+    (int)cseg, (int)((cb + 1023) >> 10));
+  PrintNotice(sz);
+}
 #endif /* SWISS */
 
 /* calc.cpp */
@@ -173,7 +173,7 @@ void DisplayCredits(void)
 void PrintS(CONST char *sz)
 {
   char ch, ch1, ch2, ch3, ch4;
-  static char ch1Prev = chNull, ch2Prev = chNull, ch3Prev = chNull,
+  static TLOCAL char ch1Prev = chNull, ch2Prev = chNull, ch3Prev = chNull,
     ch4Prev = chNull;
 
   // Determine color for first part of line.
@@ -414,6 +414,10 @@ void DisplaySwitches(void)
   PrintS(" _os <file>, > <file>: Redirect output of text charts to file.");
   PrintS(" _5: Set whether transit event charts autopopulate chart list.");
   PrintS(" _5e[2-4]: Display text charts for all charts in chart list.");
+  PrintS(" _5p[3-4] <count> <power>: Display most powerful pairs in chart");
+  PrintS("  list, ranked if count is nonzero, else all with at least power.");
+  PrintS(
+    " _5c <file>: Cache positions of charts cast for chart list in file.");
   PrintS(" _5[dxynls]: Sort chart list by date, lon, lat, name, or city.");
   PrintS(
     " _5f <name> <city>: Filter chart list to charts containing substring.");
@@ -605,7 +609,18 @@ void DisplaySwitchesRare(void)
   PrintS(" _YP <-1,0,1>: Set how Arabic parts are computed for night charts.");
 #endif
   PrintS(" _Yb <days>: Set number of days to span for biorhythm chart.");
+  PrintS(" _Yx: Solve for exact times of aspects in _d and _t searches.");
+#ifdef THREADS
+  PrintS(" _YM <threads>: Set threads to cast charts on (0 means all cores).");
+#endif
+#ifdef EPHEM
+  PrintS(" _YL <entries>: Cache this many ephemeris positions (0 means off).");
+#endif
 #ifdef SWISS
+  PrintS(" _YW <arcsec>: Fit positions in _d, _t, and _E to polynomials.");
+  PrintS(" _YW0 <arcsec> <file>: Like _YW but reuse fits saved in file.");
+  PrintS(
+    " _YH <0-2>: Preload ephemeris for searches (2 means in background).");
   PrintS(" _Ye <obj> <index>: Change orbit of Uranian to external formula.");
   PrintS(
     " _Yeb <obj> <index>: Change orbit of Uranian to external ephemeris.");
@@ -758,6 +773,8 @@ void DisplaySwitchesRare(void)
   PrintS(" _YY2 <zones> <entries>: Load time zone change lists from file.");
   PrintS(
     " _YY3 <rows>: Load atlas time zone to zone change mappings from file.");
+  PrintS(
+    " _YYc <file>: Write atlas to compiled binary file for fast loading.");
   PrintS(" _YYt <text>: Output formatted text string in current context.");
   PrintS(" _YYT <text>: Popup formatted text string in current context.");
   PrintS(" _0[o,i,q,X,n,b,~]: Permanently disable file output/input, program");
@@ -813,6 +830,7 @@ void DisplaySwitchesRare(void)
   PrintS(" _~1 <string>: Simply parse AstroExpression (don't show result).");
   PrintS(" _~2[0] <var> <string>: Set AstroExpression custom string(s).");
   PrintS(" _~0: Disable all automatic AstroExpression checks in the program.");
+  PrintS(" _~T: Display time spent in each AstroExpression when exiting.");
 #endif
 }
 
@@ -333,6 +333,325 @@ void ChartAspectRelation(void)
 }
 
 
+// Positions of every chart in the chart list, and the aspect power between
+// pairs of them, as used by the -5p switch. Each chart is cast just once into
+// the positions table. Pairs of charts are then compared in square tiles of
+// charts, so the positions for a tile stay in cache while it's compared.
+// Tiles are done a strip at a time, where each strip covers a range of first
+// charts and all second charts they're paired with.
+
+#define cListPairTile 32
+
+typedef struct _ListPairs {
+  int cobj;          // Number of entries for each chart in the arrays below
+  real *rgobj;       // Zodiac position of each object in each chart
+  real *rgalt;       // Latitude of each object in each chart
+  real *rgdir;       // Velocity of each object in each chart
+  real *rgdiralt;    // Latitude velocity of each object in each chart
+  PT3R *rgpt;        // Coordinates in space of each object in each chart
+  real *rgdirlen;    // Distance velocity of each object in each chart
+  real *rgOB;        // Obliquity of the ecliptic of each chart
+  int iRow;          // First chart in the current strip
+  int cRow;          // Number of first charts in the current strip
+  real *rgpow;       // Sum of aspect powers of each pair in the strip
+  int *rgcasp;       // Number of aspects of each pair in the strip
+} LP;
+
+typedef struct _ListPairResult {
+  real rPow;         // Sum of aspect powers between the two charts
+  int casp;          // Number of aspects between the two charts
+  int iList;         // Index of the first chart in the chart list
+  int iList2;        // Index of the second chart in the chart list
+} LPR;
+
+
+// Cast one chart in the chart list, and save its positions in the table.
+// Called by RunThreadJobs() on worker threads.
+
+void ListPairCastJob(int ijob, void *pv)
+{
+  LP *plp = (LP *)pv;
+  int i = ijob * plp->cobj, cb = plp->cobj * sizeof(real);
+
+  ciCore = ciMain = is.rgci[ijob];
+  CastChart(1);
+  CopyRgb((pbyte)planet, (pbyte)&plp->rgobj[i], cb);
+  CopyRgb((pbyte)planetalt, (pbyte)&plp->rgalt[i], cb);
+  CopyRgb((pbyte)ret, (pbyte)&plp->rgdir[i], cb);
+  CopyRgb((pbyte)retalt, (pbyte)&plp->rgdiralt[i], cb);
+  CopyRgb((pbyte)space, (pbyte)&plp->rgpt[i], plp->cobj * sizeof(PT3R));
+  CopyRgb((pbyte)retlen, (pbyte)&plp->rgdirlen[i], cb);
+  plp->rgOB[ijob] = is.OB;
+}
+
+
+// Compare one tile of pairs of charts in the current strip, summing the power
+// of each aspect between them the same way the -r0 -a aspect list does. Each
+// second chart in the tile is set up in the aspect kernel once, then compared
+// against each first chart in the tile. Parallels are converted between
+// ecliptic and equator with the obliquity of the second chart, as with -r0,
+// where it's the chart cast last. Called by RunThreadJobs() on worker threads.
+
+void ListPairTileJob(int ijob, void *pv)
+{
+  LP *plp = (LP *)pv;
+  AK ak;
+  CONST real *obj1, *alt1, *dir1, *obj2, *alt2, *dir2;
+  CONST PT3R *pt1, *pt2;
+  int iCol = ijob * cListPairTile, iColMax, iRow, iRowMax, iPair, casp,
+    k, kx, x, y, asp, p;
+  long lPow;
+  real rOrb, rOBSav = is.OB;
+  flag fKernel = FAspectKernel();
+
+  iColMax = Min(iCol + cListPairTile, is.cci);
+  iRowMax = plp->iRow + plp->cRow;
+  for (; iCol < iColMax; iCol++) {
+    k = iCol * plp->cobj;
+    obj2 = &plp->rgobj[k]; alt2 = &plp->rgalt[k];
+    dir2 = us.fParallel ? &plp->rgdiralt[k] :
+      (us.fDistance ? &plp->rgdirlen[k] : &plp->rgdir[k]);
+    pt2 = &plp->rgpt[k];
+    is.OB = plp->rgOB[iCol];
+    AspectKernelInit(&ak, obj2, alt2, fFalse);
+    // With -5p3 each chart is only paired with charts before it.
+    iRow = plp->iRow;
+    if (us.nListPair == 3 && iRow <= iCol)
+      iRow = iCol + 1;
+    for (; iRow < iRowMax; iRow++) {
+      k = iRow * plp->cobj;
+      obj1 = &plp->rgobj[k]; alt1 = &plp->rgalt[k];
+      dir1 = us.fParallel ? &plp->rgdiralt[k] :
+        (us.fDistance ? &plp->rgdirlen[k] : &plp->rgdir[k]);
+      pt1 = &plp->rgpt[k];
+      lPow = 0; casp = 0;
+      for (k = 0; k < ak.cobj; k++) {
+        y = ak.rgobj[k];
+        if (fKernel &&
+          !FAspectKernelRow(&ak, y, obj1[y], alt1[y], fTrue, 0, ak.cobj))
+          continue;
+        for (kx = 0; kx < ak.cobj; kx++) {
+          if (fKernel && !ak.rgf[kx])
+            continue;
+          x = ak.rgobj[kx];
+          // Chart #1 is along the Y axis, as with relationship aspect grids.
+          if (us.fParallel)
+            asp = GetParallel(obj1, obj2, alt1, alt2, dir1, dir2, y, x,
+              &rOrb);
+          else if (us.fDistance)
+            asp = GetDistance(pt1, pt2, dir1, dir2, y, x, &rOrb);
+          else
+            asp = GetAspect(obj1, obj2, alt1, alt2, dir1, dir2, y, x, &rOrb);
+          if (asp <= 0)
+            continue;
+          p = (int)(rAspInf[asp]*(RObjInf(x)+RObjInf(y))/2.0*
+            (1.0-RAbs(rOrb)/GetOrb(x, y, asp))*10000.0);
+#ifdef EXPRESS
+          // Adjust power with AstroExpression if one set.
+          if (FSzSet(us.szExpAspList)) {
+            ExpSetN(iLetterW, x);
+            ExpSetN(iLetterX, asp);
+            ExpSetN(iLetterY, y);
+            ExpSetN(iLetterZ, p);
+            ParseExpression(us.szExpAspList);
+            p = NExpGet(iLetterZ);
+          }
+#endif
+          lPow += p;
+          casp++;
+        }
+      }
+      iPair = (iRow - plp->iRow) * is.cci + iCol;
+      plp->rgpow[iPair] = (real)lPow/10000.0;
+      plp->rgcasp[iPair] = casp;
+    }
+  }
+  is.OB = rOBSav;
+}
+
+
+// Return whether the first pair of charts should be ranked below the second,
+// i.e. it has less power, or it has the same power but comes later in the
+// chart list.
+
+flag FListPairLess(CONST LPR *plpr1, CONST LPR *plpr2)
+{
+  if (plpr1->rPow != plpr2->rPow)
+    return plpr1->rPow < plpr2->rPow;
+  if (plpr1->iList != plpr2->iList)
+    return plpr1->iList > plpr2->iList;
+  return plpr1->iList2 > plpr2->iList2;
+}
+
+
+// Move the entry at the given index of a heap of pairs of charts down to
+// where it belongs, such that the least powerful pair stays at the top.
+
+void ListPairHeapDown(LPR *rglpr, int clpr, int i)
+{
+  LPR lpr = rglpr[i];
+  int j;
+
+  loop {
+    j = i*2 + 1;
+    if (j >= clpr)
+      break;
+    if (j+1 < clpr && FListPairLess(&rglpr[j+1], &rglpr[j]))
+      j++;
+    if (!FListPairLess(&rglpr[j], &lpr))
+      break;
+    rglpr[i] = rglpr[j];
+    i = j;
+  }
+  rglpr[i] = lpr;
+}
+
+
+// Print one pair of charts and how powerful the aspects between them are.
+// Each chart is shown on its own line with its index in the chart list, and
+// its date and time, so charts with the same name can be told apart.
+
+void PrintListPair(int count, CONST LPR *plpr)
+{
+  char sz[cchSzMax];
+  CONST CI *pci;
+  int i, j;
+
+  sprintf(sz, "%4d: ", count); PrintSz(sz);
+  AnsiColor(kDkGreenA);
+  PrintSz("power: ");
+  sprintf(sz, us.fSeconds ? "%9.4f" : "%7.2f", plpr->rPow); PrintSz(sz);
+  AnsiColor(kDefault);
+  sprintf(sz, " - aspects: %3d -", plpr->casp); PrintSz(sz);
+  for (i = 0; i < 2; i++) {
+    j = i <= 0 ? plpr->iList : plpr->iList2;
+    pci = &is.rgci[j];
+    if (i > 0) {
+      PrintL();
+      PrintTab(' ', us.fSeconds ? 34 : 32);
+    }
+    AnsiColor(kObjA[i <= 0 ? oSun : oMoo]);
+    sprintf(sz, " %s#%d %s%s%s %s", i <= 0 ? "" : "& ", j,
+      pci->nam, FSzSet(pci->nam) ? " " : "",
+      SzDate(pci->mon, pci->day, pci->yea, 0), SzTim(pci->tim));
+    PrintSz(sz);
+    AnsiColor(kDefault);
+  }
+  PrintL();
+}
+
+
+// Compare every pair of charts in the chart list, and display the pairs with
+// the most powerful aspects between them, as specified with the -5p switch.
+// This is like running -r0 -a for each pair as done with -5e3 or -5e4, except
+// each chart is only cast once, and only the total power of each pair's
+// aspect list is shown. If a number of pairs is given, display that many of
+// the most powerful pairs ranked in order, otherwise display every pair with
+// enough power in chart list order as each strip of pairs is done.
+
+void ChartListPairs(void)
+{
+  LP lp;
+  LPR *rglpr = NULL, lpr;
+  CI ciCoreSav = ciCore, ciMainSav = ciMain;
+  int cci = is.cci, clpr = 0, count = 0, iList, iList2, iList2Max, i;
+  long cb;
+
+  ClearB((pbyte)&lp, sizeof(lp));
+  lp.cobj = is.nObj + 1;
+  cb = (long)cci * lp.cobj;
+  lp.rgobj = RgAllocate(cb, real, "chart positions");
+  lp.rgalt = RgAllocate(cb, real, "chart positions");
+  lp.rgdir = RgAllocate(cb, real, "chart positions");
+  lp.rgdiralt = RgAllocate(cb, real, "chart positions");
+  lp.rgpt = RgAllocate(cb, PT3R, "chart positions");
+  lp.rgdirlen = RgAllocate(cb, real, "chart positions");
+  lp.rgOB = RgAllocate(cci, real, "chart positions");
+  lp.rgpow = RgAllocate(cListPairTile * cci, real, "chart pairs");
+  lp.rgcasp = RgAllocate(cListPairTile * cci, int, "chart pairs");
+  if (us.nListPairMax > 0)
+    rglpr = RgAllocate(us.nListPairMax, LPR, "chart pairs");
+  if (lp.rgobj == NULL || lp.rgalt == NULL || lp.rgdir == NULL ||
+    lp.rgdiralt == NULL || lp.rgpt == NULL || lp.rgdirlen == NULL ||
+    lp.rgOB == NULL || lp.rgpow == NULL || lp.rgcasp == NULL ||
+    (us.nListPairMax > 0 && rglpr == NULL))
+    goto LDone;
+
+  // Cast each chart once, spread over as many threads as allowed.
+  RunThreadJobs(cci, ListPairCastJob, &lp);
+  ciCore = ciCoreSav; ciMain = ciMainSav;
+
+  // Compare each strip of pairs, then either display the pairs in it with
+  // enough power, or add them to the heap of the most powerful pairs.
+  for (lp.iRow = 0; lp.iRow < cci; lp.iRow += cListPairTile) {
+    lp.cRow = Min(cListPairTile, cci - lp.iRow);
+    iList2Max = us.nListPair == 3 ? lp.iRow + lp.cRow - 1 : cci;
+    if (iList2Max <= 0)
+      continue;
+    RunThreadJobs((iList2Max + cListPairTile - 1) / cListPairTile,
+      ListPairTileJob, &lp);
+    for (iList = lp.iRow; iList < lp.iRow + lp.cRow; iList++) {
+      iList2Max = us.nListPair == 3 ? iList : cci;
+      for (iList2 = 0; iList2 < iList2Max; iList2++) {
+        i = (iList - lp.iRow) * cci + iList2;
+        lpr.rPow = lp.rgpow[i]; lpr.casp = lp.rgcasp[i];
+        lpr.iList = iList; lpr.iList2 = iList2;
+        if (lpr.rPow < us.rListPairMin)
+          continue;
+        if (rglpr == NULL)
+          PrintListPair(++count, &lpr);
+        else if (clpr < us.nListPairMax) {
+          rglpr[clpr++] = lpr;
+          if (clpr >= us.nListPairMax)
+            for (i = clpr/2 - 1; i >= 0; i--)
+              ListPairHeapDown(rglpr, clpr, i);
+        } else if (FListPairLess(&rglpr[0], &lpr)) {
+          rglpr[0] = lpr;
+          ListPairHeapDown(rglpr, clpr, 0);
+        }
+      }
+    }
+  }
+
+  // Display the most powerful pairs, strongest first.
+  if (rglpr != NULL) {
+    if (clpr < us.nListPairMax)
+      for (i = clpr/2 - 1; i >= 0; i--)
+        ListPairHeapDown(rglpr, clpr, i);
+    for (i = clpr - 1; i > 0; i--) {
+      lpr = rglpr[0]; rglpr[0] = rglpr[i]; rglpr[i] = lpr;
+      ListPairHeapDown(rglpr, i, 0);
+    }
+    for (i = 0; i < clpr; i++)
+      PrintListPair(++count, &rglpr[i]);
+  }
+  if (count == 0)
+    PrintSz("No chart pairs in list.\n");
+
+LDone:
+  if (lp.rgobj != NULL)
+    DeallocateP(lp.rgobj);
+  if (lp.rgalt != NULL)
+    DeallocateP(lp.rgalt);
+  if (lp.rgdir != NULL)
+    DeallocateP(lp.rgdir);
+  if (lp.rgdiralt != NULL)
+    DeallocateP(lp.rgdiralt);
+  if (lp.rgpt != NULL)
+    DeallocateP(lp.rgpt);
+  if (lp.rgdirlen != NULL)
+    DeallocateP(lp.rgdirlen);
+  if (lp.rgOB != NULL)
+    DeallocateP(lp.rgOB);
+  if (lp.rgpow != NULL)
+    DeallocateP(lp.rgpow);
+  if (lp.rgcasp != NULL)
+    DeallocateP(lp.rgcasp);
+  if (rglpr != NULL)
+    DeallocateP(rglpr);
+}
+
+
 // Display locations of all midpoints between objects in the relationship
 // comparison chart, one per line, in sorted zodiac order from zero Aries
 // onward, as specified with the -r0 -m switch combination.
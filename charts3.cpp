@@ -403,6 +403,562 @@ int CheckSignChange(InDayInfo *pid, int i, int div, real divsiz, int month, int
   return occurcount;
 }
 
+// Return how far the second object of an event is past its exact angle
+// from the first, at the given fraction of the way through the segment. To
+// do this, compute just the two objects, with everything else restricted.
+
+real REventOffset(CONST EventRoot *per, real g)
+{
+  byte ignoreSav[objMax];
+  real hr, pos1;
+  long jd;
+  int mon, day, yea, i;
+
+  // Segments may run past the end of the day or month they're relative to,
+  // so get the actual date through the Julian day.
+  hr = per->hr1 + (per->hr2 - per->hr1)*g;
+  jd = MdyToJulian(per->ci.mon, per->ci.day, per->ci.yea) +
+    (long)RFloor(hr / 24.0);
+  hr -= RFloor(hr / 24.0) * 24.0;
+  JulianToMdy((real)jd, &mon, &day, &yea);
+  SetCI(ciCore, mon, day, yea, hr, per->ci.dst, per->ci.zon, per->ci.lon,
+    per->ci.lat);
+
+  CopyRgb(ignore, ignoreSav, sizeof(ignore));
+  for (i = 0; i < objMax; i++)
+    ignore[i] = i != per->obj1 && i != per->obj2 && i != us.objCenter;
+  if (!FCastObjectsOnly())
+    CastChart(-1);
+  CopyRgb(ignoreSav, ignore, sizeof(ignore));
+  pos1 = per->obj1 >= 0 ? planet[per->obj1] : per->pos1;
+  return MinDifference(Mod(pos1 + per->angle), planet[per->obj2]);
+}
+
+
+// Given the positions of the two objects of an aspect at the start and end
+// of a segment, and the linear estimate g of when within the segment the
+// aspect is exact, solve for the exact time by the Illinois form of false
+// position, which keeps the root bracketed. Return the refined fraction of
+// the segment, or g unchanged if the event can't be refined.
+
+real RRefineEvent(EventRoot *per, real pos1a, real pos1b, real pos2a,
+  real pos2b, real angle, real g)
+{
+  real g1 = 0.0, g2 = 1.0, y1, y2, y, gT;
+  int nSide = 0, i;
+
+  if (per->obj2 > oNorm || per->obj1 > oNorm || !FBetween(g, 0.0, 1.0))
+    return g;
+
+  // Figure out which side of the first object the aspect is on, which is
+  // the one where the offset changes sign over a short distance.
+
+  for (i = 0; i < 2; i++) {
+    per->angle = i ? -angle : angle;
+    y1 = MinDifference(Mod(pos1a + per->angle), pos2a);
+    y2 = MinDifference(Mod(pos1b + per->angle), pos2b);
+    if (RSgn(y1) != RSgn(y2) && RAbs(y1) < rDegQuad && RAbs(y2) < rDegQuad)
+      break;
+  }
+  if (i >= 2)
+    return g;
+
+  // Each step narrows the bracket, halving the weight of an endpoint kept
+  // twice in a row so convergence stays faster than bisection.
+
+  for (i = 0; i < 16; i++) {
+    y = REventOffset(per, g);
+    if (y == 0.0)
+      break;
+    if (RSgn(y) == RSgn(y1)) {
+      g1 = g; y1 = y;
+      if (nSide < 0)
+        y2 /= 2.0;
+      nSide = -1;
+    } else {
+      g2 = g; y2 = y;
+      if (nSide > 0)
+        y1 /= 2.0;
+      nSide = 1;
+    }
+    gT = (g1*y2 - g2*y1) / (y2 - y1);
+    if (RAbs(gT - g) * (per->hr2 - per->hr1) < 1.0/36000.0) {
+      g = gT;
+      break;
+    }
+    g = gT;
+  }
+  return g;
+}
+
+
+// Set up a schedule used by the in-day and transit searches to skip checking
+// an object pair in segments in which it can't possibly make an aspect, or
+// an object in segments in which it can't change sign. The schedule is
+// driven by how far objects actually move between charts cast. The in-day
+// search still casts every segment, since stations and latitude and distance
+// events are found from each segment's values. fFixed1 means the first
+// object of each pair is in a natal chart and doesn't move. Return false if
+// the schedule can't be used, in which case every pair should be checked in
+// every segment.
+
+flag FInitEventSchedule(EventSchedule *pes, flag fFixed1)
+{
+  pes->fFixed1 = fFixed1;
+  pes->rgDue = NULL;
+
+  // Only longitude aspects are scheduled, since parallels don't have a
+  // simple relationship between how far objects move and the aspect angle.
+  if (us.fParallel)
+    return fFalse;
+  pes->rgDue = RgAllocate(objMax * objMax, real, "event schedule");
+  if (pes->rgDue == NULL)
+    return fFalse;
+  ResetEventSchedule(pes);
+  return fTrue;
+}
+
+
+// Start a schedule over, so every pair and object is checked in the next
+// segment, e.g. when a search jumps to the start of a new month.
+
+void ResetEventSchedule(EventSchedule *pes)
+{
+  ClearB((pbyte)pes->rgMove, sizeof(pes->rgMove));
+  ClearB((pbyte)pes->rgDueSign, sizeof(pes->rgDueSign));
+  ClearB((pbyte)pes->rgDue, sizeof(real) * objMax * objMax);
+  pes->divCast = 0;
+}
+
+
+// Add how far each object moved over the segment between the charts in
+// cp1 and cp2 to its running total. This uses the positions actually cast
+// rather than extrapolating from each object's velocity, so that an object
+// speeding up or leaving a station can never be skipped past an event.
+
+void AdvanceEventSchedule(EventSchedule *pes)
+{
+  int i;
+
+  for (i = 0; i < objMax; i++)
+    pes->rgMove[i] += MinDistance(cp1.obj[i], cp2.obj[i]);
+}
+
+
+// Return whether aspects between two objects need to be checked in the
+// present segment. If so, given their positions at the end of the segment,
+// schedule the next check for when the pair could first have moved far
+// enough to reach the angle of any aspect. Until then, the separation of the
+// pair stays on the same side of every aspect angle at each segment's start
+// and end, so no aspect can be detected. Slow pairs far from an aspect
+// will go many segments without being checked.
+
+flag FEventDue(EventSchedule *pes, int obj1, int obj2, real pos1, real pos2,
+  int nAsp)
+{
+  real *pr = &pes->rgDue[obj1*objMax + obj2], rMove, rSep, rGap;
+  int k;
+
+  rMove = pes->rgMove[obj2] + (pes->fFixed1 ? 0.0 : pes->rgMove[obj1]);
+  if (rMove < *pr)
+    return fFalse;
+
+  // Limit the gap, so neither object can move far enough to wrap around the
+  // zodiac relative to the other before being checked again.
+  rSep = MinDistance(pos1, pos2);
+  rGap = rDegQuad / 2.0;
+  for (k = 1; k <= nAsp; k++)
+    if (!FIgnoreA(k))
+      rGap = Min(rGap, RAbs(rSep - MinDistance(0.0, rAspAngle[k])));
+  *pr = rMove + rGap - rSmall;
+  return fTrue;
+}
+
+
+// Return whether an object needs to be checked for a sign or degree change
+// in the present segment, scheduling the next check like FEventDue() does
+// for the nearest boundary. The irregular boundaries of decans and terms
+// aren't scheduled, and are always checked.
+
+flag FSignDue(EventSchedule *pes, int obj, real pos)
+{
+  real rSize, r;
+
+  if (pes == NULL || pes->rgDue == NULL || us.fListDecan)
+    return fTrue;
+  if (pes->rgMove[obj] < pes->rgDueSign[obj])
+    return fFalse;
+  rSize = us.nSignDiv > 1 ? rDegSign / (real)us.nSignDiv : rDegSign;
+  r = pos - (real)(int)(pos / rSize) * rSize;
+  r = Min(Min(r, rSize - r), rDegQuad / 2.0);
+  pes->rgDueSign[obj] = pes->rgMove[obj] + r - rSmall;
+  return fTrue;
+}
+
+
+// Cast charts for the segments of one day and store the aspects and events
+// found within it in the array pid, sorted by time, stopping after maxinday
+// of them. Return how many were found. This is a subprocedure of
+// ChartInDaySearch(), and may be called on several threads at once.
+
+int NInDayScan(InDayInfo *pid, int maxinday, int mon0, int day0, int yea0,
+  int division, flag fProg)
+{
+  InDayInfo idT;
+  EventRoot er;
+  EventSchedule es;
+  int occurcount = 0, div, i, j, k, s1, s2;
+  real divsiz, d1, d2, e1, e2, f1, f2, g;
+  flag fSched;
+
+  divsiz = 24.0 / (real)division*60.0;
+  fSched = FInitEventSchedule(&es, fFalse);
+
+  // Cast chart for beginning of day and store it for future use.
+
+  SetCI(ciCore, mon0, day0, yea0, 0.0, Dst, Zon, Lon, Lat);
+  us.fProgress = fProg;
+  if (fProg) {
+    is.JDp = MdytszToJulian(mon0, day0, yea0, 0.0, Dst, Zon);
+    ciCore = ciMain;
+  }
+  CastChart(-1);
+  cp2 = cp0;
+
+  // Now divide the day into segments and search each segment in turn.
+  // More segments is slower, but has slightly better time accuracy.
+
+  for (div = 1; div <= division; div++) {
+
+    // Cast the chart for the ending time of the present segment. The
+    // beginning time chart is copied from the previous end time chart.
+
+    SetCI(ciCore, mon0, day0, yea0,
+      24.0*(real)div/(real)division, Dst, Zon, Lon, Lat);
+    if (fProg) {
+      is.JDp = MdytszToJulian(mon0, day0, yea0, TT, Dst, Zon);
+      ciCore = ciMain;
+    }
+    CastChart(-1);
+    cp1 = cp2; cp2 = cp0;
+    if (fSched)
+      AdvanceEventSchedule(&es);
+    if (us.fInDayRefine) {
+      SetCI(er.ci, mon0, day0, yea0, 0.0, Dst, Zon, Lon, Lat);
+      er.hr1 = 24.0*(real)(div-1)/(real)division;
+      er.hr2 = 24.0*(real)div/(real)division;
+    }
+
+    // Now search through the present segment for anything exciting.
+
+    for (i = 0; i <= is.nObj; i++)
+      if (!FIgnore(i) && (fProg || us.fGraphAll || FThing(i))) {
+      s1 = SFromZ(cp1.obj[i])-1;
+      s2 = SFromZ(cp2.obj[i])-1;
+
+      /* Does the current planet make a sign or degree change? */
+
+      if (!us.fIgnoreSign && occurcount < MAXINDAY &&
+        FSignDue(&es, i, cp2.obj[i]))
+        occurcount += CheckSignChange(&pid[occurcount], i, div, divsiz, mon0, day0, yea0);
+
+      // Does the current planet go retrograde or direct?
+
+      if (!us.fIgnoreDir && (cp1.dir[i] < 0.0) != (cp2.dir[i] < 0.0) &&
+          FAllow(i) && occurcount < maxinday) {
+        pid[occurcount].source = i;
+        pid[occurcount].aspect = aDir;
+        pid[occurcount].dest = cp2.dir[i] < 0.0;
+        pid[occurcount].time = RAbs(cp1.dir[i])/(RAbs(cp1.dir[i])+
+                                                 RAbs(cp2.dir[i]))*divsiz + (real)(div-1)*divsiz;
+        pid[occurcount].pos1 = pid[occurcount].pos2 =
+          RAbs(cp1.dir[i])/(RAbs(cp1.dir[i])+RAbs(cp2.dir[i])) *
+          (cp2.obj[i]-cp1.obj[i]) + cp1.obj[i];
+        pid[occurcount].ret1 = pid[occurcount].ret2 = 0.0;
+        pid[occurcount].mon = mon0;
+        pid[occurcount].day = day0;
+        pid[occurcount].yea = yea0;
+        occurcount++;
+      }
+
+      // Does the current planet reach maximum or minimum latitude?
+
+      if (!us.fIgnoreDiralt && (cp1.diralt[i] < 0.0) != (cp2.diralt[i] < 0.0)
+          && FAllow(i) && occurcount < maxinday) {
+        pid[occurcount].source = i;
+        pid[occurcount].aspect = aAlt;
+        pid[occurcount].dest = cp2.diralt[i] < 0.0;
+        pid[occurcount].time = RAbs(cp1.diralt[i])/(RAbs(cp1.diralt[i])+
+                                                    RAbs(cp2.diralt[i]))*divsiz + (real)(div-1)*divsiz;
+        pid[occurcount].pos1 = pid[occurcount].pos2 =
+          RAbs(cp1.diralt[i])/(RAbs(cp1.diralt[i])+RAbs(cp2.diralt[i])) *
+          (cp2.alt[i]-cp1.alt[i]) + cp1.alt[i];
+        pid[occurcount].ret1 = cp1.dir[i]; pid[occurcount].ret2 = cp2.dir[i];
+        pid[occurcount].mon = mon0;
+        pid[occurcount].day = day0;
+        pid[occurcount].yea = yea0;
+        occurcount++;
+      }
+
+      // Does the current planet reach maximum or minimum distance?
+
+      if (!us.fIgnoreDirlen && (cp1.dirlen[i] < 0.0) != (cp2.dirlen[i] < 0.0)
+          && FAllow(i) && occurcount < maxinday) {
+        pid[occurcount].source = i;
+        pid[occurcount].aspect = aLen;
+        pid[occurcount].dest = (cp2.dirlen[i] < 0.0);
+        pid[occurcount].time = RAbs(cp1.dirlen[i])/(RAbs(cp1.dirlen[i])+
+                                                    RAbs(cp2.dirlen[i]))*divsiz + (real)(div-1)*divsiz;
+        pid[occurcount].pos1 = pid[occurcount].pos2 =
+          RAbs(cp1.dirlen[i])/(RAbs(cp1.dirlen[i])+RAbs(cp2.dirlen[i])) *
+          (cp2.obj[i]-cp1.obj[i]) + cp1.obj[i];
+        pid[occurcount].ret1 = cp1.dir[i]; pid[occurcount].ret2 = cp2.dir[i];
+        pid[occurcount].mon = mon0;
+        pid[occurcount].day = day0;
+        pid[occurcount].yea = yea0;
+        occurcount++;
+      }
+
+      // Does the current planet cross zero latitude?
+
+      if (!us.fIgnoreAlt0 && ((cp1.alt[i] < 0.0 && cp2.alt[i] >= 0.0) ||
+                              (cp1.alt[i] >= 0.0 && cp2.alt[i] < 0.0)) &&
+          FAllow(i) && occurcount < maxinday) {
+        pid[occurcount].source = i;
+        pid[occurcount].aspect = aNod;
+        pid[occurcount].dest = (cp1.alt[i] >= 0.0);
+        pid[occurcount].time = cp1.alt[i]/(cp1.alt[i]-cp2.alt[i])*divsiz +
+          (real)(div-1)*divsiz;
+        pid[occurcount].pos1 = pid[occurcount].pos2 =
+          Mod(cp1.obj[i] + cp1.alt[i]/(cp1.alt[i]-cp2.alt[i]) *
+              MinDifference(cp1.obj[i], cp2.obj[i]));
+        pid[occurcount].ret1 = cp1.dir[i]; pid[occurcount].ret2 = cp2.dir[i];
+        pid[occurcount].mon = mon0;
+        pid[occurcount].day = day0;
+        pid[occurcount].yea = yea0;
+        occurcount++;
+      }
+
+      // Now search for anything making an aspect to the current planet.
+
+      for (j = i+1; j <= is.nObj; j++)
+        if (!FIgnore(j) && (fProg || us.fGraphAll || FThing(j))) {
+          if (!us.fParallel) {
+
+            // Skip the pair if it can't have reached any aspect yet.
+
+            if (!fSched ||
+              FEventDue(&es, i, j, cp2.obj[i], cp2.obj[j], us.nAsp))
+            for (k = 1; k <= us.nAsp; k++) if (FAcceptAspect(i, -k, j)) {
+                d1 = cp1.obj[i]; d2 = cp2.obj[i];
+                e1 = cp1.obj[j]; e2 = cp2.obj[j];
+                if (MinDistance(d1, d2) < MinDistance(e1, e2)) {
+                  SwapR(&d1, &e1);
+                  SwapR(&d2, &e2);
+                }
+
+                // Search each potential aspect in turn. First subtract the size
+                // of the aspect from the angular difference, so can then treat it
+                // like a conjunction.
+
+                if (MinDistance(e1, Mod(d1-rAspAngle[k])) <
+                    MinDistance(e2, Mod(d2+rAspAngle[k]))) {
+                  e1 = Mod(e1+rAspAngle[k]);
+                  e2 = Mod(e2+rAspAngle[k]);
+                } else {
+                  e1 = Mod(e1-rAspAngle[k]);
+                  e2 = Mod(e2-rAspAngle[k]);
+                }
+
+                // Check to see if the aspect actually occurs during this segment,
+                // making sure to take into account if one or both planets are
+                // retrograde or if they cross the Aries point.
+
+                f1 = e1-d1;
+                if (RAbs(f1) > rDegHalf)
+                  f1 -= RSgn(f1)*rDegMax;
+                f2 = e2-d2;
+                if (RAbs(f2) > rDegHalf)
+                  f2 -= RSgn(f2)*rDegMax;
+                if (MinDistance(Midpoint(d1, d2), Midpoint(e1, e2)) < rDegQuad &&
+                    RSgn(f1) != RSgn(f2) && occurcount < maxinday) {
+                  pid[occurcount].source = i;
+                  pid[occurcount].aspect = k;
+                  pid[occurcount].dest = j;
+                  pid[occurcount].mon = mon0;
+                  pid[occurcount].day = day0;
+                  pid[occurcount].yea = yea0;
+
+                  // Horray! The aspect occurs sometime during the interval. Now
+                  // just have to solve an equation in two variables to find out
+                  // where their "lines" of motion cross, i.e. the aspect's time.
+
+                  f1 = d2-d1;
+                  if (RAbs(f1) > rDegHalf)
+                    f1 -= RSgn(f1)*rDegMax;
+                  f2 = e2-e1;
+                  if (RAbs(f2) > rDegHalf)
+                    f2 -= RSgn(f2)*rDegMax;
+                  g = (RAbs(d1-e1) > rDegHalf ?
+                       (d1-e1)-RSgn(d1-e1)*rDegMax : d1-e1)/(f2-f1);
+                  if (us.fInDayRefine && !fProg) {
+                    er.obj1 = i; er.obj2 = j;
+                    g = RRefineEvent(&er, cp1.obj[i], cp2.obj[i],
+                      cp1.obj[j], cp2.obj[j], rAspAngle[k], g);
+                  }
+                  pid[occurcount].time = g*divsiz + (real)(div-1)*divsiz;
+                  pid[occurcount].pos1 = Mod(cp1.obj[i] +
+                                             RSgn(cp2.obj[i]-cp1.obj[i])*
+                                             (RAbs(cp2.obj[i]-cp1.obj[i]) > rDegHalf ? -1 : 1)*
+                                             RAbs(g)*MinDistance(cp1.obj[i], cp2.obj[i]));
+                  pid[occurcount].pos2 = Mod(cp1.obj[j] +
+                                             RSgn(cp2.obj[j]-cp1.obj[j])*
+                                             (RAbs(cp2.obj[j]-cp1.obj[j]) > rDegHalf ? -1 : 1)*
+                                             RAbs(g)*MinDistance(cp1.obj[j], cp2.obj[j]));
+                  pid[occurcount].ret1 = (cp1.dir[i] + cp2.dir[i]) / 2.0;
+                  pid[occurcount].ret2 = (cp1.dir[j] + cp2.dir[j]) / 2.0;
+                  occurcount++;
+                }
+              }
+
+          } else {
+
+            for (k = 1; k <= Min(us.nAsp, aOpp); k++)
+              if (FAcceptAspect(i, -k, j)) {
+
+                d1 = cp1.alt[i]; d2 = cp2.alt[i];
+                e1 = cp1.alt[j]; e2 = cp2.alt[j];
+                if (!us.fEquator2 && !us.fParallel2) {
+                  // If have ecliptic latitude and want declination, convert.
+                  g = cp1.obj[i]; EclToEqu(&g, &d1);
+                  g = cp2.obj[i]; EclToEqu(&g, &d2);
+                  g = cp1.obj[j]; EclToEqu(&g, &e1);
+                  g = cp2.obj[j]; EclToEqu(&g, &e2);
+                } else if (us.fEquator2 && us.fParallel2) {
+                  // If have equatorial declination and want latitude, convert.
+                  g = cp1.obj[i]; EquToEcl(&g, &d1);
+                  g = cp2.obj[i]; EquToEcl(&g, &d2);
+                  g = cp1.obj[j]; EquToEcl(&g, &e1);
+                  g = cp2.obj[j]; EquToEcl(&g, &e2);
+                }
+
+                // Search each potential aspect in turn. Negate the sign of the
+                // aspect if needed, so can then treat it like a parallel.
+
+                if (k == aOpp) {
+                  neg(e1);
+                  neg(e2);
+                }
+
+                // Check if the aspect actually occurs during this segment, making
+                // sure to take into account if one or both planets are retrograde.
+
+                f1 = e1-d1;
+                f2 = e2-d2;
+                if (RSgn(f1) != RSgn(f2) && occurcount < maxinday) {
+                  pid[occurcount].source = i;
+                  pid[occurcount].aspect = k;
+                  pid[occurcount].dest = j;
+                  pid[occurcount].mon = mon0;
+                  pid[occurcount].day = day0;
+                  pid[occurcount].yea = yea0;
+
+                  // Horray! The aspect occurs sometime during the interval. Now
+                  // just have to solve an equation in two variables to find out
+                  // where their "lines" of motion cross, i.e. the aspect's time.
+
+                  f1 = d2-d1;
+                  f2 = e2-e1;
+                  g = (d1-e1)/(f2-f1);
+                  if (k == aOpp) {
+                    neg(e1);
+                    neg(e2);
+                  }
+                  pid[occurcount].time = g*divsiz + (real)(div-1)*divsiz;
+                  pid[occurcount].pos1 = d1 + (d2 - d1)*g;
+                  pid[occurcount].pos2 = e1 + (e2 - e1)*g;
+                  pid[occurcount].ret1 = (cp1.diralt[i] + cp2.diralt[i]) / 2.0;
+                  pid[occurcount].ret2 = (cp1.diralt[j] + cp2.diralt[j]) / 2.0;
+                  occurcount++;
+                }
+              }
+          } // us.fParallel
+
+          // Check for planet pairs equidistant from each other.
+
+          if (!us.fIgnoreDisequ) {
+            d1 = cp1.dist[i]; d2 = cp2.dist[i];
+            e1 = cp1.dist[j]; e2 = cp2.dist[j];
+            f1 = e1-d1; f2 = e2-d2;
+            if (RSgn(f1) != RSgn(f2) && occurcount < maxinday) {
+              pid[occurcount].source = i;
+              pid[occurcount].aspect = aDis;
+              pid[occurcount].dest = j;
+              pid[occurcount].mon = mon0;
+              pid[occurcount].day = day0;
+              pid[occurcount].yea = yea0;
+              f1 = d2-d1; f2 = e2-e1;
+              g = (d1-e1)/(f2-f1);
+              pid[occurcount].time = g*divsiz + (real)(div-1)*divsiz;
+              pid[occurcount].pos1 = Mod(cp1.obj[i] +
+                                         RSgn(cp2.obj[i]-cp1.obj[i])*
+                                         (RAbs(cp2.obj[i]-cp1.obj[i]) > rDegHalf ? -1 : 1)*
+                                         RAbs(g)*MinDistance(cp1.obj[i], cp2.obj[i]));
+              pid[occurcount].pos2 = Mod(cp1.obj[j] +
+                                         RSgn(cp2.obj[j]-cp1.obj[j])*
+                                         (RAbs(cp2.obj[j]-cp1.obj[j]) > rDegHalf ? -1 : 1)*
+                                         RAbs(g)*MinDistance(cp1.obj[j], cp2.obj[j]));
+              pid[occurcount].ret1 = (cp1.dir[i] + cp2.dir[i]) / 2.0;
+              pid[occurcount].ret2 = (cp1.dir[j] + cp2.dir[j]) / 2.0;
+              occurcount++;
+            }
+          }
+        }
+      } // i
+  } // div
+
+  if (fSched)
+    DeallocateP(es.rgDue);
+
+  // After all the aspects and evemts in the day have been located, sort
+  // them by time at which they occur, so can print them in order.
+
+  for (i = 1; i < occurcount; i++) {
+    j = i-1;
+    while (j >= 0 && pid[j].time > pid[j+1].time) {
+      idT = pid[j]; pid[j] = pid[j+1]; pid[j+1] = idT;
+      j--;
+    }
+  }
+  return occurcount;
+}
+
+
+#ifdef THREADS
+// Block of days searched in parallel by ChartInDaySearch(), with room for
+// MAXINDAY events found in each day.
+
+typedef struct _InDayBlock {
+  CONST int *rgday;  // Month, day, and year of each day in the block
+  InDayInfo *rgid;   // Events found in each day
+  int *rgcid;        // Number of events found in each day
+  int division;      // Number of segments to divide each day into
+  flag fProg;        // Whether searching a progressed chart
+} InDayBlock;
+
+// Search one day of a block. Called by RunThreadJobs() on worker threads.
+
+void InDayScanJob(int ijob, void *pv)
+{
+  InDayBlock *pib = (InDayBlock *)pv;
+  CONST int *pday = &pib->rgday[ijob*3];
+
+  pib->rgcid[ijob] = NInDayScan(&pib->rgid[ijob*MAXINDAY], MAXINDAY,
+    pday[0], pday[1], pday[2], pib->division, pib->fProg);
+}
+#endif
+
+
 // Search through a day or longer period, and print out the times of exact
 // aspects among planets during that day, as specified with the -d switch,
 // as well as times when planets changes sign or direction. To do this, cast
@@ -411,12 +967,17 @@ int CheckSignChange(InDayInfo *pid, int i, int div, real divsiz, int month, int
 
 void ChartInDaySearch(flag fProg)
 {
-  InDayInfo id[MAXINDAY], idT, *pid = id;
-  int yea0, yea1, yea2, mon0, mon1, mon2, day0, day1, day2, counttotal = 0,
-    occurcount, maxinday = MAXINDAY, division, div, divSign,
-    i, j, k, l, s1, s2;
-  real divsiz, d1, d2, e1, e2, f1, f2, g;
-  flag fYear, fVoid, fPrint = fTrue;
+  InDayInfo id[MAXINDAY], *pid = id;
+  int *rgday, cday = 0, iday, yea0, yea1, yea2, mon0, mon1, mon2, day0, day1,
+    day2, counttotal = 0, occurcount, maxinday, division, i, j;
+  flag fYear, fVoid, fPrint = fTrue, fCheb = fFalse;
+#ifdef SWISS
+  real jd1, jd2;
+#endif
+#ifdef THREADS
+  InDayBlock ib;
+  int cthread, cdayBlock = 0, iblock = 0, cblock = 0;
+#endif
 
   // If parameter 'fProg' is set, look for changes in a progressed chart.
 
@@ -426,8 +987,6 @@ void ChartInDaySearch(flag fProg)
   fYear = us.fInDayMonth && us.fInDayYear;
   fVoid = !FIgnore(oMoo) && !us.fIgnoreSign && us.fInDayMonth;
   division = (fYear || fProg) ? (us.nDivision + 9) / 10 : us.nDivision;
-  divsiz = 24.0 / (real)division*60.0;
-  divSign = cSign * us.nSignDiv;
    if (us.fListAuto)
     is.cci = 0;
 
@@ -440,6 +999,10 @@ void ChartInDaySearch(flag fProg)
     else
       yea2 += (us.nEphemYears - 1);
   }
+  rgday = (int *)PAllocate(sizeof(int) * 3 * (yea2 - yea1 + 1) *
+    (fYear ? 12 : 1) * (us.fInDayMonth ? 31 : 1), "day list");
+  if (rgday == NULL)
+    return;
   for (yea0 = yea1; yea0 <= yea2; yea0++) {
 
   // If -dy in effect, then search through the whole year, month by month.
@@ -449,7 +1012,7 @@ void ChartInDaySearch(flag fProg)
   } else
     mon1 = mon2 = !fProg ? Mon : MonT;
 
-  // Start searching the month or months in question for exciting events.
+  // List the days of the month or months in question, to be searched below.
 
   for (mon0 = mon1; mon0 <= mon2; mon0++) {
     if (us.fInDayMonth) {
@@ -457,313 +1020,76 @@ void ChartInDaySearch(flag fProg)
       day2 = DayInMonth(mon0, yea0);
     } else
       day1 = day2 = !fProg ? Day : DayT;
-
-  // Start searching the day or days in question for exciting events.
-
-  for (day0 = day1; day0 <= day2; day0 = AddDay(mon0, day0, yea0, 1)) {
-    occurcount = 0;
-    maxinday = MAXINDAY - (int)(pid - id);
-
-    // Cast chart for beginning of day and store it for future use.
-
-    SetCI(ciCore, mon0, day0, yea0, 0.0, Dst, Zon, Lon, Lat);
-    us.fProgress = fProg;
-    if (fProg) {
-      is.JDp = MdytszToJulian(mon0, day0, yea0, 0.0, Dst, Zon);
-      ciCore = ciMain;
+    for (day0 = day1; day0 <= day2; day0 = AddDay(mon0, day0, yea0, 1)) {
+      rgday[cday*3] = mon0; rgday[cday*3+1] = day0; rgday[cday*3+2] = yea0;
+      cday++;
     }
-    CastChart(-1);
-    cp2 = cp0;
-
-    // Now divide the day into segments and search each segment in turn.
-    // More segments is slower, but has slightly better time accuracy.
-
-    for (div = 1; div <= division; div++) {
-
-      // Cast the chart for the ending time of the present segment. The
-      // beginning time chart is copied from the previous end time chart.
-
-      SetCI(ciCore, mon0, day0, yea0,
-        24.0*(real)div/(real)division, Dst, Zon, Lon, Lat);
-      if (fProg) {
-        is.JDp = MdytszToJulian(mon0, day0, yea0, TT, Dst, Zon);
-        ciCore = ciMain;
-      }
-      CastChart(-1);
-      cp1 = cp2; cp2 = cp0;
-
-      // Now search through the present segment for anything exciting.
-
-      for (i = 0; i <= is.nObj; i++)
-        if (!FIgnore(i) && (fProg || us.fGraphAll || FThing(i))) {
-        s1 = SFromZ(cp1.obj[i])-1;
-        s2 = SFromZ(cp2.obj[i])-1;
-
-	/* Does the current planet make a sign or degree change? */
-	
-        if (!us.fIgnoreSign && occurcount < MAXINDAY)
-	  occurcount += CheckSignChange(&pid[occurcount], i, div, divsiz, mon0, day0, yea0);
-	
-        // Does the current planet go retrograde or direct?
-
-        if (!us.fIgnoreDir && (cp1.dir[i] < 0.0) != (cp2.dir[i] < 0.0) &&
-	    FAllow(i) && occurcount < maxinday) {
-          pid[occurcount].source = i;
-          pid[occurcount].aspect = aDir;
-          pid[occurcount].dest = cp2.dir[i] < 0.0;
-          pid[occurcount].time = RAbs(cp1.dir[i])/(RAbs(cp1.dir[i])+
-						   RAbs(cp2.dir[i]))*divsiz + (real)(div-1)*divsiz;
-          pid[occurcount].pos1 = pid[occurcount].pos2 =
-            RAbs(cp1.dir[i])/(RAbs(cp1.dir[i])+RAbs(cp2.dir[i])) *
-            (cp2.obj[i]-cp1.obj[i]) + cp1.obj[i];
-          pid[occurcount].ret1 = pid[occurcount].ret2 = 0.0;
-          pid[occurcount].mon = mon0;
-          pid[occurcount].day = day0;
-          pid[occurcount].yea = yea0;
-          occurcount++;
-        }
-
-        // Does the current planet reach maximum or minimum latitude?
-
-        if (!us.fIgnoreDiralt && (cp1.diralt[i] < 0.0) != (cp2.diralt[i] < 0.0)
-	    && FAllow(i) && occurcount < maxinday) {
-          pid[occurcount].source = i;
-          pid[occurcount].aspect = aAlt;
-          pid[occurcount].dest = cp2.diralt[i] < 0.0;
-          pid[occurcount].time = RAbs(cp1.diralt[i])/(RAbs(cp1.diralt[i])+
-						      RAbs(cp2.diralt[i]))*divsiz + (real)(div-1)*divsiz;
-          pid[occurcount].pos1 = pid[occurcount].pos2 =
-            RAbs(cp1.diralt[i])/(RAbs(cp1.diralt[i])+RAbs(cp2.diralt[i])) *
-            (cp2.alt[i]-cp1.alt[i]) + cp1.alt[i];
-          pid[occurcount].ret1 = cp1.dir[i]; pid[occurcount].ret2 = cp2.dir[i];
-          pid[occurcount].mon = mon0;
-          pid[occurcount].day = day0;
-          pid[occurcount].yea = yea0;
-          occurcount++;
-        }
+  } // mon0
+  } // yea0
 
-        // Does the current planet reach maximum or minimum distance?
-
-        if (!us.fIgnoreDirlen && (cp1.dirlen[i] < 0.0) != (cp2.dirlen[i] < 0.0)
-	    && FAllow(i) && occurcount < maxinday) {
-          pid[occurcount].source = i;
-          pid[occurcount].aspect = aLen;
-          pid[occurcount].dest = (cp2.dirlen[i] < 0.0);
-          pid[occurcount].time = RAbs(cp1.dirlen[i])/(RAbs(cp1.dirlen[i])+
-						      RAbs(cp2.dirlen[i]))*divsiz + (real)(div-1)*divsiz;
-          pid[occurcount].pos1 = pid[occurcount].pos2 =
-            RAbs(cp1.dirlen[i])/(RAbs(cp1.dirlen[i])+RAbs(cp2.dirlen[i])) *
-            (cp2.obj[i]-cp1.obj[i]) + cp1.obj[i];
-          pid[occurcount].ret1 = cp1.dir[i]; pid[occurcount].ret2 = cp2.dir[i];
-          pid[occurcount].mon = mon0;
-          pid[occurcount].day = day0;
-          pid[occurcount].yea = yea0;
-          occurcount++;
-        }
+#ifdef SWISS
+  // Every chart cast by the search is within the days being searched.
+  if (!fProg) {
+    jd1 = MdytszToJulian(rgday[0], rgday[1], rgday[2], 0.0, Dst, Zon);
+    jd2 = MdytszToJulian(rgday[cday*3-3], rgday[cday*3-2], rgday[cday*3-1],
+      24.0, Dst, Zon);
+    fCheb = FChebBegin(jd1, jd2);
+    SwissPreload(jd1, jd2);
+  }
+#endif
 
-        // Does the current planet cross zero latitude?
+#ifdef THREADS
+  // If casting on several threads, search blocks of days ahead of time in
+  // parallel. The last day is always searched here, so the chart variables
+  // are left just like a one thread search would leave them.
+
+  cthread = NThreadCount();
+  ib.rgid = NULL;
+  if (cthread > 1 && cday > 2) {
+    cdayBlock = Min(cthread << 4, cday-1);
+    ib.rgid = (InDayInfo *)PAllocate(sizeof(InDayInfo) * MAXINDAY * cdayBlock,
+      "day events");
+    ib.rgcid = (int *)PAllocate(sizeof(int) * cdayBlock, "day events");
+    if (ib.rgid == NULL || ib.rgcid == NULL) {
+      if (ib.rgid != NULL)
+        DeallocateP(ib.rgid);
+      if (ib.rgcid != NULL)
+        DeallocateP(ib.rgcid);
+      ib.rgid = NULL;
+    }
+    ib.division = division;
+    ib.fProg = fProg;
+  }
+#endif
 
-        if (!us.fIgnoreAlt0 && ((cp1.alt[i] < 0.0 && cp2.alt[i] >= 0.0) ||
-				(cp1.alt[i] >= 0.0 && cp2.alt[i] < 0.0)) &&
-	    FAllow(i) && occurcount < maxinday) {
-          pid[occurcount].source = i;
-          pid[occurcount].aspect = aNod;
-          pid[occurcount].dest = (cp1.alt[i] >= 0.0);
-          pid[occurcount].time = cp1.alt[i]/(cp1.alt[i]-cp2.alt[i])*divsiz +
-            (real)(div-1)*divsiz;
-          pid[occurcount].pos1 = pid[occurcount].pos2 =
-            Mod(cp1.obj[i] + cp1.alt[i]/(cp1.alt[i]-cp2.alt[i]) *
-		MinDifference(cp1.obj[i], cp2.obj[i]));
-          pid[occurcount].ret1 = cp1.dir[i]; pid[occurcount].ret2 = cp2.dir[i];
-          pid[occurcount].mon = mon0;
-          pid[occurcount].day = day0;
-          pid[occurcount].yea = yea0;
-          occurcount++;
-        }
+  // Start searching the day or days in question for exciting events.
 
-        // Now search for anything making an aspect to the current planet.
-
-        for (j = i+1; j <= is.nObj; j++)
-          if (!FIgnore(j) && (fProg || us.fGraphAll || FThing(j))) {
-	    if (!us.fParallel) {
-
-	      for (k = 1; k <= us.nAsp; k++) if (FAcceptAspect(i, -k, j)) {
-		  d1 = cp1.obj[i]; d2 = cp2.obj[i];
-		  e1 = cp1.obj[j]; e2 = cp2.obj[j];
-		  if (MinDistance(d1, d2) < MinDistance(e1, e2)) {
-		    SwapR(&d1, &e1);
-		    SwapR(&d2, &e2);
-		  }
-
-		  // Search each potential aspect in turn. First subtract the size
-		  // of the aspect from the angular difference, so can then treat it
-		  // like a conjunction.
-
-		  if (MinDistance(e1, Mod(d1-rAspAngle[k])) <
-		      MinDistance(e2, Mod(d2+rAspAngle[k]))) {
-		    e1 = Mod(e1+rAspAngle[k]);
-		    e2 = Mod(e2+rAspAngle[k]);
-		  } else {
-		    e1 = Mod(e1-rAspAngle[k]);
-		    e2 = Mod(e2-rAspAngle[k]);
-		  }
-
-		  // Check to see if the aspect actually occurs during this segment,
-		  // making sure to take into account if one or both planets are
-		  // retrograde or if they cross the Aries point.
-
-		  f1 = e1-d1;
-		  if (RAbs(f1) > rDegHalf)
-		    f1 -= RSgn(f1)*rDegMax;
-		  f2 = e2-d2;
-		  if (RAbs(f2) > rDegHalf)
-		    f2 -= RSgn(f2)*rDegMax;
-		  if (MinDistance(Midpoint(d1, d2), Midpoint(e1, e2)) < rDegQuad &&
-		      RSgn(f1) != RSgn(f2) && occurcount < maxinday) {
-		    pid[occurcount].source = i;
-		    pid[occurcount].aspect = k;
-		    pid[occurcount].dest = j;
-		    pid[occurcount].mon = mon0;
-		    pid[occurcount].day = day0;
-		    pid[occurcount].yea = yea0;
-
-		    // Horray! The aspect occurs sometime during the interval. Now
-		    // just have to solve an equation in two variables to find out
-		    // where their "lines" of motion cross, i.e. the aspect's time.
-
-		    f1 = d2-d1;
-		    if (RAbs(f1) > rDegHalf)
-		      f1 -= RSgn(f1)*rDegMax;
-		    f2 = e2-e1;
-		    if (RAbs(f2) > rDegHalf)
-		      f2 -= RSgn(f2)*rDegMax;
-		    g = (RAbs(d1-e1) > rDegHalf ?
-			 (d1-e1)-RSgn(d1-e1)*rDegMax : d1-e1)/(f2-f1);
-		    pid[occurcount].time = g*divsiz + (real)(div-1)*divsiz;
-		    pid[occurcount].pos1 = Mod(cp1.obj[i] +
-					       RSgn(cp2.obj[i]-cp1.obj[i])*
-					       (RAbs(cp2.obj[i]-cp1.obj[i]) > rDegHalf ? -1 : 1)*
-					       RAbs(g)*MinDistance(cp1.obj[i], cp2.obj[i]));
-		    pid[occurcount].pos2 = Mod(cp1.obj[j] +
-					       RSgn(cp2.obj[j]-cp1.obj[j])*
-					       (RAbs(cp2.obj[j]-cp1.obj[j]) > rDegHalf ? -1 : 1)*
-					       RAbs(g)*MinDistance(cp1.obj[j], cp2.obj[j]));
-		    pid[occurcount].ret1 = (cp1.dir[i] + cp2.dir[i]) / 2.0;
-		    pid[occurcount].ret2 = (cp1.dir[j] + cp2.dir[j]) / 2.0;
-		    occurcount++;
-		  }
-		}
-
-	    } else {
-
-	      for (k = 1; k <= Min(us.nAsp, aOpp); k++)
-		if (FAcceptAspect(i, -k, j)) {
-
-		  d1 = cp1.alt[i]; d2 = cp2.alt[i];
-		  e1 = cp1.alt[j]; e2 = cp2.alt[j];
-		  if (!us.fEquator2 && !us.fParallel2) {
-		    // If have ecliptic latitude and want declination, convert.
-		    g = cp1.obj[i]; EclToEqu(&g, &d1);
-		    g = cp2.obj[i]; EclToEqu(&g, &d2);
-		    g = cp1.obj[j]; EclToEqu(&g, &e1);
-		    g = cp2.obj[j]; EclToEqu(&g, &e2);
-		  } else if (us.fEquator2 && us.fParallel2) {
-		    // If have equatorial declination and want latitude, convert.
-		    g = cp1.obj[i]; EquToEcl(&g, &d1);
-		    g = cp2.obj[i]; EquToEcl(&g, &d2);
-		    g = cp1.obj[j]; EquToEcl(&g, &e1);
-		    g = cp2.obj[j]; EquToEcl(&g, &e2);
-		  }
-
-		  // Search each potential aspect in turn. Negate the sign of the
-		  // aspect if needed, so can then treat it like a parallel.
-
-		  if (k == aOpp) {
-		    neg(e1);
-		    neg(e2);
-		  }
-
-		  // Check if the aspect actually occurs during this segment, making
-		  // sure to take into account if one or both planets are retrograde.
-
-		  f1 = e1-d1;
-		  f2 = e2-d2;
-		  if (RSgn(f1) != RSgn(f2) && occurcount < maxinday) {
-		    pid[occurcount].source = i;
-		    pid[occurcount].aspect = k;
-		    pid[occurcount].dest = j;
-		    pid[occurcount].mon = mon0;
-		    pid[occurcount].day = day0;
-		    pid[occurcount].yea = yea0;
-
-		    // Horray! The aspect occurs sometime during the interval. Now
-		    // just have to solve an equation in two variables to find out
-		    // where their "lines" of motion cross, i.e. the aspect's time.
-
-		    f1 = d2-d1;
-		    f2 = e2-e1;
-		    g = (d1-e1)/(f2-f1);
-		    if (k == aOpp) {
-		      neg(e1);
-		      neg(e2);
-		    }
-		    pid[occurcount].time = g*divsiz + (real)(div-1)*divsiz;
-		    pid[occurcount].pos1 = d1 + (d2 - d1)*g;
-		    pid[occurcount].pos2 = e1 + (e2 - e1)*g;
-		    pid[occurcount].ret1 = (cp1.diralt[i] + cp2.diralt[i]) / 2.0;
-		    pid[occurcount].ret2 = (cp1.diralt[j] + cp2.diralt[j]) / 2.0;
-		    occurcount++;
-		  }
-		}
-	    } // us.fParallel
-
-	    // Check for planet pairs equidistant from each other.
-
-	    if (!us.fIgnoreDisequ) {
-	      d1 = cp1.dist[i]; d2 = cp2.dist[i];
-	      e1 = cp1.dist[j]; e2 = cp2.dist[j];
-	      f1 = e1-d1; f2 = e2-d2;
-	      if (RSgn(f1) != RSgn(f2) && occurcount < maxinday) {
-		pid[occurcount].source = i;
-		pid[occurcount].aspect = aDis;
-		pid[occurcount].dest = j;
-		pid[occurcount].mon = mon0;
-		pid[occurcount].day = day0;
-		pid[occurcount].yea = yea0;
-		f1 = d2-d1; f2 = e2-e1;
-		g = (d1-e1)/(f2-f1);
-		pid[occurcount].time = g*divsiz + (real)(div-1)*divsiz;
-		pid[occurcount].pos1 = Mod(cp1.obj[i] +
-					   RSgn(cp2.obj[i]-cp1.obj[i])*
-					   (RAbs(cp2.obj[i]-cp1.obj[i]) > rDegHalf ? -1 : 1)*
-					   RAbs(g)*MinDistance(cp1.obj[i], cp2.obj[i]));
-		pid[occurcount].pos2 = Mod(cp1.obj[j] +
-					   RSgn(cp2.obj[j]-cp1.obj[j])*
-					   (RAbs(cp2.obj[j]-cp1.obj[j]) > rDegHalf ? -1 : 1)*
-					   RAbs(g)*MinDistance(cp1.obj[j], cp2.obj[j]));
-		pid[occurcount].ret1 = (cp1.dir[i] + cp2.dir[i]) / 2.0;
-		pid[occurcount].ret2 = (cp1.dir[j] + cp2.dir[j]) / 2.0;
-		occurcount++;
-	      }
-	    }
-	  }
-	} // i
-    } // div
+  for (iday = 0; iday < cday; iday++) {
+    mon0 = rgday[iday*3]; day0 = rgday[iday*3+1]; yea0 = rgday[iday*3+2];
+    maxinday = MAXINDAY - (int)(pid - id);
+#ifdef THREADS
+    if (ib.rgid != NULL && iday >= iblock + cblock && iday < cday-1) {
+      iblock = iday;
+      cblock = Min(cdayBlock, cday-1 - iday);
+      ib.rgday = &rgday[iday*3];
+      RunThreadJobs(cblock, InDayScanJob, &ib);
+    }
 
-    // After all the aspects and evemts in the day have been located, sort
-    // them by time at which they occur, so can print them in order.
+    // A day searched ahead of time can be used as is, unless it has so many
+    // events that the search here would have stopped short of all of them.
 
-    for (i = 1; i < occurcount; i++) {
-      j = i-1;
-      while (j >= 0 && pid[j].time > pid[j+1].time) {
-        idT = pid[j]; pid[j] = pid[j+1]; pid[j+1] = idT;
-        j--;
-      }
-    }
+    if (ib.rgid != NULL && iday < iblock + cblock &&
+      ib.rgcid[iday - iblock] < maxinday) {
+      occurcount = ib.rgcid[iday - iblock];
+      CopyRgb((pbyte)&ib.rgid[(iday - iblock)*MAXINDAY], (pbyte)pid,
+        sizeof(InDayInfo) * occurcount);
+    } else
+#endif
+    occurcount = NInDayScan(pid, maxinday, mon0, day0, yea0, division, fProg);
 
     // Finally, loop through and display each aspect and when it occurs.
 
-    if (!fVoid || (day0 >= day2 && mon0 >= mon2 && yea0 >= yea2)) {
+    if (!fVoid || iday >= cday-1) {
       // If no v/c aspects, or reached end of period, output all at once.
       if (fVoid) {
         occurcount += (int)(pid - id);
@@ -791,9 +1117,18 @@ void ChartInDaySearch(flag fProg)
     if (occurcount >= maxinday && fPrint)
       PrintSz("Too many transit events found.\n");
     counttotal += occurcount;
-  } // day0
-  } // mon0
-  } // yea0
+  } // iday
+#ifdef THREADS
+  if (ib.rgid != NULL) {
+    DeallocateP(ib.rgid);
+    DeallocateP(ib.rgcid);
+  }
+#endif
+  DeallocateP(rgday);
+#ifdef SWISS
+  if (fCheb)
+    ChebEnd();
+#endif
   if (counttotal == 0 && fPrint)
     PrintSz("No transit events found.\n");
 
@@ -804,6 +1139,333 @@ void ChartInDaySearch(flag fProg)
 }
 
 
+// Cast the transiting or progressed chart for the end of the given segment
+// of the month or day being searched by ChartTransitSearch(), where segment
+// zero is the start of the month or day. The chart at the end of the prior
+// segment is moved into cp1, and the new chart is left in cp2.
+
+void TransitScanCast(CONST TransitScan *pts, int div)
+{
+  real d;
+  int cObj, i;
+
+  if (div <= 0) {
+    SetCI(ciCore, MonT, us.fInDayMonth ? 1 : DayT, YeaT, 0.0, DstT, ZonT,
+      LonT, LatT);
+    if (us.fProgress = pts->fProg) {
+      is.JDp = MdytszToJulian(MM, DD, YY, TT, SS, ZZ);
+      ciCore = ciMain;
+    }
+    cObj = is.nObj;
+  } else {
+    d = (us.fInDayMonth ? 1.0 : (real)DayT) +
+      (real)(us.fInDayMonth ? DayInMonth(MonT, YeaT) : 1) *
+      (real)div/(real)pts->division;
+    SetCI(ciCore, MonT, (int)d, YeaT, RFract(d)*24.0,
+      DstT, ZonT, LonT, LatT);
+    if (pts->fProg) {
+      is.JDp = MdytszToJulian(MM, DD, YY, TT, SS, ZZ);
+      ciCore = ciMain;
+    }
+    cObj = oNorm;
+  }
+  for (i = 0; i <= cObj; i++)
+    SwapN(ignore[i], ignore2[i]);
+  CastChart(-1);
+  for (i = 0; i <= cObj; i++)
+    SwapN(ignore[i], ignore2[i]);
+  cp1 = cp2; cp2 = cp0;
+}
+
+
+// Given the chart just cast for the end of the given segment, schedule the
+// next segment whose end needs a chart cast. Each transiting object's
+// greatest geocentric speed bounds how soon it could reach the nearest
+// aspect to any natal object that FEventDue() scheduled, so the segments
+// before then can't contain a transit and are skipped over. An object
+// without a known speed limit means every segment is cast.
+
+void ScheduleTransitCast(CONST TransitScan *pts, EventSchedule *pes, int div,
+  real divsiz)
+{
+  real rDay = rLarge, r;
+  int i, j, n;
+
+  for (i = 0; i <= is.nObj; i++) {
+    if (FIgnore(i))
+      continue;
+    for (j = 0; j <= oNorm; j++) {
+      if ((is.fReturn ? i != j : FIgnore2(j)) || (pts->fNoCusp && !FThing(j)))
+        continue;
+      if (j > oSou)
+        return;
+      r = (pes->rgDue[i*objMax + j] - pes->rgMove[j]) / rObjSpeedMax[j];
+      rDay = Min(rDay, r);
+    }
+  }
+
+  // The segment ending at the next cast starts at this one, so the cast has
+  // to happen before the nearest aspect could be reached.
+  r = Min(rDay * 24.0*60.0 / divsiz, (real)pts->division);
+  n = (int)r;
+  if ((real)n >= r)
+    n--;
+  pes->divCast = div + n;
+}
+
+
+// Cast the chart for the end of the given segment, and search the segment
+// between it and the chart for the prior segment for transits to the natal
+// chart. Append them to the array ti after the occurcount events already in
+// it, and return the new number of events. If pes isn't NULL, it schedules
+// which pairs need to be checked, and if the search allows it, which
+// segments can't contain a transit and so don't need to be cast at all.
+// This is a subprocedure of ChartTransitSearch(), and may be called on
+// several threads at once.
+
+int NTransitScan(CONST TransitScan *pts, TransInfo *ti, int occurcount,
+  int div, real divsiz, EventSchedule *pes)
+{
+  CONST CP *pcpN = pts->pcpN;
+  TransInfo *pti = &ti[occurcount];
+  EventRoot er;
+  int i, j, k, s1, s2;
+  real d, e1, e2, f1, f2, g;
+
+  if (pes != NULL && div < pes->divCast)
+    return occurcount;
+  TransitScanCast(pts, div);
+  if (pes != NULL)
+    AdvanceEventSchedule(pes);
+  if (us.fInDayRefine) {
+    SetCI(er.ci, MonT, us.fInDayMonth ? 1 : DayT, YeaT, 0.0,
+      DstT, ZonT, LonT, LatT);
+    er.hr1 = (real)(div-1)*divsiz/60.0;
+    er.hr2 = (real)div*divsiz/60.0;
+  }
+
+  // Now search through the present segment for any transits. Note that
+  // stars can be transited, but they can't make transits themselves.
+
+  for (i = 0; i <= is.nObj; i++) {
+
+    /* For progressions we are interested in sign and degree changes etc. */
+
+    if (pts->fProg && !us.fIgnoreSign && !FIgnore2(i) &&
+      occurcount < MAXINDAY && FSignDue(pes, i, cp2.obj[i]))
+      if(CheckSignChange((InDayInfo*)pti, i, div, divsiz, 0, 0, 0)) {
+        occurcount++; pti++;
+      }
+
+    // Check if 3D house change occurs during time segment.
+
+    if (us.fHouse3D && !us.fIgnoreSign && !FIgnore2(i)) {
+      is.MC = pts->mc; is.OB = pts->ob;
+      e1 = cp1.obj[i]; f1 = RHousePlaceIn3D(e1, cp1.alt[i]);
+      e2 = cp2.obj[i]; f2 = RHousePlaceIn3D(e2, cp2.alt[i]);
+      s1 = SFromZ(f1)-1; s2 = SFromZ(f2)-1;
+      k = NAbs(s1-s2);
+      if (s1 != s2 && (k == 1 || k == cSign-1) && !FIgnore(cuspLo+s2) &&
+        occurcount < MAXINDAY) {
+        pti->source = i;
+        pti->aspect = aHou;
+        pti->dest = s2+1;
+        pti->time = MinDistance(f1,
+          (real)(cp1.dir[i] >= 0.0 ? s2 : s1) * 30.0) /
+          MinDistance(f1, f2)*divsiz + (real)(div-1)*divsiz;
+        pti->posT = cp1.obj[i];
+        pti->posN = pcpN->obj[i];
+        pti->retT = (cp1.dir[i] + cp2.dir[i]) / 2.0;
+        occurcount++, pti++;
+      }
+    }
+
+    if (FIgnore(i))
+      continue;
+    for (j = 0; j <= oNorm; j++) {
+      if ((is.fReturn ? i != j : FIgnore2(j)) || (pts->fNoCusp && !FThing(j)))
+        continue;
+
+      // Between each pair of planets, check if they make any aspects.
+
+      if (!us.fParallel) {
+
+      // Skip the pair if the transiting object can't have reached any
+      // aspect to the natal object yet.
+
+      if (pes == NULL ||
+        FEventDue(pes, i, j, pcpN->obj[i], cp2.obj[j], pts->nAsp))
+      for (k = 1; k <= pts->nAsp; k++) if (FAcceptAspect(i, k, j)) {
+        d = pcpN->obj[i]; e1 = cp1.obj[j]; e2 = cp2.obj[j];
+        if (MinDistance(e1, Mod(d-rAspAngle[k])) <
+            MinDistance(e2, Mod(d+rAspAngle[k]))) {
+          e1 = Mod(e1+rAspAngle[k]);
+          e2 = Mod(e2+rAspAngle[k]);
+        } else {
+          e1 = Mod(e1-rAspAngle[k]);
+          e2 = Mod(e2-rAspAngle[k]);
+        }
+
+        // Check to see if the present aspect actually occurs during the
+        // segment, making sure we check any Aries point crossings.
+
+        f1 = e1-d;
+        if (RAbs(f1) > rDegHalf)
+          f1 -= RSgn(f1)*rDegMax;
+        f2 = e2-d;
+        if (RAbs(f2) > rDegHalf)
+          f2 -= RSgn(f2)*rDegMax;
+        if (MinDistance(d, Midpoint(e1, e2)) < rDegQuad &&
+          RSgn(f1) != RSgn(f2) && occurcount < MAXINDAY) {
+
+          // Ok, have found a transit! Now determine the time and save
+          // this transit in our list to be printed.
+
+          pti->source = j;
+          pti->aspect = k;
+          pti->dest = i;
+          g = RAbs(f1)/(RAbs(f1)+RAbs(f2));
+          if (us.fInDayRefine && !pts->fProg) {
+            er.obj1 = -1; er.obj2 = j; er.pos1 = d;
+            g = RRefineEvent(&er, d, d, cp1.obj[j], cp2.obj[j],
+              rAspAngle[k], g);
+          }
+          pti->time = g*divsiz + (real)(div-1)*divsiz;
+          pti->posT = Mod(MinDistance(cp1.obj[j], Mod(d-rAspAngle[k])) <
+                          MinDistance(cp2.obj[j], Mod(d+rAspAngle[k])) ?
+            d-rAspAngle[k] : d+rAspAngle[k]);
+          pti->posN = pcpN->obj[i];
+          pti->retT = (cp1.dir[j] + cp2.dir[j]) / 2.0;
+          occurcount++, pti++;
+        }
+      }
+
+      } else {
+
+      for (k = 1; k <= pts->nAsp; k++) if (FAcceptAspect(i, k, j)) {
+        d = pcpN->alt[i]; e1 = cp1.alt[j]; e2 = cp2.alt[j];
+        if (!us.fEquator2 && !us.fParallel2) {
+          // If have ecliptic latitude and want declination, convert.
+          f1 = pcpN->obj[i]; EclToEqu(&f1, &d);
+          f1 = cp1.obj[j]; EclToEqu(&f1, &e1);
+          f2 = cp2.obj[j]; EclToEqu(&f2, &e2);
+        } else if (us.fEquator2 && us.fParallel2) {
+          // If have equatorial declination and want latitude, convert.
+          f1 = pcpN->obj[i]; EquToEcl(&f1, &d);
+          f1 = cp1.obj[j]; EquToEcl(&f1, &e1);
+          f2 = cp2.obj[j]; EquToEcl(&f2, &e2);
+        }
+
+        if (k == aOpp) {
+          neg(e1);
+          neg(e2);
+        }
+
+        // Check if parallel aspect occurs during time segment.
+
+        f1 = e1-d;
+        f2 = e2-d;
+        if (RSgn(f1) != RSgn(f2) && occurcount < MAXINDAY) {
+
+          // Ok, found a parallel transit. Now determine the time and save
+          // this transit in the list to be printed.
+
+          if (k == aOpp) {
+            neg(e1);
+            neg(e2);
+          }
+          pti->source = j;
+          pti->aspect = k;
+          pti->dest = i;
+          pti->time = RAbs(f1)/(RAbs(f1)+RAbs(f2))*divsiz +
+            (real)(div-1)*divsiz;
+          pti->posT = e1 + (e2 - e1)*RAbs(f1)/(RAbs(f1)+RAbs(f2));
+          pti->posN = d;
+          pti->retT = (cp1.diralt[j] + cp2.diralt[j]) / 2.0;
+          occurcount++, pti++;
+        }
+      }
+      } // us.fParallel
+
+      // Check for planet pairs equidistant from each other.
+
+      if (!us.fIgnoreDisequ) {
+        d = pcpN->dist[i]; e1 = cp1.dist[j]; e2 = cp2.dist[j];
+        if (((d > e1 && d < e2) || (d > e2 && d < e1)) &&
+          occurcount < MAXINDAY) {
+          f1 = d-e1; f2 = e2-d;
+          pti->source = j;
+          pti->aspect = aDis;
+          pti->dest = i;
+          pti->time = RAbs(f1)/(RAbs(f1)+RAbs(f2))*divsiz +
+            (real)(div-1)*divsiz;
+          pti->posT = Mod(cp1.obj[j] + RAbs(f1)/(RAbs(f1)+RAbs(f2)) *
+            MinDifference(cp1.obj[j], cp2.obj[j]));
+          pti->posN = pcpN->obj[i];
+          pti->retT = (cp1.dir[j] + cp2.dir[j]) / 2.0;
+          occurcount++, pti++;
+        }
+      }
+    } // j
+  } // i
+  if (pes != NULL && pts->fSkip)
+    ScheduleTransitCast(pts, pes, div, divsiz);
+  return occurcount;
+}
+
+
+#ifdef THREADS
+// Block of months searched in parallel by ChartTransitSearch(). Each month
+// has room for cti events, and records how many were found in each segment.
+
+typedef struct _TransitBlock {
+  CONST TransitScan *pts;  // Settings of the search
+  int mon;                 // Month and year of first month in the block
+  int yea;
+  int mon1;                // Range of months searched within each year
+  int mon2;
+  int cti;                 // Room for events within each month
+  TransInfo *rgti;         // Events found in each month, in segment order
+  int *rgcti;              // Events found in each segment of each month
+  flag *rgfFull;           // Whether each month ran out of room for events
+} TransitBlock;
+
+// Search one month of a block. Called by RunThreadJobs() on worker threads.
+
+void TransitScanJob(int ijob, void *pv)
+{
+  TransitBlock *ptb = (TransitBlock *)pv;
+  CONST TransitScan *pts = ptb->pts;
+  TransInfo ti[MAXINDAY], *pti = &ptb->rgti[ijob * ptb->cti];
+  EventSchedule es;
+  int *pcti = &ptb->rgcti[ijob * pts->division], cti = 0, occurcount, div, i;
+  real divsiz;
+  flag fSched;
+
+  i = ptb->mon - ptb->mon1 + ijob;
+  MonT = ptb->mon1 + i % (ptb->mon2 - ptb->mon1 + 1);
+  YeaT = ptb->yea + i / (ptb->mon2 - ptb->mon1 + 1);
+  divsiz = (real)(us.fInDayMonth ? DayInMonth(MonT, YeaT) : 1)*24.0*60.0 /
+    (real)pts->division;
+  ptb->rgfFull[ijob] = fFalse;
+  fSched = FInitEventSchedule(&es, fTrue);
+  TransitScanCast(pts, 0);
+  for (div = 1; div <= pts->division; div++) {
+    occurcount = NTransitScan(pts, ti, 0, div, divsiz, fSched ? &es : NULL);
+    if (cti + occurcount > ptb->cti) {
+      ptb->rgfFull[ijob] = fTrue;
+      break;
+    }
+    CopyRgb((pbyte)ti, (pbyte)&pti[cti], sizeof(TransInfo) * occurcount);
+    pcti[div-1] = occurcount;
+    cti += occurcount;
+  }
+  if (fSched)
+    DeallocateP(es.rgDue);
+}
+#endif
+
+
 // Search through a month, year, or years, and print out the times of exact
 // transits where planets in the time frame make aspect to the planets in
 // some other chart, as specified with the -t switch. To do this, cast charts
@@ -813,14 +1475,24 @@ void ChartInDaySearch(flag fProg)
 void ChartTransitSearch(flag fProg)
 {
   TransInfo ti[MAXINDAY], tiT, *pti;
+  TransitScan ts;
+  EventSchedule es;
   char sz[cchSzDef];
-  int M1, M2, Y1, Y2, counttotal = 0, occurcount, occ, division, div, nAsp, fNoCusp,
-    nSkip = 0, i, j, k, l, s1, s2, s3, s4, s1prev = 0;
-  real divsiz, daysiz, d, e1, e2, f1, f2, mc = is.MC, ob = is.OB;
-  flag fPrint = fTrue;
+  int M1, M2, Y1, Y2, counttotal = 0, occurcount, division, div, fNoCusp,
+    nSkip = 0, i, j, k, s1, s2, s3, s4, s1prev = 0;
+  real divsiz, daysiz;
+#ifdef SWISS
+  real jd1, jd2;
+#endif
+  flag fPrint = fTrue, fSched, fCheb = fFalse;
   CP cpN = cp0;
   CI ciSav, ciCast = ciSave, ciEvent;
   int *rgzCalendar = NULL;
+#ifdef THREADS
+  TransitBlock tb;
+  int cthread, cmon, imon = 0, iblock = 0, cblock = 0, cmonBlock = 0, iti = 0,
+    *pcti = NULL;
+#endif
 
   // Save away natal chart and initialize things.
 
@@ -840,9 +1512,26 @@ void ChartTransitSearch(flag fProg)
   division = us.nDivision;
   if (!fProg && !fNoCusp)
     division = Max(division, 96);
-  nAsp = is.fReturn ? aCon : us.nAsp;
+  ts.pcpN = &cpN;
+  ts.mc = is.MC; ts.ob = is.OB;
+  ts.nAsp = is.fReturn ? aCon : us.nAsp;
   if (us.fParallel)
-    nAsp = Min(nAsp, aOpp);
+    ts.nAsp = Min(ts.nAsp, aOpp);
+  ts.division = division;
+  ts.fNoCusp = fNoCusp;
+  ts.fProg = fProg;
+
+  // Segments can only be skipped over without casting when transits to the
+  // natal chart are the only events searched for, and positions come
+  // straight from the ephemeris, so the speed limits of objects apply.
+  ts.fSkip = !fProg && !us.fHouse3D && us.fIgnoreDisequ &&
+    us.objCenter == oEar && !us.fTopoPos && !FAdjustPositions();
+#ifdef EXPRESS
+  if (!us.fExpOff && (FSzSet(us.szExpCast1) || FSzSet(us.szExpCast2) ||
+    FSzSet(us.szExpObj)))
+    ts.fSkip = fFalse;
+#endif
+  fSched = FInitEventSchedule(&es, fTrue);
   if (us.fListAuto)
     is.cci = 0;
 
@@ -857,6 +1546,45 @@ void ChartTransitSearch(flag fProg)
         Y2 += (us.nEphemYears - 1);
     }
   }
+#ifdef SWISS
+  if (!fProg) {
+    jd1 = MdytszToJulian(M1, 1, Y1, 0.0, DstT, ZonT);
+    jd2 = MdytszToJulian(M2, DayInMonth(M2, Y2), Y2, 24.0, DstT, ZonT);
+    fCheb = FChebBegin(jd1, jd2);
+    SwissPreload(jd1, jd2);
+  }
+#endif
+
+#ifdef THREADS
+  // If casting on several threads, search blocks of months ahead of time in
+  // parallel. The last month is always searched here, so the chart variables
+  // are left just like a one thread search would leave them.
+
+  cthread = NThreadCount();
+  cmon = (Y2 - Y1 + 1) * (M2 - M1 + 1);
+  tb.rgti = NULL;
+  if (cthread > 1 && cmon > 2 && fPrint) {
+    cmonBlock = Min(cthread << 1, cmon-1);
+    tb.pts = &ts;
+    tb.mon1 = M1; tb.mon2 = M2;
+    tb.cti = MAXINDAY << 2;
+    tb.rgti = (TransInfo *)PAllocate(sizeof(TransInfo) * tb.cti * cmonBlock,
+      "month transits");
+    tb.rgcti = (int *)PAllocate(sizeof(int) * division * cmonBlock,
+      "month transits");
+    tb.rgfFull = (flag *)PAllocate(sizeof(flag) * cmonBlock,
+      "month transits");
+    if (tb.rgti == NULL || tb.rgcti == NULL || tb.rgfFull == NULL) {
+      if (tb.rgti != NULL)
+        DeallocateP(tb.rgti);
+      if (tb.rgcti != NULL)
+        DeallocateP(tb.rgcti);
+      if (tb.rgfFull != NULL)
+        DeallocateP(tb.rgfFull);
+      tb.rgti = NULL;
+    }
+  }
+#endif
 
    // Start searching the year or years in question for any transits.
 
@@ -869,21 +1597,31 @@ void ChartTransitSearch(flag fProg)
     daysiz = (real)(us.fInDayMonth ? DayInMonth(MonT, YeaT) : 1)*24.0*60.0;
     divsiz = daysiz / (real)division;
 
+    // Cast chart for beginning of month and store it for future use. Not
+    // needed if the month's transits were searched ahead of time, unless it
+    // found too many of them to keep.
 
-    // Cast chart for beginning of month and store it for future use.
+#ifdef THREADS
 
-    SetCI(ciCore, MonT, us.fInDayMonth ? 1 : DayT, YeaT, 0.0, DstT, ZonT,
-      LonT, LatT);
-    if (us.fProgress = fProg) {
-      is.JDp = MdytszToJulian(MM, DD, YY, TT, SS, ZZ);
-      ciCore = ciMain;
+    pcti = NULL;
+    if (tb.rgti != NULL) {
+      if (imon >= iblock + cblock && imon < cmon-1) {
+        iblock = imon;
+        cblock = Min(cmonBlock, cmon-1 - imon);
+        tb.mon = MonT; tb.yea = YeaT;
+        RunThreadJobs(cblock, TransitScanJob, &tb);
+      }
+      if (imon < iblock + cblock && !tb.rgfFull[imon - iblock]) {
+        pcti = &tb.rgcti[(imon - iblock) * division];
+        iti = (imon - iblock) * tb.cti;
+      }
     }
-    for (i = 0; i <= is.nObj; i++)
-      SwapN(ignore[i], ignore2[i]);
-    CastChart(-1);
-    for (i = 0; i <= is.nObj; i++)
-      SwapN(ignore[i], ignore2[i]);
-    cp2 = cp0;
+    imon++;
+    if (pcti == NULL)
+#endif
+    TransitScanCast(&ts, 0);
+    if (fSched)
+      ResetEventSchedule(&es);
 
     // Divide month into segments and then search each segment in turn.
 
@@ -892,177 +1630,20 @@ void ChartTransitSearch(flag fProg)
         occurcount = 0; pti = ti;
       }
 
-      // Cast the chart for the ending time of the present segment, and copy
-      // the start time chart from the previous end time chart.
-
-      d = (us.fInDayMonth ? 1.0 : (real)DayT) +
-        (daysiz/24.0/60.0)*(real)div/(real)division;
-      SetCI(ciCore, MonT, (int)d, YeaT, RFract(d)*24.0,
-        DstT, ZonT, LonT, LatT);
-      if (fProg) {
-        is.JDp = MdytszToJulian(MM, DD, YY, TT, SS, ZZ);
-        ciCore = ciMain;
-      }
-      for (i = 0; i <= oNorm; i++)
-        SwapN(ignore[i], ignore2[i]);
-      CastChart(-1);
-      for (i = 0; i <= oNorm; i++)
-        SwapN(ignore[i], ignore2[i]);
-      cp1 = cp2; cp2 = cp0;
-
-      // Now search through the present segment for any transits. Note that
-      // stars can be transited, but they can't make transits themselves.
-
-      for (i = 0; i <= is.nObj; i++) {
-	
-	/* For progressions we are interested in sign and degree changes etc. */
-
-        if (fProg && !us.fIgnoreSign && !FIgnore2(i) && occurcount < MAXINDAY)
-	  if(CheckSignChange((InDayInfo*)pti, i, div, divsiz, 0, 0, 0)) {
-	    occurcount++; pti++;
-	  }
-	
-        // Check if 3D house change occurs during time segment.
-
-        if (us.fHouse3D && !us.fIgnoreSign && !FIgnore2(i)) {
-          is.MC = mc; is.OB = ob;
-          e1 = cp1.obj[i]; f1 = RHousePlaceIn3D(e1, cp1.alt[i]);
-          e2 = cp2.obj[i]; f2 = RHousePlaceIn3D(e2, cp2.alt[i]);
-          s1 = SFromZ(f1)-1; s2 = SFromZ(f2)-1;
-          k = NAbs(s1-s2);
-          if (s1 != s2 && (k == 1 || k == cSign-1) && !FIgnore(cuspLo+s2) &&
-            occurcount < MAXINDAY) {
-            pti->source = i;
-            pti->aspect = aHou;
-            pti->dest = s2+1;
-            pti->time = MinDistance(f1,
-              (real)(cp1.dir[i] >= 0.0 ? s2 : s1) * 30.0) /
-              MinDistance(f1, f2)*divsiz + (real)(div-1)*divsiz;
-            pti->posT = cp1.obj[i];
-            pti->posN = cpN.obj[i];
-            pti->retT = (cp1.dir[i] + cp2.dir[i]) / 2.0;
-            occurcount++, pti++;
-          }
-        }
-
-        if (FIgnore(i))
-          continue;
-        for (j = 0; j <= oNorm; j++) {
-          if ((is.fReturn ? i != j : FIgnore2(j)) || (fNoCusp && !FThing(j)))
-            continue;
-
-          // Between each pair of planets, check if they make any aspects.
-
-          if (!us.fParallel) {
-
-          for (k = 1; k <= nAsp; k++) if (FAcceptAspect(i, k, j)) {
-            d = cpN.obj[i]; e1 = cp1.obj[j]; e2 = cp2.obj[j];
-            if (MinDistance(e1, Mod(d-rAspAngle[k])) <
-                MinDistance(e2, Mod(d+rAspAngle[k]))) {
-              e1 = Mod(e1+rAspAngle[k]);
-              e2 = Mod(e2+rAspAngle[k]);
-            } else {
-              e1 = Mod(e1-rAspAngle[k]);
-              e2 = Mod(e2-rAspAngle[k]);
-            }
-
-            // Check to see if the present aspect actually occurs during the
-            // segment, making sure we check any Aries point crossings.
-
-            f1 = e1-d;
-            if (RAbs(f1) > rDegHalf)
-              f1 -= RSgn(f1)*rDegMax;
-            f2 = e2-d;
-            if (RAbs(f2) > rDegHalf)
-              f2 -= RSgn(f2)*rDegMax;
-            if (MinDistance(d, Midpoint(e1, e2)) < rDegQuad &&
-              RSgn(f1) != RSgn(f2) && occurcount < MAXINDAY) {
-
-              // Ok, have found a transit! Now determine the time and save
-              // this transit in our list to be printed.
-
-              pti->source = j;
-              pti->aspect = k;
-              pti->dest = i;
-              pti->time = RAbs(f1)/(RAbs(f1)+RAbs(f2))*divsiz +
-                (real)(div-1)*divsiz;
-              pti->posT = Mod(MinDistance(cp1.obj[j], Mod(d-rAspAngle[k])) <
-                              MinDistance(cp2.obj[j], Mod(d+rAspAngle[k])) ?
-                d-rAspAngle[k] : d+rAspAngle[k]);
-              pti->posN = cpN.obj[i];
-              pti->retT = (cp1.dir[j] + cp2.dir[j]) / 2.0;
-              occurcount++, pti++;
-            }
-          }
-
-          } else {
-
-          for (k = 1; k <= nAsp; k++) if (FAcceptAspect(i, k, j)) {
-            d = cpN.alt[i]; e1 = cp1.alt[j]; e2 = cp2.alt[j];
-            if (!us.fEquator2 && !us.fParallel2) {
-              // If have ecliptic latitude and want declination, convert.
-              f1 = cpN.obj[i]; EclToEqu(&f1, &d);
-              f1 = cp1.obj[j]; EclToEqu(&f1, &e1);
-              f2 = cp2.obj[j]; EclToEqu(&f2, &e2);
-            } else if (us.fEquator2 && us.fParallel2) {
-              // If have equatorial declination and want latitude, convert.
-              f1 = cpN.obj[i]; EquToEcl(&f1, &d);
-              f1 = cp1.obj[j]; EquToEcl(&f1, &e1);
-              f2 = cp2.obj[j]; EquToEcl(&f2, &e2);
-            }
-
-            if (k == aOpp) {
-              neg(e1);
-              neg(e2);
-            }
-
-            // Check if parallel aspect occurs during time segment.
-
-            f1 = e1-d;
-            f2 = e2-d;
-            if (RSgn(f1) != RSgn(f2) && occurcount < MAXINDAY) {
-
-              // Ok, found a parallel transit. Now determine the time and save
-              // this transit in the list to be printed.
+#ifdef THREADS
+      if (pcti != NULL) {
+        occurcount = pcti[div-1];
+        CopyRgb((pbyte)&tb.rgti[iti], (pbyte)ti,
+          sizeof(TransInfo) * occurcount);
+        iti += occurcount;
+      } else
+#endif
 
-              if (k == aOpp) {
-                neg(e1);
-                neg(e2);
-              }
-              pti->source = j;
-              pti->aspect = k;
-              pti->dest = i;
-              pti->time = RAbs(f1)/(RAbs(f1)+RAbs(f2))*divsiz +
-                (real)(div-1)*divsiz;
-              pti->posT = e1 + (e2 - e1)*RAbs(f1)/(RAbs(f1)+RAbs(f2));
-              pti->posN = d;
-              pti->retT = (cp1.diralt[j] + cp2.diralt[j]) / 2.0;
-              occurcount++, pti++;
-            }
-          }
-          } // us.fParallel
+      // Cast the chart for the ending time of the present segment, and search
+      // through the segment for any transits.
 
-          // Check for planet pairs equidistant from each other.
-
-          if (!us.fIgnoreDisequ) {
-            d = cpN.dist[i]; e1 = cp1.dist[j]; e2 = cp2.dist[j];
-            if (((d > e1 && d < e2) || (d > e2 && d < e1)) &&
-              occurcount < MAXINDAY) {
-              f1 = d-e1; f2 = e2-d;
-              pti->source = j;
-              pti->aspect = aDis;
-              pti->dest = i;
-              pti->time = RAbs(f1)/(RAbs(f1)+RAbs(f2))*divsiz +
-                (real)(div-1)*divsiz;
-              pti->posT = Mod(cp1.obj[j] + RAbs(f1)/(RAbs(f1)+RAbs(f2)) *
-                MinDifference(cp1.obj[j], cp2.obj[j]));
-              pti->posN = cpN.obj[i];
-              pti->retT = (cp1.dir[j] + cp2.dir[j]) / 2.0;
-              occurcount++, pti++;
-            }
-          }
-        } // j
-      } // i
+      occurcount = NTransitScan(&ts, ti, occurcount, div, divsiz,
+        fSched ? &es : NULL);
 
 #ifdef GRAPH
       // May want to draw current transit event within a graphic calendar box.
@@ -1185,6 +1766,19 @@ void ChartTransitSearch(flag fProg)
       counttotal += occurcount;
     } // div
   } // MonT
+#ifdef THREADS
+  if (tb.rgti != NULL) {
+    DeallocateP(tb.rgti);
+    DeallocateP(tb.rgcti);
+    DeallocateP(tb.rgfFull);
+  }
+#endif
+  if (fSched)
+    DeallocateP(es.rgDue);
+#ifdef SWISS
+  if (fCheb)
+    ChebEnd();
+#endif
   if (counttotal == 0 && fPrint)
     PrintSz("No transits found.\n");
 
@@ -1209,6 +1803,9 @@ void ChartTransitGraph(flag fTrans, flag fProg)
   char sz[cchSzDef];
   int cAsp, cSlice, cYea, dYea, occurcount = 0, ymin, x0, y0, x, y, asp,
     iw, iwFocus, nMax, n, ch, obj, et;
+#ifdef SWISS
+  int yea1, yea2;
+#endif
   flag fMonth = us.fInDayMonth, fYear = us.fInDayYear, fMark, fEclipse =
     us.fEclipse && !fTrans && !us.fParallel;
   CI ciT;
@@ -1246,6 +1843,16 @@ void ChartTransitGraph(flag fTrans, flag fProg)
   }
   if (iwFocus == 0 && ciT.tim <= 0.0)
     iwFocus = -1;
+#ifdef SWISS
+  // Slices over a year or more are cast far enough apart that their
+  // ephemeris segments are worth preloading.
+  if (fMonth && fYear && !fProg) {
+    yea1 = ciT.yea - (us.nEphemYears <= 1 ? 0 : dYea);
+    yea2 = yea1 + (us.nEphemYears <= 1 ? 0 : cYea - 1);
+    SwissPreload(MdytszToJulian(1, 1, yea1, 0.0, ciT.dst, ciT.zon),
+      MdytszToJulian(12, 31, yea2, 24.0, ciT.dst, ciT.zon));
+  }
+#endif
 
   // Calculate and fill out aspect strength arrays for each aspect present.
   if (fTrans || fProg) {
@@ -1736,7 +2343,10 @@ void ChartEphemeris(void)
   char sz[cchSzDef];
   int yea, yea1, yea2, mon, mon1, mon2, daysiz, timsiz, t, i, j, k, s, d, m;
   real tim, rT;
-  flag fDidBlank = fFalse, fWantHeader = fTrue;
+#ifdef SWISS
+  real jd1, jd2;
+#endif
+  flag fDidBlank = fFalse, fWantHeader = fTrue, fCheb = fFalse;
 
   // If -Ey is in effect, then loop through all months in the whole year.
 
@@ -1749,6 +2359,14 @@ void ChartEphemeris(void)
     mon1 = mon2 = !us.fProgress ? Mon : MonT;
   }
   timsiz = us.nEphemRate < 0 ? (24-1)/us.nEphemFactor : 0;
+#ifdef SWISS
+  if (!us.fProgress) {
+    jd1 = MdytszToJulian(mon1, 1, yea1, 0.0, Dst, Zon);
+    jd2 = MdytszToJulian(mon2, DayInMonth(mon2, yea2), yea2, 24.0, Dst, Zon);
+    fCheb = FChebBegin(jd1, jd2);
+    SwissPreload(jd1, jd2);
+  }
+#endif
 
   // Loop through the year or years in question.
 
@@ -1864,6 +2482,10 @@ void ChartEphemeris(void)
     } // t
     } // i
   } // mon
+#ifdef SWISS
+  if (fCheb)
+    ChebEnd();
+#endif
 
   ciCore = ciMain;    // Recast original chart.
   CastChart(1);
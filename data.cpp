@@ -60,7 +60,7 @@
 ******************************************************************************
 */
 
-US us = {
+TLOCAL US us = {
 
   // Chart types
   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -106,7 +106,7 @@ US us = {
 
   // Obscure flags
   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0,
-  1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 
   // Value settings
   ddDecanR,
@@ -132,6 +132,9 @@ US us = {
   SCREENWIDTH,
   0,
   0,
+  0,
+  0,
+  0.0,
   0.0,
   DEFAULT_ZONE,
   DEFAULT_LONG,
@@ -145,10 +148,12 @@ US us = {
   "",
   "",
   "",
+  "",
 
   // Value subsettings
   0, 5, 200, cPart, 22, 0.0, 0.0, rDayInYear, 1.0, 1, 1, ccNone, ccNone,
-  24, 0, 0, rInvalid, 0.0, 0.0, oEar, oEar, 0, 0, BIODAYS, 0, 0, 0,
+  24, 0, 0, rInvalid, 0.0, 0.0, oEar, oEar, 0, 0, BIODAYS, 0, 0, 0, 1,
+  0.0, NULL, 0, 0,
 
   // AstroExpressions
   NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
@@ -156,29 +161,30 @@ US us = {
   NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
   NULL, NULL, NULL, NULL, NULL, NULL};
 
-IS is = {
+TLOCAL IS is = {
   fFalse, fFalse, fFalse, fFalse, fFalse, fFalse, fFalse, fFalse, fFalse,
-  fFalse, NULL, {0,0,0,0,0,0,0,0,0}, NULL, NULL, NULL,
+  fFalse, fFalse, NULL, {0,0,0,0,0,0,0,0,0}, NULL, NULL, NULL,
   0, cObj, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, 0, 0, 0,
   0.0, 0.0, 0.0, 0.0, 0.0,
   NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
   0.0, 0.0, 0.0, 0.0, 0.0, 0.0, rAxis, 0.0, rInvalid, 0.0};
 
-CI ciCore = {11, 19, 1971, HM(11, 1),     0.0, 8.0, DEFAULT_LOC, "", ""};
-CI ciMain = {-1, 0,  0,    0.0,           0.0, 0.0, 0.0, 0.0,    "", ""};
-CI ciTwin = {9,  11, 1991, HMS(0, 0, 38), 0.0, 0.0, DEFAULT_LOC, "", ""};
-CI ciThre = {-1, 0,  0,    0.0,           0.0, 0.0, 0.0, 0.0,    "", ""};
-CI ciFour = {-1, 0,  0,    0.0,           0.0, 0.0, 0.0, 0.0,    "", ""};
-CI ciFive = {-1, 0,  0,    0.0,           0.0, 0.0, 0.0, 0.0,    "", ""};
-CI ciHexa = {-1, 0,  0,    0.0,           0.0, 0.0, 0.0, 0.0,    "", ""};
-CI ciTran = {1,  1,  2023, 0.0,           0.0, 0.0, 0.0, 0.0,    "", ""};
-CI ciSave = {4,  9,  2023, HMS(1, 9, 11), 0.0, 8.0, DEFAULT_LOC, "", ""};
+TLOCAL CI
+  ciCore = {11, 19, 1971, HM(11, 1),     0.0, 8.0, DEFAULT_LOC, "", ""},
+  ciMain = {-1, 0,  0,    0.0,           0.0, 0.0, 0.0, 0.0,    "", ""},
+  ciTwin = {9,  11, 1991, HMS(0, 0, 38), 0.0, 0.0, DEFAULT_LOC, "", ""},
+  ciThre = {-1, 0,  0,    0.0,           0.0, 0.0, 0.0, 0.0,    "", ""},
+  ciFour = {-1, 0,  0,    0.0,           0.0, 0.0, 0.0, 0.0,    "", ""},
+  ciFive = {-1, 0,  0,    0.0,           0.0, 0.0, 0.0, 0.0,    "", ""},
+  ciHexa = {-1, 0,  0,    0.0,           0.0, 0.0, 0.0, 0.0,    "", ""},
+  ciTran = {1,  1,  2023, 0.0,           0.0, 0.0, 0.0, 0.0,    "", ""},
+  ciSave = {4,  9,  2023, HMS(1, 9, 11), 0.0, 8.0, DEFAULT_LOC, "", ""};
 CI ciGreg = {10, 15, 1582, 0.0,           0.0, 0.0, 0.0, 0.0,    "", ""};
-CP cp0, cp1, cp2, cp3, cp4, cp5, cp6;
+TLOCAL CP cp0, cp1, cp2, cp3, cp4, cp5, cp6;
 
-CI * CONST rgpci[cRing+1] = {&ciCore,
-  &ciMain, &ciTwin, &ciThre, &ciFour, &ciFive, &ciHexa};
-CP * CONST rgpcp[cRing+1] = {&cp0, &cp1, &cp2, &cp3, &cp4, &cp5, &cp6};
+// Filled in by InitChartContext(), since each thread has its own charts.
+TLOCAL CI *rgpci[cRing+1];
+TLOCAL CP *rgpcp[cRing+1];
 
 
 /*
@@ -188,16 +194,17 @@ CP * CONST rgpcp[cRing+1] = {&cp0, &cp1, &cp2, &cp3, &cp4, &cp5, &cp6};
 */
 
 real force[objMax];
-GridInfo *grid = NULL;
-int rgobjList[objMax], rgobjList2[objMax], starname[cStar+1], kObjA[objMax];
+TLOCAL GridInfo *grid = NULL;
+TLOCAL int rgobjList[objMax], rgobjList2[objMax], kObjA[objMax];
+int starname[cStar+1];
 char *szMacro[48], *szWheel[cRing+1] = {"", "", "", "", "", "", ""};
-real rStarBrightDef[cStar+1] = {-1.0}, rStarBright[cStar+1],
-  rStarBrightDistDef[cStar+1];
+real rStarBrightDef[cStar+1] = {-1.0}, rStarBrightDistDef[cStar+1];
+TLOCAL real rStarBright[cStar+1];
 char *szStarCustom[cStar+1];
 
 // Restriction status of each object, as specified with -R switch.
 
-byte ignore[objMax] = {1,
+TLOCAL byte ignore[objMax] = {1,
   0, 0, 0, 0, 0, 0, 0, 0, 0, 0,                     // Planets
   0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0,                  // Minors
   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,               // Cusps
@@ -209,7 +216,7 @@ byte ignore[objMax] = {1,
 
 // Restriction of objects when transiting, as specified with -RT switch.
 
-byte ignore2[objMax] = {1,
+TLOCAL byte ignore2[objMax] = {1,
   0, 1, 0, 0, 0, 0, 0, 0, 0, 0,                     // Planets
   0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1,                  // Minors
   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,               // Cusps
@@ -225,7 +232,7 @@ byte ignorea[cAspect+1] = {0,
   0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
 
 byte ignorez[arMax] = {0, 0, 0, 0};     // Restrictions for -Zd chart events.
-byte ignore7[rrMax] = {0, 1, 1, 0, 1};  // Restrictions for rulership types.
+TLOCAL byte ignore7[rrMax] = {0, 1, 1, 0, 1};  // Rulership type restrictions.
 
 byte ignoreMem[objMax], ignore2Mem[objMax], ignoreaMem[cAspect+1],
   ignorezMem[arMax], ignore7Mem[rrMax], ignorefMem[6];
@@ -704,6 +711,9 @@ CONST real rObjMass[oPlu+1] = {1.0, 322946.0, 0.0123,
   0.0553, 0.8149, 0.1074, 317.938, 95.181, 14.531, 17.135, 0.0022};
 CONST real rObjAxis[oPlu+1] = {23.5, 0.0, 6.7,
   2.0, 2.7, 25.19, 3.12, 26.73, 82.14, 29.6, 57.54};
+CONST real rObjSpeedMax[oSou+1] = {1.05, 1.05, 16.0,
+  2.3, 1.3, 0.85, 0.25, 0.14, 0.07, 0.05, 0.05,
+  0.16, 0.5, 0.65, 0.65, 0.6, 0.3, 0.3};  // Units: deg/day, geocentric
 CONST int cSatellite[oPlu+1] = {1, 9, 0,
   0, 0, 2, 4, 8, 5, 3, 5};
 CONST int nMooMap[6][8] = {  // Map JPL code number to Astrolog object index
@@ -141,6 +141,44 @@ typedef struct _parameter {
   flag fReal; // Whether parameter is real or integer
 } PAR;
 
+// Compiled AstroExpressions are a sequence of operations, one per token in
+// the source string, in the same prefix order the tokens appear in. A
+// function operation is followed by the operations for its parameters.
+
+enum _expressionoptype {
+  xopNum  = 0, // Number or variable name, known when compiled
+  xopVar  = 1, // Value of custom variable
+  xopName = 2, // Named constant, looked up each time evaluated
+  xopFun  = 3, // Function call
+};
+
+typedef struct _expressionop {
+  int xop;         // Type of operation
+  int n;           // Function index (xopFun) or variable index (xopVar)
+  int cop;         // Number of operations in this subexpression
+  PAR par;         // Value of number (xopNum)
+  CONST char *pch; // Token within copy of source string (xopName)
+} XOP;
+
+typedef struct _expressioncode {
+  CONST char *szKey; // String this code was compiled from
+  char *szSrc;       // Copy of string, to detect when its contents change
+  XOP *rgop;         // Compiled operations, or NULL if string has errors
+  int cop;           // Number of compiled operations
+  flag fInvariant;   // Whether code is constants only, with no side effects
+  long ccall;        // Number of times evaluated, when profiling with -~T
+  long clk;          // Total clock ticks spent evaluating, when profiling
+} XC;
+
+#define cxcMax 512 // Number of slots in compiled AstroExpression cache
+#define IxcHash(sz) ((int)((((size_t)(sz)) ^ ((size_t)(sz) >> 10)) % cxcMax))
+
+// Functions whose value depends only on their parameters, that have no side
+// effects, and so can be evaluated when compiled if their parameters are
+// all constants.
+#define FFoldFun(ifun) (FBetween(ifun, funFalse, funDMS) || \
+  FBetween(ifun, funRgb, funHue2) || FBetween(ifun, funDo, funDo3))
+
 typedef struct _AstroexpressionInternal {
   TRIE rgsTrieFun;      // Trie tree of tokens for AstroExpression parsing
   PAR *rgparVar;        // List of custom variables
@@ -149,14 +187,19 @@ typedef struct _AstroexpressionInternal {
   int cszExpMacro;      // Size of list of AstroExpression macros
   char **rgszExpStr;    // List of AstroExpression strings
   int cszExpStr;        // Size of list of AstroExpression strings
+  XC *rgxc;             // Cache of compiled AstroExpressions
+  int cxcRun;           // Nesting level of compiled code being evaluated
+  long ccallOther;      // Evaluations of strings without a cache slot, when
+  long clkOther;        // profiling, and clock ticks spent on them
 } XI;
 
-XI xi = {NULL, NULL, 0, NULL, 0, NULL, 0};
+XI xi = {NULL, NULL, 0, NULL, 0, NULL, 0, NULL, 0, 0, 0};
 
 extern int ILookupTrie P((CONST TRIE, CONST char *, int, flag));
 extern CONST char *PchGetParameter P((CONST char *, PAR *, int, int, flag));
 extern void GetParameter P((CONST char *, PAR *));
 extern flag FEnsureParVar P((int));
+extern flag FRunExpOp P((CONST XOP *, PAR *));
 
 // Functions
 
@@ -1117,10 +1160,24 @@ long LFromRgch(CONST char *rgch, int cch)
 ******************************************************************************
 */
 
+// Evaluate a parameter to a function that was skipped over when the function
+// was parsed, such as the body of a loop. The parameter is either compiled
+// code, or else a position within the expression string to parse.
+
+void EvalDeferred(int ifun, CONST char *pch, CONST XOP *pop, PAR *ppar)
+{
+  if (pop != NULL)
+    FRunExpOp(pop, ppar);
+  else
+    PchGetParameter(pch, ppar, ifun, 1, fTrue);
+}
+
+
 // Evaluate a function, generating the number it evaluates to, given a list of
 // parameters to the function.
 
-flag FEvalFunction(int ifun, PAR *rgpar, char *rgpchEval[2])
+flag FEvalFunction(int ifun, PAR *rgpar, char *rgpchEval[2],
+  CONST XOP *rgpopEval[2])
 {
   int ipar, nType, n = 0, n1, n2, n3, n4;
   real r = 0.0, r1, r2, r3, r4;
@@ -1777,39 +1834,39 @@ flag FEvalFunction(int ifun, PAR *rgpar, char *rgpchEval[2])
     fRetReal = fFalse;
     n = (n1 != 0);
     if (n) {
-      PchGetParameter(rgpchEval[0], &rgpar[0], ifun, 1, fTrue);
+      EvalDeferred(ifun, rgpchEval[0], rgpopEval[0], &rgpar[0]);
       goto LParseRet;
     }
     break;
   case funIfElse:
     n = (n1 != 0);
-    PchGetParameter(rgpchEval[!n], &rgpar[0], ifun, 1, fTrue);
+    EvalDeferred(ifun, rgpchEval[!n], rgpopEval[!n], &rgpar[0]);
     goto LParseRet;
     break;
   case funDoCount:
     fRetReal = fFalse;
     for (n = 0; n < n1; n++)
-      PchGetParameter(rgpchEval[0], &rgpar[0], ifun, 1, fTrue);
+      EvalDeferred(ifun, rgpchEval[0], rgpopEval[0], &rgpar[0]);
     if (n > 0)
       goto LParseRet;
     break;
   case funWhile:
     fRetReal = fFalse;
     loop {
-      PchGetParameter(rgpchEval[0], &rgpar[0], ifun, 1, fTrue);
+      EvalDeferred(ifun, rgpchEval[0], rgpopEval[0], &rgpar[0]);
       if (!(rgpar[0].fReal ? rgpar[0].r != 0.0 : rgpar[0].n != 0))
         break;
-      PchGetParameter(rgpchEval[1], &rgpar[0], ifun, 1, fTrue);
+      EvalDeferred(ifun, rgpchEval[1], rgpopEval[1], &rgpar[0]);
       fRetReal = rgpar[0].fReal;
       EIR(rgpar[0].n, rgpar[0].r);
     }
     break;
   case funDoWhile:
     do {
-      PchGetParameter(rgpchEval[1], &rgpar[0], ifun, 1, fTrue);
+      EvalDeferred(ifun, rgpchEval[1], rgpopEval[1], &rgpar[0]);
       fRetReal = rgpar[0].fReal;
       EIR(rgpar[0].n, rgpar[0].r);
-      PchGetParameter(rgpchEval[0], &rgpar[0], ifun, 1, fTrue);
+      EvalDeferred(ifun, rgpchEval[0], rgpopEval[0], &rgpar[0]);
     } while (rgpar[0].fReal ? rgpar[0].r != 0.0 : rgpar[0].n != 0);
     break;
   case funFor:
@@ -1817,7 +1874,7 @@ flag FEvalFunction(int ifun, PAR *rgpar, char *rgpchEval[2])
       xi.rgparVar[n1] = rgpar[2];
       for (xi.rgparVar[n1].n = n2; xi.rgparVar[n1].n <= n3;
         xi.rgparVar[n1].n++)
-        PchGetParameter(rgpchEval[0], &rgpar[0], ifun, 1, fTrue);
+        EvalDeferred(ifun, rgpchEval[0], rgpopEval[0], &rgpar[0]);
       n = xi.rgparVar[n1].n;
     } else
       n = 0;
@@ -1878,6 +1935,85 @@ LParseRet:
 }
 
 
+// Return which deferred slot a parameter to a function is evaluated through,
+// for parameters that shouldn't be evaluated yet but just skipped over, such
+// as the body of a loop. Return -1 for parameters evaluated right away.
+
+int IEvalDeferred(int ifun, int iParam)
+{
+  if (((ifun == funIf || ifun == funIfElse || ifun == funDoCount) &&
+      iParam == 2) ||
+    ((ifun == funWhile || ifun == funDoWhile) && iParam == 1) ||
+    (ifun == funFor && iParam == 4))
+    return 0;
+  if ((ifun == funIfElse && iParam == 3) ||
+    ((ifun == funWhile || ifun == funDoWhile) && iParam == 2))
+    return 1;
+  return -1;
+}
+
+
+// Check whether a parameter string is a named constant, such as "O_Sun" for
+// the Sun object index, and if so set the parameter to its value.
+
+flag FParseExpConstant(CONST char *pchParam, PAR *ppar)
+{
+  char szT[cchSzMax], ch1 = *pchParam;
+  CONST char *pchT;
+  int n;
+  real r;
+
+  if (ch1 == chNull || pchParam[1] != '_')
+    return fFalse;
+  for (pchT = pchParam+2, n = 0; *pchT && *pchT > ' '; pchT++, n++)
+    szT[n] = *pchT;
+  szT[n] = chNull;
+  n = -1; r = -rLarge;
+  switch (ChCap(ch1)) {
+  case 'M': n = NParseSz(szT, pmMon);    break;
+  case 'O': n = NParseSz(szT, pmObject); break;
+  case 'A': n = NParseSz(szT, pmAspect); break;
+  case 'H': n = NParseSz(szT, pmSystem); break;
+  case 'S': n = NParseSz(szT, pmSign);   break;
+  case 'K': n = NParseSz(szT, pmColor);  break;
+  case 'W': n = NParseSz(szT, pmWeek);   break;
+  case 'Z': r = RParseSz(szT, pmOffset); break;
+  }
+  if (n >= 0) {
+    ppar->n = n;
+    ppar->fReal = fFalse;
+    return fTrue;
+  } else if (r >= -rLarge) {
+    ppar->r = r;
+    ppar->fReal = fTrue;
+    return fTrue;
+  }
+  return fFalse;
+}
+
+
+// Display a warning about a parameter string that can't be parsed, along
+// with the rest of the expression string after it.
+
+void ExpUnknownToken(CONST char *pchParam, int cch, CONST char *pchCur)
+{
+  char sz[cchSzMax*2], szT[cchSzMax], *pchEdit;
+  CONST char *pchT;
+
+  CopyRgchToSz(pchParam, cch, szT, cchSzMax);
+  sprintf(sz, "Unknown function: '%s'\nContext: '", szT);
+  for (pchEdit = sz; *pchEdit; pchEdit++)
+    ;
+  pchT = pchCur;
+  while (*pchT && pchEdit - sz < cchSzMax)
+    *pchEdit++ = *pchT++;
+  if (pchEdit - sz < cchSzMax)
+    *pchEdit++ = '\'';
+  *pchEdit = chNull;
+  PrintWarning(sz);
+}
+
+
 // Read a parameter to an action from a command line, given the current
 // position into the command line string. Return the evaluation of the
 // parameter in either a string or numeric return variable, or null on error.
@@ -1886,12 +2022,11 @@ LParseRet:
 CONST char *PchGetParameter(CONST char *pchCur, PAR *rgpar, int ifun,
   int iParam, flag fEval)
 {
-  char sz[cchSzMax*2], szT[cchSzMax], ch1, ch, *pchEdit;
+  char sz[cchSzMax*2], szT[cchSzMax], ch1, ch;
   CONST char *rgpchEval[2], *pchParam, *pchT;
-  int ifunT, iParamT, cch, n;
-  real r;
+  CONST XOP *rgpopEval[2] = {NULL, NULL};
+  int ifunT, iParamT, iEval, cch, n;
   PAR rgpar2[4+1];
-  flag fSkipEval;
 
   // Skip whitespace.
   while (*pchCur == ' ')
@@ -1962,31 +2097,8 @@ CONST char *PchGetParameter(CONST char *pchCur, PAR *rgpar, int ifun,
   }
 
   // Check for named constants.
-  if (ch1 != chNull && pchParam[1] == '_') {
-    for (pchT = pchParam+2, n = 0; *pchT && *pchT > ' '; pchT++, n++)
-      szT[n] = *pchT;
-    szT[n] = chNull;
-    n = -1; r = -rLarge;
-    switch (ChCap(ch1)) {
-    case 'M': n = NParseSz(szT, pmMon);    break;
-    case 'O': n = NParseSz(szT, pmObject); break;
-    case 'A': n = NParseSz(szT, pmAspect); break;
-    case 'H': n = NParseSz(szT, pmSystem); break;
-    case 'S': n = NParseSz(szT, pmSign);   break;
-    case 'K': n = NParseSz(szT, pmColor);  break;
-    case 'W': n = NParseSz(szT, pmWeek);   break;
-    case 'Z': r = RParseSz(szT, pmOffset); break;
-    }
-    if (n >= 0) {
-      rgpar[0].n = n;
-      rgpar[0].fReal = fFalse;
-      goto LDone;
-    } else if (r >= -rLarge) {
-      rgpar[0].r = r;
-      rgpar[0].fReal = fTrue;
-      goto LDone;
-    }
-  }
+  if (FParseExpConstant(pchParam, &rgpar[0]))
+    goto LDone;
 
   // Check for function.
   ifunT = ILookupTrie(xi.rgsTrieFun, pchParam, cch, fTrue);
@@ -1995,26 +2107,17 @@ CONST char *PchGetParameter(CONST char *pchCur, PAR *rgpar, int ifun,
 
     // Recursively get the parameters to the function.
     for (iParamT = 1; iParamT <= rgfun[ifunT].nParam; iParamT++) {
-      fSkipEval = fFalse;
       // Some parameters shouldn't be evaluated yet, but just skipped over.
-      if (((ifunT == funIf || ifunT == funIfElse || ifunT == funDoCount) &&
-          iParamT == 2) ||
-        ((ifunT == funWhile || ifunT == funDoWhile) && iParamT == 1) ||
-        (ifunT == funFor && iParamT == 4)) {
-        fSkipEval = fTrue;
-        rgpchEval[0] = pchCur;
-      } else if ((ifunT == funIfElse && iParamT == 3) ||
-        ((ifunT == funWhile || ifunT == funDoWhile) && iParamT == 2)) {
-        fSkipEval = fTrue;
-        rgpchEval[1] = pchCur;
-      }
+      iEval = IEvalDeferred(ifunT, iParamT);
+      if (iEval >= 0)
+        rgpchEval[iEval] = pchCur;
       pchCur = PchGetParameter(pchCur, &rgpar2[iParamT], ifunT, iParamT,
-        fEval && !fSkipEval);
+        fEval && iEval < 0);
       if (pchCur == NULL)
         return NULL;
     }
     if (fEval) {
-      if (!FEvalFunction(ifunT, rgpar2, (char **)rgpchEval))
+      if (!FEvalFunction(ifunT, rgpar2, (char **)rgpchEval, rgpopEval))
         return NULL;
       rgpar[0] = rgpar2[0];
     }
@@ -2022,17 +2125,7 @@ CONST char *PchGetParameter(CONST char *pchCur, PAR *rgpar, int ifun,
   }
 
   // Error if can't parse contents.
-  CopyRgchToSz(pchParam, cch, szT, cchSzMax);
-  sprintf(sz, "Unknown function: '%s'\nContext: '", szT);
-  for (pchEdit = sz; *pchEdit; pchEdit++)
-    ;
-  pchT = pchCur;
-  while (*pchT && pchEdit - sz < cchSzMax)
-    *pchEdit++ = *pchT++;
-  if (pchEdit - sz < cchSzMax)
-    *pchEdit++ = '\'';
-  *pchEdit = chNull;
-  PrintWarning(sz);
+  ExpUnknownToken(pchParam, cch, pchCur);
 LError:
   us.fExpOff = fTrue;
   return NULL;
@@ -2042,16 +2135,283 @@ LDone:
 }
 
 
+// Compile a parameter to an action into operations, given the current
+// position into the expression string. Follows the same rules as
+// PchGetParameter(), but only parses the string without evaluating it, other
+// than folding functions with constant parameters into constants. Update
+// the count of operations, and return the position after the parameter, or
+// null if the parameter has an error, in which case the string is left to be
+// interpreted directly so any warning is given at the same point as before.
+
+CONST char *PchCompileParameter(CONST char *pchCur, XOP *rgop, int *piop)
+{
+  XOP *pop = &rgop[*piop], *popT;
+  CONST XOP *rgpopEval[2] = {NULL, NULL};
+  CONST char *rgpchEval[2] = {NULL, NULL}, *pchParam, *pchT;
+  PAR par, rgpar2[4+1];
+  int ifunT, iParamT, cch;
+  char ch1, ch;
+
+  // Skip whitespace.
+  while (*pchCur == ' ')
+    pchCur++;
+  if (*pchCur == chNull)
+    return NULL;
+
+  // Get parameter string.
+  for (pchParam = pchCur; *pchCur && *pchCur != ' '; pchCur++)
+    ;
+  cch = (int)(pchCur - pchParam);
+  ch1 = *pchParam;
+  (*piop)++;
+  pop->cop = 1;
+  pop->xop = xopNum;
+
+  // Check for integer or real number.
+  if (FNumCh(ch1) || ((ch1 == '-' || ch1 == '#') && cch > 1)) {
+    for (pchT = pchParam; pchT < pchCur; pchT++)
+      if (*pchT == '.') {
+        pop->par.r = atof(pchParam);
+        pop->par.fReal = fTrue;
+        return pchCur;
+      }
+    pop->par.n = LFromRgch(pchParam, cch);
+    pop->par.fReal = fFalse;
+    return pchCur;
+  }
+
+  // Check for variable name.
+  if (ch1 == '%') {
+    ch = ChCap(pchParam[1]);
+    if (FCapCh(ch) || FNumCh(ch)) {
+      pop->par.n = FCapCh(ch) ? ch - '@' : atoi(pchParam + 1);
+      pop->par.fReal = fFalse;
+      return pchCur;
+    }
+  }
+
+  // Check for variable value.
+  if (ch1 == '@') {
+    ch = ChCap(pchParam[1]);
+    if (FCapCh(ch) || FNumCh(ch)) {
+      pop->xop = xopVar;
+      pop->n = FCapCh(ch) ? ch - '@' : atoi(pchParam + 1);
+      return pchCur;
+    }
+  }
+
+  // Check for named constants. Names of objects and such can be changed, so
+  // the constant is looked up again each time the operation is evaluated.
+  if (FParseExpConstant(pchParam, &par)) {
+    pop->xop = xopName;
+    pop->pch = pchParam;
+    return pchCur;
+  }
+
+  // Check for function, and recursively compile its parameters.
+  ifunT = ILookupTrie(xi.rgsTrieFun, pchParam, cch, fTrue);
+  if (ifunT < 0)
+    return NULL;
+  pop->xop = xopFun;
+  pop->n = ifunT;
+  for (iParamT = 1; iParamT <= rgfun[ifunT].nParam; iParamT++) {
+    pchCur = PchCompileParameter(pchCur, rgop, piop);
+    if (pchCur == NULL)
+      return NULL;
+  }
+  pop->cop = (int)(&rgop[*piop] - pop);
+
+  // Fold function into a constant if it and its parameters are constant.
+  // The operations for the parameters remain, but are skipped over.
+  if (!FFoldFun(ifunT))
+    return pchCur;
+  popT = pop + 1;
+  for (iParamT = 1; iParamT <= rgfun[ifunT].nParam; iParamT++) {
+    if (popT->xop != xopNum)
+      return pchCur;
+    rgpar2[iParamT] = popT->par;
+    popT += popT->cop;
+  }
+  if (FEvalFunction(ifunT, rgpar2, (char **)rgpchEval, rgpopEval)) {
+    pop->xop = xopNum;
+    pop->par = rgpar2[0];
+  }
+  return pchCur;
+}
+
+
+// Evaluate one compiled operation along with any operations for parameters
+// following it, placing its value within parameter par. Return false on
+// error, in which case AstroExpressions are turned off like when parsing.
+
+flag FRunExpOp(CONST XOP *pop, PAR *ppar)
+{
+  CONST XOP *rgpopEval[2], *popT;
+  CONST char *rgpchEval[2] = {NULL, NULL}, *pch;
+  PAR rgpar2[4+1];
+  int ifun, iParam, iEval;
+
+  switch (pop->xop) {
+  case xopNum:
+    *ppar = pop->par;
+    return fTrue;
+  case xopVar:
+    if (!FEnsureParVar(pop->n+1))
+      break;
+    *ppar = xi.rgparVar[pop->n];
+    return fTrue;
+  case xopName:
+    if (FParseExpConstant(pop->pch, ppar))
+      return fTrue;
+    for (pch = pop->pch; *pch && *pch != ' '; pch++)
+      ;
+    ExpUnknownToken(pop->pch, (int)(pch - pop->pch), pch);
+    break;
+  case xopFun:
+    ifun = pop->n;
+    rgpopEval[0] = rgpopEval[1] = NULL;
+    popT = pop + 1;
+    for (iParam = 1; iParam <= rgfun[ifun].nParam; iParam++) {
+      // Skipped over function parameters are evaluated later if at all.
+      iEval = IEvalDeferred(ifun, iParam);
+      if (iEval >= 0)
+        rgpopEval[iEval] = popT;
+      if (iEval < 0 || popT->xop != xopFun)
+        if (!FRunExpOp(popT, &rgpar2[iParam]))
+          return fFalse;
+      popT += popT->cop;
+    }
+    if (!FEvalFunction(ifun, rgpar2, (char **)rgpchEval, rgpopEval))
+      return fFalse;
+    *ppar = rgpar2[0];
+    return fTrue;
+  }
+  us.fExpOff = fTrue;
+  return fFalse;
+}
+
+
+// Return the compiled code for an expression string, compiling it and
+// storing it in the cache if not done already. Code is looked up by string
+// pointer, and recompiled if the contents at that pointer have changed.
+// Return null if the string can't be compiled.
+
+XC *PxcEnsureExpCode(CONST char *sz)
+{
+  XC *pxc;
+  CONST char *pch;
+  int cop, iop;
+
+  if (xi.rgxc == NULL) {
+    xi.rgxc = RgAllocate(cxcMax, XC, "expression cache");
+    if (xi.rgxc == NULL)
+      return NULL;
+    ClearB((pbyte)xi.rgxc, cxcMax * sizeof(XC));
+  }
+  pxc = &xi.rgxc[IxcHash(sz)];
+  if (pxc->szKey == sz && pxc->szSrc != NULL && strcmp(pxc->szSrc, sz) == 0)
+    return pxc->rgop != NULL ? pxc : NULL;
+
+  // Code that's currently being evaluated can't be replaced.
+  if (xi.cxcRun > 0)
+    return NULL;
+  if (pxc->szSrc != NULL)
+    DeallocateP(pxc->szSrc);
+  if (pxc->rgop != NULL)
+    DeallocateP(pxc->rgop);
+  ClearB((pbyte)pxc, sizeof(XC));
+
+  // Each token in the string becomes one operation.
+  for (pch = sz, cop = 0; *pch; pch++)
+    if (*pch != ' ' && (pch == sz || pch[-1] == ' '))
+      cop++;
+  pxc->szSrc = RgAllocate(CchSz(sz)+1, char, "expression");
+  if (pxc->szSrc == NULL)
+    return NULL;
+  CopyRgb((pbyte)sz, (pbyte)pxc->szSrc, CchSz(sz)+1);
+  pxc->szKey = sz;
+  if (cop <= 0)
+    return NULL;
+  pxc->rgop = RgAllocate(cop, XOP, "expression code");
+  if (pxc->rgop == NULL)
+    return NULL;
+  pch = pxc->szSrc;
+  iop = 0;
+  while (iop < cop) {
+    pch = PchCompileParameter(pch, pxc->rgop, &iop);
+    if (pch == NULL)
+      break;
+  }
+  if (pch == NULL || *pch != chNull) {
+    DeallocateP(pxc->rgop);
+    pxc->rgop = NULL;
+    return NULL;
+  }
+  pxc->cop = cop;
+
+  // Code is invariant if all its top level expressions folded to constants.
+  pxc->fInvariant = fTrue;
+  for (iop = 0; iop < cop; iop += pxc->rgop[iop].cop)
+    if (pxc->rgop[iop].xop != xopNum)
+      pxc->fInvariant = fFalse;
+  return pxc;
+}
+
+
 // Like PchGetParameter() but parse multiple expressions in sequence in a
 // string, placing the value of the last expressions within parameter par.
+// Expressions are evaluated from their cached compiled code when possible.
 
 void GetParameter(CONST char *sz, PAR *ppar)
 {
   CONST char *pch = sz;
+  XC *pxc;
+  int iop;
+#ifdef TIME
+  clock_t clk = 0;
+#endif
 
-  do {
-    pch = PchGetParameter(pch, ppar, -1, 1, fTrue);
-  } while (pch != NULL && *pch != chNull);
+  pxc = PxcEnsureExpCode(sz);
+#ifdef TIME
+  if (us.fExpProfile)
+    clk = clock();
+#endif
+  if (pxc != NULL) {
+    xi.cxcRun++;
+    for (iop = 0; iop < pxc->cop; iop += pxc->rgop[iop].cop)
+      if (!FRunExpOp(&pxc->rgop[iop], ppar))
+        break;
+    xi.cxcRun--;
+  } else {
+    // Strings that couldn't be compiled are parsed each time instead.
+    do {
+      pch = PchGetParameter(pch, ppar, -1, 1, fTrue);
+    } while (pch != NULL && *pch != chNull);
+  }
+  if (!us.fExpProfile)
+    return;
+#ifdef TIME
+  clk = clock() - clk;
+#endif
+
+  // A string that failed to compile still has a cache slot to count in,
+  // unless its slot is taken by other code.
+  if (pxc == NULL && xi.rgxc != NULL) {
+    pxc = &xi.rgxc[IxcHash(sz)];
+    if (pxc->szKey != sz || pxc->szSrc == NULL || strcmp(pxc->szSrc, sz) != 0)
+      pxc = NULL;
+  }
+  if (pxc != NULL) {
+    pxc->ccall++;
+#ifdef TIME
+    pxc->clk += (long)clk;
+#endif
+  } else {
+    xi.ccallOther++;
+#ifdef TIME
+    xi.clkOther += (long)clk;
+#endif
+  }
 }
 
 
@@ -2483,6 +2843,62 @@ flag ShowParseExpression(CONST char *sz)
 }
 
 
+// Return whether an expression string always evaluates to the same constant
+// value without side effects. Hooks like this don't depend on their inputs,
+// and so only need to be evaluated once outside of any loop, if at all. The
+// -~O and -~C hooks still set their @V-@Z inputs when skipped, but a skipped
+// -~A hook doesn't, since the aspect kernel never visits most pairs.
+
+flag FExpInvariant(CONST char *sz)
+{
+  XC *pxc;
+
+  if (us.fNoExp || us.fExpOff || (xi.rgsTrieFun == NULL && !FCreateTries()))
+    return fFalse;
+  pxc = PxcEnsureExpCode(sz);
+  return pxc != NULL && pxc->fInvariant;
+}
+
+
+// Display how many times each AstroExpression was evaluated and how long
+// that took, slowest first, as collected by the -~T switch. Strings that
+// couldn't be compiled are shown as interpreted.
+
+void PrintExpProfile(void)
+{
+  char sz[cchSzMax], szT[cchSzDef];
+  int rgi[cxcMax], ci = 0, i, j;
+  XC *pxc;
+  real rSec;
+
+  for (i = 0; i < cxcMax && xi.rgxc != NULL; i++) {
+    if (xi.rgxc[i].ccall <= 0)
+      continue;
+    for (j = ci; j > 0 && xi.rgxc[rgi[j-1]].clk < xi.rgxc[i].clk; j--)
+      rgi[j] = rgi[j-1];
+    rgi[j] = i;
+    ci++;
+  }
+  for (i = 0; i < ci; i++) {
+    pxc = &xi.rgxc[rgi[i]];
+    rSec = (real)pxc->clk / (real)CLOCKS_PER_SEC;
+    CopyRgchToSz(pxc->szSrc, CchSz(pxc->szSrc), szT, 48);
+    sprintf(sz, "AstroExpression %s %ld times in %.3f seconds "
+      "(%.2f microseconds each): '%s'",
+      pxc->rgop != NULL ? "evaluated" : "interpreted", pxc->ccall, rSec,
+      rSec * 1000000.0 / (real)pxc->ccall, szT);
+    PrintNotice(sz);
+  }
+  if (xi.ccallOther > 0) {
+    rSec = (real)xi.clkOther / (real)CLOCKS_PER_SEC;
+    sprintf(sz, "Other AstroExpressions interpreted %ld times in %.3f seconds "
+      "(%.2f microseconds each).", xi.ccallOther, rSec,
+      rSec * 1000000.0 / (real)xi.ccallOther);
+    PrintNotice(sz);
+  }
+}
+
+
 // Get a parameter in integer format.
 
 int NExpGet(int i)
@@ -2625,6 +3041,19 @@ char *PchFormatString(char *sz, int i)
 
 void ExpFinalize(void)
 {
+  int i;
+
+  if (us.fExpProfile)
+    PrintExpProfile();
+  if (xi.rgxc != NULL) {
+    for (i = 0; i < cxcMax; i++) {
+      if (xi.rgxc[i].szSrc != NULL)
+        DeallocateP(xi.rgxc[i].szSrc);
+      if (xi.rgxc[i].rgop != NULL)
+        DeallocateP(xi.rgxc[i].rgop);
+    }
+    DeallocateP(xi.rgxc);
+  }
   if (xi.rgsTrieFun != NULL)
     DeallocateP(xi.rgsTrieFun);
   if (xi.rgparVar != NULL)
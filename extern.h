@@ -66,6 +66,13 @@
 // From astrolog.cpp
 
 extern void InitColors P((void));
+extern void SetListChart P((int, int));
+extern int NActionChart P((int, flag));
+#ifdef THREADS
+extern void ListChartFromIndex P((long, int *, int *));
+extern void ListChartJob P((int, void *));
+extern flag FActionListThreads P((int, int *, int *));
+#endif
 extern void Action P((void));
 extern void InitVariables P((void));
 extern flag FProcessCommandLine P((CONST char *));
@@ -143,21 +150,22 @@ extern void FinalizeProgram P((flag));
 #define FCmMatrix() (!us.fEphemFiles && us.fMatrixPla)
 #define FCmJPLWeb() (us.fEphemFiles && !us.fPlacalcPla && us.nSwissEph >= 3)
 
-extern US us;
-extern IS is;
-extern CI ciCore, ciMain, ciTwin, ciThre, ciFour, ciFive, ciHexa,
-  ciTran, ciSave, ciGreg;
-extern CP cp0, cp1, cp2, cp3, cp4, cp5, cp6;
-extern CP * CONST rgpcp[cRing+1];
-extern CI * CONST rgpci[cRing+1];
+extern TLOCAL US us;
+extern TLOCAL IS is;
+extern TLOCAL CI ciCore, ciMain, ciTwin, ciThre, ciFour, ciFive, ciHexa,
+  ciTran, ciSave;
+extern CI ciGreg;
+extern TLOCAL CP cp0, cp1, cp2, cp3, cp4, cp5, cp6;
+extern TLOCAL CP *rgpcp[cRing+1];
+extern TLOCAL CI *rgpci[cRing+1];
 
 extern real force[objMax];
-extern GridInfo *grid;
-extern int rgobjList[objMax], rgobjList2[objMax], starname[cStar+1],
-  kObjA[objMax];
+extern TLOCAL GridInfo *grid;
+extern TLOCAL int rgobjList[objMax], rgobjList2[objMax], kObjA[objMax];
+extern int starname[cStar+1];
 
-extern byte ignore[objMax], ignore2[objMax], ignorea[cAspect+1],
-  ignorez[arMax], ignore7[rrMax], pluszone[cSector+1];
+extern TLOCAL byte ignore[objMax], ignore2[objMax], ignore7[rrMax];
+extern byte ignorea[cAspect+1], ignorez[arMax], pluszone[cSector+1];
 extern byte ignoreMem[objMax], ignore2Mem[objMax], ignoreaMem[cAspect+1],
   ignorezMem[arMax], ignore7Mem[rrMax], ignorefMem[6];
 extern real rAspAngle[cAspect+1], rAspOrb[cAspect+1], rObjOrb[oNorm+2],
@@ -211,14 +219,14 @@ extern CONST StrLookR rgZodiacOffset[];
 extern CONST char *szNakshatra[27+1], *szEclipse[etMax], rgchEclipse[etMax+1],
   *szAppSep[6], rgchAppSep[6+1];
 
-extern real rStarBrightDef[cStar+1], rStarBright[cStar+1],
-  rStarBrightDistDef[cStar+1];
+extern real rStarBrightDef[cStar+1], rStarBrightDistDef[cStar+1];
+extern TLOCAL real rStarBright[cStar+1];
 extern char *szStarCustom[cStar+1];
 extern CONST char *szObjDisp[objMax], *szAspectDisp[cAspect2+1],
   *szAspectAbbrevDisp[cAspect2+1], *szAspectGlyphDisp[cAspect2+1];
 
 extern CONST real rObjDist[oNorm+1], rObjYear[oNorm+1], rObjDay[oNorm+1],
-  rObjMass[oPlu+1], rObjAxis[oPlu+1];
+  rObjMass[oPlu+1], rObjAxis[oPlu+1], rObjSpeedMax[oSou+1];
 extern real rObjDiam[oNorm+1];
 extern CONST int cSatellite[oPlu+1], nMooMap[6][8], rgobjHasMoons[cHasMoons];
 
@@ -377,6 +385,10 @@ extern FILE *FileOpen P((CONST char *, int, char *));
 extern byte BRead P((FILE *));
 extern word WRead P((FILE *));
 extern dword LRead P((FILE *));
+extern pbyte PbMapFile P((CONST char *, FILE *, long *));
+extern pbyte PbReadFile P((FILE *, long *));
+extern void GetFileStamp P((FILE *, long *, long *));
+extern void UnmapFile P((pbyte, long));
 extern flag FProcessSwitchFile P((CONST char *, FILE *));
 extern flag FOutputData P((void));
 extern flag FOutputAAFFile P((void));
@@ -437,16 +449,42 @@ extern void CoorXform P((real *, real *, real));
 extern void CoorXformFast P((real *, real *,
   real, real, real, real, real, real));
 extern void ProcessPlanet P((int, real));
+extern void PosCacheClear P((void));
+extern flag FPosCacheEnsure P((void));
+extern flag FPosCacheGet P((int, real, int, flag, real *));
+extern void PosCacheSet P((int, real, int, flag, CONST real *));
+extern void PosCacheClose P((void));
+extern void PrintPosCacheStats P((void));
 extern void ComputeEphem P((real));
+extern flag FCastCacheEnsure P((void));
+extern flag FCastCacheGet P((CONST CI *));
+extern void CastCacheSet P((CONST CI *));
+extern void CastCacheClose P((void));
+extern void SetCastTime P((void));
+extern flag FAdjustPositions P((void));
+extern void AdjustPositions P((void));
 extern real CastChart P((int));
+extern flag FCastObjectsOnly P((void));
 extern void CastSectors P((void));
+extern void InitChartContext P((void));
+extern void SaveChartContext P((CC *));
+extern void LoadChartContext P((CONST CC *));
+extern int NThreadCount P((void));
+extern void RunThreadJobs P((int, void (*)(int, void *), void *));
 extern flag FEnsureGrid P((void));
 extern flag FAcceptAspect P((int, int, int));
 extern int GetAspect P((CONST real *, CONST real *, CONST real *,
   CONST real *, CONST real *, CONST real *, int, int, real *));
 extern int GetParallel P((CONST real *, CONST real *, CONST real *,
   CONST real *, CONST real *, CONST real *, int, int, real *));
+extern int GetDistance P((CONST PT3R *, CONST PT3R *, CONST real *,
+  CONST real *, int, int, real *));
+extern flag FAspectKernel P((void));
+extern void AspectKernelInit P((AK *, CONST real *, CONST real *, flag));
+extern int IStarIndex P((CONST AK *, real));
+extern flag FAspectKernelRow P((AK *, int, real, real, flag, int, int));
 extern flag FCreateGrid P((flag));
+extern void GridRelationClose P((void));
 extern flag FCreateGridRelation P((flag));
 extern int NCheckEclipse P((int, int, real *));
 extern int NCheckEclipseLunar P((int, int, int, real *));
@@ -458,6 +496,10 @@ extern CONST int rgObjSwissDef[cCust], rgTypSwissDef[cCust];
 extern int rgObjSwiss[cCust], rgTypSwiss[cCust], rgPntSwiss[cCust],
   rgFlgSwiss[cCust];
 
+extern void SwissSetSidMode P((void));
+extern flag FChebBegin P((real, real));
+extern void ChebEnd P((void));
+extern flag FChebPlanet P((double, int, int, int, double *));
 extern flag FSwissPlanet
   P((int, real, int, real *, real *, real *, real *, real *, real *));
 extern void SwissHouse P((real, real, real, int,
@@ -465,6 +507,9 @@ extern void SwissHouse P((real, real, real, int,
 extern void SwissComputeStars P((real, flag));
 extern flag SwissComputeStar P((real, ES *));
 extern flag SwissTestStar P((char *));
+extern void SwissAsteroidJob P((int, void *));
+extern void SwissComputeAsteroids P((CONST int *, int, real,
+  real *, real *, real *, real *, flag *));
 extern flag SwissComputeAsteroid P((real, ES *, flag));
 extern void SwissGetObjName P((char *, int));
 extern flag FSwissPlanetData P((real, int, real *, real *, real *));
@@ -473,6 +518,11 @@ extern void SwissGetFileData P((real *, real *));
 extern real SwissLatLmt P((real));
 extern real SwissJulDay P((int, int, int, real, int));
 extern void SwissRevJul P((real, int, int *, int *, int *, real *));
+extern void SwissClose P((void));
+extern void SwissUnmapFiles P((void));
+extern void SwissPreload P((real, real));
+extern void SwissPreloadWait P((void));
+extern void PrintPreloadStats P((void));
 #else
 #define SwissRefract(r) (r)
 #define SwissLatLmt(r) 0.0
@@ -580,6 +630,9 @@ extern void PrintChart P((flag));
 extern void ChartListingRelation P((void));
 extern void ChartGridRelation P((void));
 extern void ChartAspectRelation P((void));
+extern void ListPairCastJob P((int, void *));
+extern void ListPairTileJob P((int, void *));
+extern void ChartListPairs P((void));
 extern void ChartMidpointRelation P((void));
 extern void CastRelation P((void));
 extern void PrintInDayEvent P((int, int, int, int));
@@ -600,6 +653,25 @@ extern void DisplayRelation P((void));
   ((obj1) == oMoo || (obj2) == oMoo) && (obj1) <= oPlu && (obj2) <= oPlu)
 
 extern int CheckSignChange P((InDayInfo *, int, int, real, int, int, int));
+extern real REventOffset P((CONST EventRoot *, real));
+extern real RRefineEvent P((EventRoot *, real, real, real, real, real, real));
+extern flag FInitEventSchedule P((EventSchedule *, flag));
+extern void ResetEventSchedule P((EventSchedule *));
+extern void AdvanceEventSchedule P((EventSchedule *));
+extern flag FEventDue P((EventSchedule *, int, int, real, real, int));
+extern flag FSignDue P((EventSchedule *, int, real));
+extern int NInDayScan P((InDayInfo *, int, int, int, int, int, flag));
+#ifdef THREADS
+extern void InDayScanJob P((int, void *));
+#endif
+extern void TransitScanCast P((CONST TransitScan *, int));
+extern void ScheduleTransitCast P((CONST TransitScan *, EventSchedule *, int,
+  real));
+extern int NTransitScan P((CONST TransitScan *, TransInfo *, int, int, real,
+  EventSchedule *));
+#ifdef THREADS
+extern void TransitScanJob P((int, void *));
+#endif
 
 extern void ChartInDaySearch P((flag));
 extern void ChartTransitSearch P((flag));
@@ -640,6 +712,15 @@ extern void ChartInfluence P((void));
 // From atlas.cpp
 
 extern char *SzCity P((int));
+extern void FreeAtlas P((void));
+extern flag FAtlasSourceStamp P((long *, long *));
+extern flag FLoadAtlasBin P((void));
+extern flag FWriteAtlasBin P((CONST char *));
+extern int ITriFromSz P((CONST char *));
+extern int ICellFromLonLat P((real, real));
+extern flag FEnsureAtlasIndex P((void));
+extern void AtlasBoxInit P((AtlasBox *, real, real, real, real));
+extern int IaeAtlasBoxNext P((AtlasBox *));
 extern flag FEnsureAtlas P((void));
 extern flag FEnsureTimezoneChanges P((void));
 extern flag FLoadAtlas P((FILE *, int));
@@ -648,6 +729,11 @@ extern flag FLoadZoneChanges P((FILE *, int, int));
 extern flag FLoadZoneLinks P((FILE *, int));
 extern flag DisplayAtlasLookup P((CONST char *, size_t, int *));
 extern flag DisplayAtlasNearby P((real, real, size_t, int *, flag));
+extern void FreeZoneTables P((void));
+extern flag FZoneTableAdd P((CONST ZoneEvent *));
+extern ZoneTable *PztEnsureZone P((int));
+extern flag FZoneEventAfter P((CONST ZoneEvent *, CONST CI *));
+extern flag FZoneTableLookup P((int, CI *));
 extern flag DisplayTimezoneChanges P((int, size_t, CI *));
 extern real ZondefFromIzn P((int));
 #endif
@@ -661,6 +747,8 @@ extern real ZondefFromIzn P((int));
 extern long NParseExpression P((CONST char *));
 extern real RParseExpression P((CONST char *));
 extern flag ShowParseExpression P((CONST char *));
+extern flag FExpInvariant P((CONST char *));
+extern void PrintExpProfile P((void));
 extern int NExpGet P((int));
 extern real RExpGet P((int));
 extern flag ExpSetN P((int, int));
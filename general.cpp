@@ -562,7 +562,7 @@ void SphRatio(real lon1, real lat1, real lon2, real lat2, real rRatio,
 
 char *Dignify(int obj, int sign)
 {
-  static char szDignify[7];
+  static TLOCAL char szDignify[7];
   int sign2 = Mod12(sign+6), ray, ich;
 
   sprintf(szDignify, "-_____");
@@ -647,7 +647,13 @@ void EnsureRay()
 
 
 // Initialize table of star brightnesses. Usually only called once before
-// first star accessed, but may be redone if computation method changes.
+// first star accessed, but may be redone if computation method changes. The
+// table is shared by all threads, so only one thread fills it in, and the
+// mode is set last so other threads don't use a partly filled table.
+
+#ifdef THREADS
+pthread_mutex_t mutexStarBright = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 void EnsureStarBright()
 {
@@ -655,8 +661,10 @@ void EnsureStarBright()
   real rMode;
 
   rMode = FCmSwissStar() ? 1.0 : 0.0;
+#ifdef THREADS
+  pthread_mutex_lock(&mutexStarBright);
+#endif
   if (rStarBrightDef[0] != rMode) {
-    rStarBrightDef[0] = rMode;
 
     // Matrix formulas have star brightnesses in a simple table.
     for (i = 1; i <= cStar; i++) {
@@ -675,7 +683,11 @@ void EnsureStarBright()
     if (FCmSwissStar())
       SwissComputeStars(0.0, fTrue);
 #endif
+    rStarBrightDef[0] = rMode;
   }
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexStarBright);
+#endif
 }
 
 
@@ -1586,7 +1598,7 @@ char ChDeg()
 
 char *SzZodiac(real deg)
 {
-  static char szZod[12];
+  static TLOCAL char szZod[12];
   int sign, d, m;
   real s;
 
@@ -1643,7 +1655,7 @@ char *SzZodiac(real deg)
 
 char *SzAltitude(real deg)
 {
-  static char szAlt[11];
+  static TLOCAL char szAlt[11];
   int d, m, f;
   real s;
 
@@ -1675,7 +1687,7 @@ char *SzAltitude(real deg)
 
 char *SzDegree(real deg)
 {
-  static char szPos[11];
+  static TLOCAL char szPos[11];
   int d, m;
   real s;
 
@@ -1705,7 +1717,7 @@ char *SzDegree(real deg)
 
 char *SzDegree2(real deg)
 {
-  static char szPos[11], *pch;
+  static TLOCAL char szPos[11], *pch;
   int d, m;
   real s;
 
@@ -1735,7 +1747,7 @@ char *SzDegree2(real deg)
 
 char *SzHMS(int sec)
 {
-  static char szHMS[10];
+  static TLOCAL char szHMS[10];
   int hr, min;
   char ch;
 
@@ -1762,7 +1774,7 @@ char *SzHMS(int sec)
 
 char *SzDate(int mon, int day, int yea, int nFormat)
 {
-  static char szDat[20];
+  static TLOCAL char szDat[20];
 
   if (us.fEuroDate) {
     switch (nFormat) {
@@ -1790,7 +1802,7 @@ char *SzDate(int mon, int day, int yea, int nFormat)
 
 char *SzTime(int hr, int min, int sec)
 {
-  static char szTim[11];
+  static TLOCAL char szTim[11];
 
   while (min >= 60) {
     min -= 60;
@@ -1837,7 +1849,7 @@ char *SzTim(real tim)
 
 char *SzZone(real zon)
 {
-  static char szZon[7];
+  static TLOCAL char szZon[7];
 
   if (zon == zonLMT)
     sprintf(szZon, "LMT");
@@ -1858,7 +1870,7 @@ char *SzZone(real zon)
 
 char *SzLocation(real lon, real lat)
 {
-  static char szLoc[21];
+  static TLOCAL char szLoc[21];
   int i, j, i2, j2;
   char chDeg, chLon, chLat;
 
@@ -1936,7 +1948,7 @@ char *SzLocation(real lon, real lat)
 
 char *SzElevation(real elv)
 {
-  static char szElev[21];
+  static TLOCAL char szElev[21];
   char *pch;
 
   FormatR(szElev, us.fEuroDist ? elv : elv / rFtToM, -2);
@@ -1952,7 +1964,7 @@ char *SzElevation(real elv)
 
 char *SzTemperature(real tmp)
 {
-  static char szTemp[21];
+  static TLOCAL char szTemp[21];
   char *pch;
 
   FormatR(szTemp, us.fEuroDist ? tmp : tmp * 9.0/5.0 + 32.0, -2);
@@ -1968,7 +1980,7 @@ char *SzTemperature(real tmp)
 
 char *SzLength(real len)
 {
-  static char szLen[21];
+  static TLOCAL char szLen[21];
   char *pch;
 
   FormatR(szLen, !us.fEuroDist ? len : len * rInToCm, -2);
@@ -2106,9 +2118,10 @@ flag FAppendCIList(CONST CI *pci)
       return fTrue;
   }
 
-  // Extend the size of the chart list allocation if necessary.
+  // Extend the size of the chart list allocation if necessary. Growing by
+  // doubling keeps appending large lists linear time overall.
   if (is.cci >= is.cciAlloc) {
-    cciAlloc = is.cciAlloc + 500;
+    cciAlloc = Max(is.cciAlloc * 2, 500);
     pciNew = (CI *)RgAllocate(cciAlloc, CI, "chart list");
     if (pciNew == NULL)
       return fFalse;
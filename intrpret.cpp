@@ -66,8 +66,8 @@
 
 void FieldWord(CONST char *sz)
 {
-  static char line[cchSzMax];
-  static int cursor = 0;
+  static TLOCAL char line[cchSzMax];
+  static TLOCAL int cursor = 0;
   int ich = 0, i, j;
   char ch;
 
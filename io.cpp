@@ -249,6 +249,135 @@ dword LRead(FILE *file)
 }
 
 
+// Map a whole file into memory for reading, returning its contents and
+// setting its size in bytes. The file is given by name, or by an already
+// open file handle if one is passed. Where memory mapping isn't available,
+// the file is read into an allocated buffer instead. Return NULL if the file
+// can't be opened or is empty. The contents should be released with
+// UnmapFile().
+
+pbyte PbMapFile(CONST char *szFile, FILE *file, long *pcb)
+{
+#ifndef PC
+  struct stat st;
+  void *pv;
+  int fd;
+
+  fd = file != NULL ? fileno(file) : open(szFile, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    if (file == NULL)
+      close(fd);
+    return NULL;
+  }
+  pv = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (file == NULL)
+    close(fd);
+  if (pv == MAP_FAILED)
+    return NULL;
+  *pcb = (long)st.st_size;
+  return (pbyte)pv;
+#else
+  pbyte pb = NULL;
+  long cb;
+  flag fHaveFile = (file != NULL);
+
+  if (!fHaveFile) {
+    file = fopen(szFile, "rb");
+    if (file == NULL)
+      return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  cb = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (cb > 0)
+    pb = (pbyte)PAllocate(cb, "mapped file");
+  if (pb != NULL && fread(pb, 1, cb, file) != (size_t)cb) {
+    DeallocateP(pb);
+    pb = NULL;
+  }
+  if (!fHaveFile)
+    fclose(file);
+  if (pb != NULL)
+    *pcb = cb;
+  return pb;
+#endif
+}
+
+
+// Read the rest of an open file into an allocated buffer, for streams such
+// as pipes or standard input that can't be mapped or seeked. Return NULL if
+// nothing could be read. The contents should be released with DeallocateP().
+
+pbyte PbReadFile(FILE *file, long *pcb)
+{
+  pbyte pb = NULL, pbNew;
+  long cb = 0, cbAlloc = 0;
+  size_t cbRead;
+
+  loop {
+    if (cb >= cbAlloc) {
+      cbAlloc = Max(cbAlloc << 1, 65536);
+      pbNew = (pbyte)PAllocate(cbAlloc, "file buffer");
+      if (pbNew == NULL) {
+        if (pb != NULL)
+          DeallocateP(pb);
+        return NULL;
+      }
+      if (pb != NULL) {
+        CopyRgb(pb, pbNew, (int)cb);
+        DeallocateP(pb);
+      }
+      pb = pbNew;
+    }
+    cbRead = fread(pb + cb, 1, cbAlloc - cb, file);
+    if (cbRead == 0)
+      break;
+    cb += (long)cbRead;
+  }
+  if (cb <= 0) {
+    DeallocateP(pb);
+    return NULL;
+  }
+  *pcb = cb;
+  return pb;
+}
+
+
+// Get the size in bytes and the last modification time of an open file.
+// Where file times aren't available, the time returned is zero.
+
+void GetFileStamp(FILE *file, long *pcb, long *ptm)
+{
+#ifndef PC
+  struct stat st;
+
+  if (fstat(fileno(file), &st) == 0) {
+    *pcb = (long)st.st_size;
+    *ptm = (long)st.st_mtime;
+    return;
+  }
+#endif
+  fseek(file, 0, SEEK_END);
+  *pcb = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  *ptm = 0;
+}
+
+
+// Release the contents of a file mapped into memory with PbMapFile().
+
+void UnmapFile(pbyte pb, long cb)
+{
+#ifndef PC
+  munmap(pb, (size_t)cb);
+#else
+  DeallocateP(pb);
+#endif
+}
+
+
 // This is Astrolog's generic file processing routine, which handles chart
 // info files, position files, and config files. Given a file name or a file
 // handle, run through each line as a series of command switches.
@@ -776,181 +905,276 @@ LDone:
 }
 
 
-// Load a Astrodatabank XML format file into the default set of chart
-// information, given a file name or a file handle.
+// Attribute names within Astrodatabank XML records, indexed by the bit they
+// set in the field mask used by FProcessADBFile().
 
-flag FProcessADBFile(CONST char *szFile, FILE *file)
+CONST char *rgszADBAttr[] = {"imonth", "iday", "iyear", "sbtime_ampm",
+  "ctimetype", "stmerid", "slong", "slati"};
+
+// Return the first occurrence of a string within a range of memory, or NULL
+// if it doesn't occur there. The comparison is case sensitive.
+
+CONST char *PchFindRgch(CONST char *pch, CONST char *pchEnd,
+  CONST char *sz, int cch)
 {
-  char szLine[cchSzLine], sz[cchSzDef], szLoc1[cchSzDef], szLoc2[cchSzDef],
-    ch, *pch, *pch2;
-  int i, grf, cchSz = CchSz(us.szADB);
-  flag fHaveFile, fDidOne = fFalse, fDidStart, fDidEnd, fDidLon, fRet = fFalse;
+  CONST char *pchMax = pchEnd - cch;
 
-  fHaveFile = (file != NULL);
-  if (!fHaveFile) {
-    file = FileOpen(szFile, 0, NULL);
-    if (file == NULL)
-      goto LDone;
+  while (pch <= pchMax) {
+    pch = (CONST char *)memchr(pch, *sz, pchMax - pch + 1);
+    if (pch == NULL)
+      break;
+    if (FEqRgch(pch, sz, cch, fFalse))
+      return pch;
+    pch++;
   }
-  is.fileIn = file;
-  do {
-#ifdef EXPRESS
-    if (!us.fExpOff && FSzSet(us.szExpADB)) {
-      for (i = us.iExpADB; i < us.iExpADB + us.cExpADB; i++)
-        if (!ExpSetN(i, 0))
-          goto LDone;
-    }
-#endif
+  return NULL;
+}
 
-  fDidStart = fDidEnd = fFalse;
-  grf = 0;
-  while (!fDidEnd) {
-    while (!feof(file) && (ch = getc(file)) < ' ')
-      ;
-    if (feof(file))
+
+// Parse one Astrodatabank XML record from a file mapped into memory, given
+// the start of its <adb_entry> tag, filling out the default chart information
+// with its fields. This tokenizes the tags, attributes, and text of the
+// record in a single pass, where the first occurrence of each field wins.
+// Return a mask of the fields found, and set the pointer past the record.
+
+int GrfParseADBRecord(CONST char **ppch, CONST char *pchEnd)
+{
+  char sz[cchSzMax], szLoc1[cchSzDef], szLoc2[cchSzDef], chQuote;
+  CONST char *pch = *ppch, *pchName, *pchAttr, *pchVal;
+  int cchName, cchAttr, grf = 0, i, f;
+  flag fLon;
+
+  szLoc1[0] = chNull;
+  loop {
+    pch = (CONST char *)memchr(pch, '<', pchEnd - pch);
+    if (pch == NULL) {
+      pch = pchEnd;
       break;
-    for (szLine[0] = ch, i = 1; i < cchSzLine-1 && !feof(file) &&
-      (uchar)(szLine[i] = getc(file)) >= ' '; i++)
+    }
+    pch++;
+
+    // Closing tags end the record if they're for the record itself.
+    if (pch < pchEnd && *pch == '/') {
+      if (pchEnd - pch >= 11 && FEqRgch(pch+1, "adb_entry>", 10, fFalse)) {
+        pch += 11;
+        break;
+      }
+      continue;
+    }
+    for (pchName = pch; pch < pchEnd && (uchar)*pch > ' ' && *pch != '>' &&
+      *pch != '/'; pch++)
       ;
-    szLine[i] = chNull;
-    fDidLon = fFalse;
-    for (pch = szLine; *pch; pch++) {
-      if (FEqRgch(pch, "<adb_entry", 10, fFalse))
-        fDidStart = fTrue;
-      else if (!fDidStart)
+    cchName = (int)(pch - pchName);
+
+    // Scan the attributes within the tag.
+    fLon = fFalse;
+    loop {
+      while (pch < pchEnd && (uchar)*pch <= ' ')
+        pch++;
+      if (pch >= pchEnd || *pch == '>' || *pch == '/' || *pch == '<')
+        break;
+      for (pchAttr = pch; pch < pchEnd && *pch != '=' && *pch != '>' &&
+        (uchar)*pch > ' '; pch++)
+        ;
+      cchAttr = (int)(pch - pchAttr);
+      if (pch >= pchEnd || *pch != '=')
         continue;
-      if (FEqRgch(pch, "</adb_entry>", 12, fFalse))
-        fDidEnd = fTrue;
-      if ((grf & 1) == 0 && FEqRgch(pch, "imonth=\"", 8, fFalse)) {
-        MM = atoi(pch + 8);
-        grf |= 1;
-      }
-      if ((grf & 2) == 0 && FEqRgch(pch, "iday=\"", 6, fFalse)) {
-        DD = atoi(pch + 6);
-        grf |= 2;
-      }
-      if ((grf & 4) == 0 && FEqRgch(pch, "iyear=\"", 7, fFalse)) {
-        YY = atoi(pch + 7);
-        grf |= 4;
+      pch++;
+      if (pch >= pchEnd || (*pch != '"' && *pch != '\''))
+        continue;
+      chQuote = *pch++;
+      for (pchVal = pch; pch < pchEnd && *pch != chQuote; pch++)
+        ;
+      CopyRgchToSz(pchVal, (int)(pch - pchVal), sz, cchSzDef);
+      if (pch < pchEnd)
+        pch++;
+      for (i = 0; i < 8; i++) {
+        f = 1 << i;
+        if ((grf & f) == 0 && cchAttr == CchSz(rgszADBAttr[i]) &&
+          FEqRgch(pchAttr, rgszADBAttr[i], cchAttr, fFalse))
+          break;
       }
-      if ((grf & 8) == 0 && FEqRgch(pch, "sbtime_ampm=\"", 13, fFalse)) {
-        pch += 13;
-        for (pch2 = pch; *pch2 && *pch2 != '"'; pch2++)
-          ;
-        CopyRgchToSz(pch, pch2 - pch, sz, cchSzDef);
+      switch (i) {
+      case 0: MM = atoi(sz); break;
+      case 1: DD = atoi(sz); break;
+      case 2: YY = atoi(sz); break;
+      case 3:
         if (*sz)
           TT = RParseSz(sz, pmTim);
         else
           TT = 12.0;  // Some records are "unknown, 12:00 used"
-        grf |= 8;
-      }
-      if ((grf & 16) == 0 && FEqRgch(pch, "ctimetype=\"", 11, fFalse)) {
-        if (pch[11] != 'l') {
-          SS = pch[11] == 'd' ? 1.0 : 0.0;
-          grf |= 16;
-        } else {
+        break;
+      case 4:
+        if (*sz != 'l')
+          SS = *sz == 'd' ? 1.0 : 0.0;
+        else {
           SS = 0.0; ZZ = zonLMT;
-          grf |= (16 | 32);
-        }
-      }
-      if ((grf & 32) == 0 && FEqRgch(pch, "stmerid=\"", 9, fFalse)) {
-        pch += 9;
-        for (pch2 = pch; *pch2 && *pch2 != '"'; pch2++)
-          ;
-        CopyRgchToSz(pch, pch2 - pch, sz, cchSzDef);
-        ZZ = RParseSz(sz, pmZon);
-        grf |= 32;
-      }
-      if ((grf & 64) == 0 && FEqRgch(pch, "slong=\"", 7, fFalse)) {
-        OO = RParseSz(pch + 7, pmLon);
-        grf |= 64;
-        fDidLon = fTrue;
-      }
-      if ((grf & 128) == 0 && FEqRgch(pch, "slati=\"", 7, fFalse)) {
-        AA = RParseSz(pch + 7, pmLat);
-        grf |= 128;
-      }
-      if ((grf & 256) == 0 && FEqRgch(pch, "<sflname>", 9, fFalse)) {
-        pch += 9;
-        while (*pch == ' ')
-          pch++;
-        for (pch2 = pch; *pch2 && *pch2 != '<'; pch2++)
-          ;
-        CopyRgchToSz(pch, pch2 - pch, sz, cchSzDef);
-        ConvertSzFromUTF8(sz);
-        ciCore.nam = SzCopy(sz);
-        grf |= 256;
-      }
-      if ((grf & 512) == 0 && fDidLon && FEqRgch(pch, "\">", 2, fFalse)) {
-        pch += 2;
-        for (pch2 = pch; *pch2 && *pch2 != '<'; pch2++)
-          ;
-        CopyRgchToSz(pch, pch2 - pch, szLoc1, cchSzDef);
-        grf |= 512;
-      }
-      if ((grf & 1024) == 0 && FEqRgch(pch, "<country", 8, fFalse)) {
-        for (pch2 = pch + 8; *pch2 && *pch2 != '>'; pch2++)
-          ;
-        pch = pch2 + (*pch2 == '>');
-        for (pch2 = pch; *pch2 && *pch2 != '<'; pch2++)
-          ;
-        CopyRgchToSz(pch, pch2 - pch, szLoc2, cchSzDef);
-        sprintf(sz, "%s, %s", szLoc1, szLoc2);
-        ConvertSzFromUTF8(sz);
-        ciCore.loc = SzCopy(sz);
-        grf |= 1024;
-      }
-      if (cchSz > 0 && (grf & 2048) == 0 &&
-        FEqRgch(pch, us.szADB, cchSz, fFalse))
-        grf |= 2048;
-#ifdef EXPRESS
-      if (!us.fExpOff && FSzSet(us.szExpADB)) {
-        for (i = us.iExpADB; i < us.iExpADB + us.cExpADB; i++) {
-          pch2 = ExpGetString(i);
-          if (FSzSet(pch2) && FEqRgch(pch2, pch, CchSz(pch2), fFalse)) {
-            if (!ExpSetN(i, NExpGet(i) + 1))
-              goto LDone;
-          }
+          f |= 32;
         }
+        break;
+      case 5: ZZ = RParseSz(sz, pmZon); break;
+      case 6: OO = RParseSz(sz, pmLon); fLon = fTrue; break;
+      case 7: AA = RParseSz(sz, pmLat); break;
+      default: continue;
       }
-#endif
+      grf |= f;
     }
-  }
-
-  if ((grf & 2047) != 2047) {
-    if (grf == 0 && fDidOne) {
-      fRet = fTrue;
-      goto LDone;
+    pch = (CONST char *)memchr(pch, '>', pchEnd - pch);
+    if (pch == NULL) {
+      pch = pchEnd;
+      break;
     }
-    if (grf == 0)
-      PrintWarning("Couldn't find any charts in Astrodatabank file.");
+    pch++;
+
+    // Process the text following the tag, for those tags that have any.
+    if ((grf & 256) == 0 && cchName == 7 &&
+      FEqRgch(pchName, "sflname", 7, fFalse))
+      f = 256;
+    else if ((grf & 512) == 0 && fLon)
+      f = 512;
+    else if ((grf & 1024) == 0 && cchName == 7 &&
+      FEqRgch(pchName, "country", 7, fFalse))
+      f = 1024;
     else
-      PrintWarning("Couldn't detect all fields in Astrodatabank file.");
-    goto LDone;
-  }
-  ZZ += SS;
-  if (!FValidMon(MM) || !FValidDay(DD, MM, YY) || !FValidYea(YY) ||
-    !FValidTim(TT) || !FValidZon(ZZ) || !FValidLon(OO) || !FValidLat(AA)) {
-    PrintWarning("Values in Astrodatabank file are out of range.");
-    goto LDone;
+      continue;
+    if (f == 256)
+      while (pch < pchEnd && *pch == ' ')
+        pch++;
+    for (pchVal = pch; pch < pchEnd && *pch != '<'; pch++)
+      ;
+    i = (int)(pch - pchVal);
+    if (f == 256) {
+      CopyRgchToSz(pchVal, i, sz, cchSzDef);
+      ConvertSzFromUTF8(sz);
+      ciCore.nam = SzCopy(sz);
+    } else if (f == 512)
+      CopyRgchToSz(pchVal, i, szLoc1, cchSzDef);
+    else {
+      CopyRgchToSz(pchVal, i, szLoc2, cchSzDef);
+      sprintf(sz, "%s, %s", szLoc1, szLoc2);
+      ConvertSzFromUTF8(sz);
+      ciCore.loc = SzCopy(sz);
+    }
+    grf |= f;
   }
-  if (cchSz > 0 && (grf & 2048) == 0)
-    continue;
+  *ppch = pch;
+  return grf;
+}
+
+
+// Load a Astrodatabank XML format file into the chart list, given a file
+// name or a file handle. The file is mapped into memory and each record
+// tokenized in place, so even exports of the whole database load quickly.
+// Streams that can't be mapped, such as pipes, are read into memory first.
+
+flag FProcessADBFile(CONST char *szFile, FILE *file)
+{
+  CONST char *pchFile, *pch, *pchEnd, *pchRec;
 #ifdef EXPRESS
-  // Skip current chart record if AstroExpression says to do so.
-  if (!us.fExpOff && FSzSet(us.szExpADB)) {
-    if (!NParseExpression(us.szExpADB))
-      continue;
+  CONST char *pch2, *pchT;
+  int i;
+#endif
+  int grf, cchSz = CchSz(us.szADB), crec = 0;
+  long cb;
+  flag fHaveFile, fMapped, fDidOne = fFalse, fRet = fFalse;
+#ifdef TIME
+  char sz[cchSzDef];
+  clock_t clk = clock();
+  real rSec;
+#endif
+
+  fHaveFile = (file != NULL);
+  if (!fHaveFile) {
+    file = FileOpen(szFile, 0, NULL);
+    if (file == NULL)
+      return fFalse;
   }
+  is.fileIn = file;
+  pchFile = (CONST char *)PbMapFile(szFile, file, &cb);
+  fMapped = (pchFile != NULL);
+  if (!fMapped)
+    pchFile = (CONST char *)PbReadFile(file, &cb);
+  if (pchFile == NULL) {
+    PrintWarning("Couldn't find any charts in Astrodatabank file.");
+    goto LClose;
+  }
+  pch = pchFile;
+  pchEnd = pchFile + cb;
+
+  loop {
+#ifdef EXPRESS
+    if (!us.fExpOff && FSzSet(us.szExpADB)) {
+      for (i = us.iExpADB; i < us.iExpADB + us.cExpADB; i++)
+        if (!ExpSetN(i, 0))
+          goto LDone;
+    }
 #endif
-  if (!FAppendCIList(&ciCore))
-    goto LDone;
-  fDidOne = fTrue;
 
-  } while (!feof(file));
+    // Find and parse the next record.
+    grf = 0;
+    pchRec = PchFindRgch(pch, pchEnd, "<adb_entry", 10);
+    if (pchRec != NULL) {
+      pch = pchRec + 10;
+      grf = GrfParseADBRecord(&pch, pchEnd);
+      crec++;
+    }
+    if ((grf & 2047) != 2047) {
+      if (grf == 0 && fDidOne)
+        break;
+      if (grf == 0)
+        PrintWarning("Couldn't find any charts in Astrodatabank file.");
+      else
+        PrintWarning("Couldn't detect all fields in Astrodatabank file.");
+      goto LDone;
+    }
+    ZZ += SS;
+    if (!FValidMon(MM) || !FValidDay(DD, MM, YY) || !FValidYea(YY) ||
+      !FValidTim(TT) || !FValidZon(ZZ) || !FValidLon(OO) || !FValidLat(AA)) {
+      PrintWarning("Values in Astrodatabank file are out of range.");
+      goto LDone;
+    }
+
+    // Search the raw text of the record only when filtering needs it.
+    if (cchSz > 0 && PchFindRgch(pchRec, pch, us.szADB, cchSz) == NULL)
+      continue;
+#ifdef EXPRESS
+    // Skip current chart record if AstroExpression says to do so.
+    if (!us.fExpOff && FSzSet(us.szExpADB)) {
+      for (i = us.iExpADB; i < us.iExpADB + us.cExpADB; i++) {
+        pch2 = ExpGetString(i);
+        if (!FSzSet(pch2))
+          continue;
+        for (pchT = pchRec; (pchT = PchFindRgch(pchT, pch, pch2,
+          CchSz(pch2))) != NULL; pchT++)
+          if (!ExpSetN(i, NExpGet(i) + 1))
+            goto LDone;
+      }
+      if (!NParseExpression(us.szExpADB))
+        continue;
+    }
+#endif
+    if (!FAppendCIList(&ciCore))
+      goto LDone;
+    fDidOne = fTrue;
+  }
   fRet = fTrue;
 
 LDone:
+  if (fMapped)
+    UnmapFile((pbyte)pchFile, cb);
+  else
+    DeallocateP((pbyte)pchFile);
+#ifdef TIME
+  // Report the load rate when importing a large export.
+  if (crec >= 10000) {
+    rSec = (real)(clock() - clk) / (real)CLOCKS_PER_SEC;
+    sprintf(sz, "Read %d Astrodatabank records in %.2f seconds "
+      "(%.0f per second).", crec, rSec, (real)crec / Max(rSec, 0.001));
+    PrintNotice(sz);
+  }
+#endif
+
+LClose:
   is.fileIn = NULL;
   if (!fHaveFile)
     fclose(file);
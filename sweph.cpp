@@ -189,6 +189,9 @@ static int do_fread(void *targ, int size, int count, int corrsize,
 		    FILE *fp, int32 fpos, int freord, int fendian, int ifno, 
 		    char *serr);
 static int get_new_segment(double tjd, int ipli, int ifno, char *serr);
+static void map_ephe_file(struct file_data *fdp);
+static void reorder_bytes(unsigned char *targ, unsigned char *src, int size,
+		    int count, int corrsize, int freord, int fendian);
 static int main_planet(double tjd, int ipli, int iplmoon, int32 epheflag, int32 iflag,
 		       char *serr);
 static int main_planet_bary(double tjd, int ipli, int32 epheflag, int32 iflag, 
@@ -226,6 +229,10 @@ static int app_pos_rest(struct plan_data *pdp, int32 iflag,
     double *xx, double *x2000, struct epsilon *oe, char *serr);
 static int open_jpl_file(double *ss, char *fname, char *fpath, char *serr);
 static void free_planets(void);
+static int32 fixstar_frame_begin(struct fixstar_frame *fr, double tjd, int32 iflag, char *serr);
+static int32 fixstar_calc_in_frame(struct fixstar_frame *fr, struct fixed_star *stardata, double *xx, char *serr);
+static AS_BOOL is_shared_star_catalog(struct fixed_star *fixed_stars);
+static void free_star_catalogs(void);
 
 #ifdef TRACE
 static void trace_swe_calc(int param, double tjd, int ipl, int32 iflag, double *xx, char *serr);
@@ -1277,7 +1284,8 @@ void CALL_CONV swe_close(void)
     swed.deps = NULL;
   }
   if (swed.n_fixstars_records > 0) {
-    free(swed.fixed_stars);
+    if (!is_shared_star_catalog(swed.fixed_stars))
+      free(swed.fixed_stars);
     swed.fixed_stars = NULL;
     swed.n_fixstars_real = 0;
     swed.n_fixstars_named = 0;
@@ -2230,6 +2238,7 @@ again:
     retc = read_const(ifno, serr);
     if (retc != OK)
       return(retc);
+    map_ephe_file(fdp);
   }
   /* if first ephemeris file (J-3000), it might start a mars period
    * after -3000. if last ephemeris file (J3000), it might end a
@@ -4360,6 +4369,364 @@ static int app_pos_etc_mean(int ipl, int32 iflag, char *serr)
   return app_pos_rest(pdp, iflag, xx, xxsv, oe, serr);
 }
 
+/* Ephemeris files are mapped into memory once and shared by all threads,
+ * so segments can be read without seeking and reading through the file
+ * handle each thread has open. Unpacked segments are also shared, in a
+ * small cache indexed by position within the mapped file. */
+static struct mapped_file {
+  char fnam[AS_MAXCH];
+  unsigned char *pb;
+  int32 cb;
+} mapdat[SEI_NMAPFILES];
+static int nmapdat = 0;
+
+static struct seg_cache {
+  unsigned char *pb;	/* mapped file the segment is from */
+  int32 fpos;		/* position of segment within file */
+  int ncoe;		/* number of coefficients per coordinate */
+  double segp[(MAXORD+1) * 3];
+} *segcache = NULL;
+
+#ifdef THREADS
+static pthread_mutex_t mutexMapFile = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t mutexSegCache = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* Segments of a time range can be preloaded ahead of a long computation
+ * with swi_preload_range(). They're kept unpacked for each body and file,
+ * indexed by segment number, and shared by all threads until exit. */
+static struct seg_preload {
+  unsigned char *pb;	/* mapped file the segments are from */
+  int ipli;		/* internal planet number */
+  int ncoe;		/* number of coefficients per coordinate */
+  int32 iseg0, nseg;	/* first segment number and number of segments */
+  char *fhave;		/* whether each segment has been stored */
+  double *segp;		/* coefficients of each segment */
+} preload[SEI_NPRELOAD];
+static int npreload = 0;
+static int32 preload_nseg = 0, preload_size = 0;
+static TLS AS_BOOL is_preloading = FALSE;
+static TLS double preload_tjd[2];
+
+#ifdef THREADS
+static pthread_mutex_t mutexPreload = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* attach the shared memory image of an ephemeris file just opened,
+ * mapping it if this is the first time the file is opened.
+ * if it can't be mapped, segments are read through the file handle. */
+static void map_ephe_file(struct file_data *fdp)
+{
+  int i;
+  long cb = 0;
+  unsigned char *pb = NULL;
+  fdp->pbmap = NULL;
+  fdp->cbmap = 0;
+#ifdef THREADS
+  pthread_mutex_lock(&mutexMapFile);
+#endif
+  for (i = 0; i < nmapdat; i++) {
+    if (strcmp(mapdat[i].fnam, fdp->fnam) == 0) {
+      fdp->pbmap = mapdat[i].pb;
+      fdp->cbmap = mapdat[i].cb;
+      break;
+    }
+  }
+  if (i >= nmapdat && nmapdat < SEI_NMAPFILES) {
+    pb = (unsigned char *) PbMapFile(fdp->fnam, fdp->fptr, &cb);
+    if (pb != NULL) {
+      strcpy(mapdat[nmapdat].fnam, fdp->fnam);
+      mapdat[nmapdat].pb = pb;
+      mapdat[nmapdat].cb = (int32) cb;
+      nmapdat++;
+      fdp->pbmap = pb;
+      fdp->cbmap = (int32) cb;
+    }
+  }
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexMapFile);
+#endif
+}
+
+/* release all mapped ephemeris files, the segment cache, and everything
+ * else shared between threads.
+ * only to be called when no thread is computing positions anymore. */
+void swi_unmap_files(void)
+{
+  int i;
+  for (i = 0; i < nmapdat; i++)
+    UnmapFile((pbyte) mapdat[i].pb, (long) mapdat[i].cb);
+  nmapdat = 0;
+  for (i = 0; i < npreload; i++) {
+    free((void *) preload[i].fhave);
+    free((void *) preload[i].segp);
+  }
+  npreload = 0;
+  preload_nseg = preload_size = 0;
+  free_star_catalogs();
+  if (segcache != NULL) {
+    free((void *) segcache);
+    segcache = NULL;
+  }
+}
+
+/* like do_fread(), but read from the mapped image of an ephemeris file.
+ * *pmpos is the current position within the image. */
+static int do_mread(void *trg, int size, int count, int corrsize, struct file_data *fdp, int32 fpos, int32 *pmpos, int freord, int fendian, char *serr)
+{
+  int totsize = size * count;
+  if (fpos >= 0)
+    *pmpos = fpos;
+  if (*pmpos < 0 || *pmpos + totsize > fdp->cbmap) {
+    if (serr != NULL) {
+      strcpy(serr, "Ephemeris file is damaged (1). ");
+      if (strlen(serr) + strlen(fdp->fnam) < AS_MAXCH - 1) {
+	sprintf(serr, "Ephemeris file %s is damaged (2).", fdp->fnam);
+      }
+    }
+    return(ERR);
+  }
+  if (!freord && size == corrsize)
+    memcpy(trg, (void *) (fdp->pbmap + *pmpos), (size_t) totsize);
+  else
+    reorder_bytes((unsigned char *) trg, fdp->pbmap + *pmpos, size, count, corrsize, freord, fendian);
+  *pmpos += totsize;
+  return(OK);
+}
+
+/* read from the mapped image of the file if there is one, else the file */
+static int seg_read(void *trg, int size, int count, int corrsize, struct file_data *fdp, int32 fpos, int32 *pmpos, int freord, int fendian, int ifno, char *serr)
+{
+  if (fdp->pbmap != NULL)
+    return do_mread(trg, size, count, corrsize, fdp, fpos, pmpos, freord, fendian, serr);
+  return do_fread(trg, size, count, corrsize, fdp->fptr, fpos, freord, fendian, ifno, serr);
+}
+
+/* look up or store unpacked segment coefficients in the shared cache */
+static AS_BOOL seg_cache_get(struct file_data *fdp, int32 fpos, struct plan_data *pdp)
+{
+  struct seg_cache *psc;
+  AS_BOOL found = FALSE;
+  if (fdp->pbmap == NULL || pdp->ncoe > MAXORD+1)
+    return FALSE;
+#ifdef THREADS
+  pthread_mutex_lock(&mutexSegCache);
+#endif
+  if (segcache != NULL) {
+    psc = &segcache[(unsigned int) fpos % SEI_NSEGCACHE];
+    if (psc->pb == fdp->pbmap && psc->fpos == fpos &&
+      psc->ncoe == pdp->ncoe) {
+      memcpy((void *) pdp->segp, (void *) psc->segp,
+        (size_t) pdp->ncoe * 3 * 8);
+      found = TRUE;
+    }
+  }
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexSegCache);
+#endif
+  return found;
+}
+
+static void seg_cache_put(struct file_data *fdp, int32 fpos, struct plan_data *pdp)
+{
+  struct seg_cache *psc;
+  if (fdp->pbmap == NULL || pdp->ncoe > MAXORD+1)
+    return;
+#ifdef THREADS
+  pthread_mutex_lock(&mutexSegCache);
+#endif
+  if (segcache == NULL)
+    segcache = (struct seg_cache *) calloc(SEI_NSEGCACHE, sizeof(struct seg_cache));
+  if (segcache != NULL) {
+    psc = &segcache[(unsigned int) fpos % SEI_NSEGCACHE];
+    psc->pb = fdp->pbmap;
+    psc->fpos = fpos;
+    psc->ncoe = pdp->ncoe;
+    memcpy((void *) psc->segp, (void *) pdp->segp, (size_t) pdp->ncoe * 3 * 8);
+  }
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexSegCache);
+#endif
+}
+
+/* copy a preloaded segment of a body, if there is one */
+static AS_BOOL seg_preload_get(struct file_data *fdp, int ipli, int32 iseg, struct plan_data *pdp)
+{
+  struct seg_preload *psp;
+  AS_BOOL found = FALSE;
+  int i;
+  if (fdp->pbmap == NULL)
+    return FALSE;
+#ifdef THREADS
+  pthread_mutex_lock(&mutexPreload);
+#endif
+  for (i = 0; i < npreload; i++) {
+    psp = &preload[i];
+    if (psp->pb != fdp->pbmap || psp->ipli != ipli)
+      continue;
+    if (iseg >= psp->iseg0 && iseg < psp->iseg0 + psp->nseg &&
+      psp->ncoe == pdp->ncoe && psp->fhave[iseg - psp->iseg0]) {
+      memcpy((void *) pdp->segp,
+        (void *) &psp->segp[(iseg - psp->iseg0) * psp->ncoe * 3],
+        (size_t) pdp->ncoe * 3 * 8);
+      found = TRUE;
+      break;
+    }
+  }
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexPreload);
+#endif
+  return found;
+}
+
+/* store a segment just unpacked while preloading, setting up room for
+ * every segment of the body within the range the first time */
+static void seg_preload_put(struct file_data *fdp, int ipli, int32 iseg, struct plan_data *pdp)
+{
+  struct seg_preload *psp = NULL;
+  double t0, t1;
+  int i;
+  if (!is_preloading || fdp->pbmap == NULL)
+    return;
+#ifdef THREADS
+  pthread_mutex_lock(&mutexPreload);
+#endif
+  for (i = 0; i < npreload; i++) {
+    if (preload[i].pb == fdp->pbmap && preload[i].ipli == ipli &&
+      iseg >= preload[i].iseg0 && iseg < preload[i].iseg0 + preload[i].nseg) {
+      psp = &preload[i];
+      break;
+    }
+  }
+  if (psp == NULL && npreload < SEI_NPRELOAD) {
+    psp = &preload[npreload];
+    t0 = preload_tjd[0] > pdp->tfstart ? preload_tjd[0] : pdp->tfstart;
+    t1 = preload_tjd[1] < pdp->tfend ? preload_tjd[1] : pdp->tfend;
+    psp->iseg0 = (int32) ((t0 - pdp->tfstart) / pdp->dseg);
+    psp->nseg = (int32) ((t1 - pdp->tfstart) / pdp->dseg) - psp->iseg0 + 1;
+    if (iseg < psp->iseg0)
+      psp->iseg0 = iseg;
+    if (iseg >= psp->iseg0 + psp->nseg)
+      psp->nseg = iseg - psp->iseg0 + 1;
+    psp->fhave = (char *) calloc((size_t) psp->nseg, 1);
+    psp->segp = (double *) malloc((size_t) psp->nseg * pdp->ncoe * 3 * 8);
+    if (psp->fhave == NULL || psp->segp == NULL) {
+      if (psp->fhave != NULL)
+	free((void *) psp->fhave);
+      if (psp->segp != NULL)
+	free((void *) psp->segp);
+      psp = NULL;
+    } else {
+      psp->pb = fdp->pbmap;
+      psp->ipli = ipli;
+      psp->ncoe = pdp->ncoe;
+      preload_size += psp->nseg * (pdp->ncoe * 3 * 8 + 1);
+      npreload++;
+    }
+  }
+  if (psp != NULL && psp->ncoe == pdp->ncoe && !psp->fhave[iseg - psp->iseg0]) {
+    memcpy((void *) &psp->segp[(iseg - psp->iseg0) * psp->ncoe * 3],
+      (void *) pdp->segp, (size_t) pdp->ncoe * 3 * 8);
+    psp->fhave[iseg - psp->iseg0] = 1;
+    preload_nseg++;
+  }
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexPreload);
+#endif
+}
+
+/* decode into memory every segment the bodies in bodymask (bits of
+ * SE_ planet numbers) need for ephemeris time tjd_start to tjd_end,
+ * so later computations within the range never have to unpack segments.
+ * only bodies of the planet, moon, and main asteroid files are preloaded.
+ * may be called on its own thread while others compute positions. */
+int swi_preload_range(double tjd_start, double tjd_end, int32 bodymask, char *serr)
+{
+  static const int rgifno[3] = {SEI_FILE_PLANET, SEI_FILE_MOON, SEI_FILE_MAIN_AST};
+  struct file_data *fdp;
+  struct plan_data *pdp;
+  double t, tt, tend, xx[6];
+  int i, j, ipli, ifno, retc = OK, retc1;
+  char serr1[AS_MAXCH];
+  int32 mask = 0;
+  swi_init_swed_if_start();
+  if (serr != NULL)
+    *serr = '\0';
+  if (tjd_end < tjd_start)
+    return OK;
+  /* any planet needs the whole planet and moon files, since the earth
+   * comes from the barycenter of earth and moon */
+  if (bodymask & ((1 << (SE_PLUTO + 1)) - 1))
+    mask = (1 << (SEI_SUNBARY + 1)) - 1;
+  for (i = SE_CHIRON; i <= SE_VESTA; i++)
+    if (bodymask & (1 << i))
+      mask |= 1 << (i - SE_CHIRON + SEI_CHIRON);
+  bodymask = mask;
+  is_preloading = TRUE;
+  preload_tjd[0] = tjd_start;
+  preload_tjd[1] = tjd_end;
+  for (i = 0; i < 3; i++) {
+    ifno = rgifno[i];
+    fdp = &swed.fidat[ifno];
+    /* body to open the file with */
+    if (ifno == SEI_FILE_PLANET)
+      ipli = SEI_EMB;
+    else if (ifno == SEI_FILE_MOON)
+      ipli = SEI_MOON;
+    else
+      for (ipli = SEI_CHIRON; ipli <= SEI_VESTA && !(bodymask & (1 << ipli)); ipli++)
+	;
+    if (ipli > SEI_VESTA || (ifno == SEI_FILE_MOON && !(bodymask & (1 << ipli))))
+      continue;
+    /* files cover some centuries each, so go through them in turn.
+     * if there's no file for a time, try again a year later. */
+    for (t = tjd_start; t <= tjd_end; ) {
+      retc1 = sweph(t, ipli, ifno, 0, NULL, NO_SAVE, xx, serr1);
+      if (retc1 != OK) {
+	if (retc == OK && serr != NULL)
+	  strcpy(serr, serr1);
+	retc = retc1;
+	t += 365.25;
+	continue;
+      }
+      tend = tjd_end < fdp->tfend ? tjd_end : fdp->tfend;
+      for (j = 0; j < fdp->npl; j++) {
+	if (fdp->ipl[j] >= SEI_NPLANETS || !(bodymask & (1 << fdp->ipl[j])))
+	  continue;
+	pdp = &swed.pldat[fdp->ipl[j]];
+	for (tt = t; ; ) {
+	  if (sweph(tt, fdp->ipl[j], ifno, 0, NULL, NO_SAVE, xx, serr1) != OK)
+	    break;
+	  if (pdp->tseg1 >= tend || tt >= tend)
+	    break;
+	  tt = pdp->tseg1 + pdp->dseg / 2;
+	  if (tt > tend)
+	    tt = tend;
+	}
+      }
+      t = fdp->tfend + 1e-6;
+    }
+  }
+  is_preloading = FALSE;
+  return retc;
+}
+
+/* memory used by preloaded segments, and how many have been stored */
+int32 swi_preload_size(int32 *pnseg)
+{
+  int32 cb;
+#ifdef THREADS
+  pthread_mutex_lock(&mutexPreload);
+#endif
+  cb = preload_size;
+  if (pnseg != NULL)
+    *pnseg = preload_nseg;
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexPreload);
+#endif
+  return cb;
+}
+
 /* fetch chebyshew coefficients from sweph file for
  * tjd 		time
  * ipli		planet number
@@ -4377,7 +4744,7 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
   unsigned char c[4];
   struct plan_data *pdp = &swed.pldat[ipli];
   struct file_data *fdp = &swed.fidat[ifno];
-  FILE *fp = fdp->fptr;
+  int32 mpos = 0;
   int freord  = (int) fdp->iflg & SEI_FILE_REORD;
   int fendian = (int) fdp->iflg & SEI_FILE_LITENDIAN;
   uint32 longs[MAXORD+1];
@@ -4387,27 +4754,38 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
       return(NOT_AVAILABLE);*/
   pdp->tseg0 = pdp->tfstart + iseg * pdp->dseg;
   pdp->tseg1 = pdp->tseg0 + pdp->dseg;
+  /* segment may have been preloaded */
+  if (pdp->segp == NULL)
+    pdp->segp = (double *) malloc((size_t) pdp->ncoe * 3 * 8);
+  if (seg_preload_get(fdp, ipli, iseg, pdp))
+    return(OK);
   /* get file position of coefficients from file */
   fpos = pdp->lndx0 + iseg * 3;
-  retc = do_fread((void *) &fpos, 3, 1, 4, fp, fpos, freord, fendian, ifno, serr);
+  retc = seg_read((void *) &fpos, 3, 1, 4, fdp, fpos, &mpos, freord, fendian, ifno, serr);
   if (retc != OK)
     goto return_error_gns;
-  fseek(fp, fpos, SEEK_SET);
+  if (fdp->pbmap != NULL)
+    mpos = fpos;
+  else
+    fseek(fdp->fptr, fpos, SEEK_SET);
+  /* segment may already have been unpacked, by this or another thread */
+  if (seg_cache_get(fdp, fpos, pdp)) {
+    seg_preload_put(fdp, ipli, iseg, pdp);
+    return(OK);
+  }
   /* clear space of chebyshew coefficients */
-  if (pdp->segp == NULL)
-    pdp->segp = (double *) malloc((size_t) pdp->ncoe * 3 * 8);
   memset((void *) pdp->segp, 0, (size_t) pdp->ncoe * 3 * 8);
   /* read coefficients for 3 coordinates */
   for (icoord = 0; icoord < 3; icoord++) {
     idbl = icoord * pdp->ncoe;
     /* first read header */
     /* first bit indicates number of sizes of packed coefficients */
-    retc = do_fread((void *) &c[0], 1, 2, 1, fp, SEI_CURR_FPOS, freord, fendian, ifno, serr);
+    retc = seg_read((void *) &c[0], 1, 2, 1, fdp, SEI_CURR_FPOS, &mpos, freord, fendian, ifno, serr);
     if (retc != OK)
       goto return_error_gns;
     if (c[0] & 128) {
       nsizes = 6;
-      retc = do_fread((void *) (c+2), 1, 2, 1, fp, SEI_CURR_FPOS, freord, fendian, ifno, serr);
+      retc = seg_read((void *) (c+2), 1, 2, 1, fdp, SEI_CURR_FPOS, &mpos, freord, fendian, ifno, serr);
       if (retc != OK)
 	goto return_error_gns;
       nsize[0] = (int) c[1] / 16;
@@ -4445,7 +4823,7 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
       if (i < 4) {
 	j = (4 - i);
 	k = nsize[i];
-	retc = do_fread((void *) &longs[0], j, k, 4, fp, SEI_CURR_FPOS, freord, fendian, ifno, serr);
+	retc = seg_read((void *) &longs[0], j, k, 4, fdp, SEI_CURR_FPOS, &mpos, freord, fendian, ifno, serr);
 	if (retc != OK)
 	  goto return_error_gns;
 	for (m = 0; m < k; m++, idbl++) {
@@ -4457,7 +4835,7 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
       } else if (i == 4) {		/* half byte packing */
 	j = 1;
 	k = (nsize[i] + 1) / 2;
-	retc = do_fread((void *) longs, j, k, 4, fp, SEI_CURR_FPOS, freord, fendian, ifno, serr);
+	retc = seg_read((void *) longs, j, k, 4, fdp, SEI_CURR_FPOS, &mpos, freord, fendian, ifno, serr);
 	if (retc != OK)
 	  goto return_error_gns;
 	for (m = 0, j = 0; 
@@ -4476,7 +4854,7 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
       } else if (i == 5) {		/* quarter byte packing */
 	j = 1;
 	k = (nsize[i] + 3) / 4;
-	retc = do_fread((void *) longs, j, k, 4, fp, SEI_CURR_FPOS, freord, fendian, ifno, serr);
+	retc = seg_read((void *) longs, j, k, 4, fdp, SEI_CURR_FPOS, &mpos, freord, fendian, ifno, serr);
 	if (retc != OK)
 	  goto return_error_gns;
 	for (m = 0, j = 0; 
@@ -4495,6 +4873,8 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
       }
     }
   }
+  seg_cache_put(fdp, fpos, pdp);
+  seg_preload_put(fdp, ipli, iseg, pdp);
   return(OK);
 return_error_gns:
   fclose(fdp->fptr);
@@ -4905,7 +5285,6 @@ return_error:
  */
 static int do_fread(void *trg, int size, int count, int corrsize, FILE *fp, int32 fpos, int freord, int fendian, int ifno, char *serr)
 {
-  int i, j, k; 
   int totsize;
   unsigned char space[1000];
   unsigned char *targ = (unsigned char *) trg;
@@ -4934,26 +5313,34 @@ static int do_fread(void *trg, int size, int count, int corrsize, FILE *fp, int3
       }
       return(ERR);
     }
-    if (size != corrsize) {
-      memset((void *) targ, 0, (size_t) count * corrsize);
-    }
-    for(i = 0; i < count; i++) {
-      for (j = size-1; j >= 0; j--) {
-	if (freord) {
-	  k = size-j-1;
-	} else {
-	  k = j;
-	}
-        if (size != corrsize) {
-          if ((fendian == SEI_FILE_BIGENDIAN && !freord) ||
-              (fendian == SEI_FILE_LITENDIAN &&  freord))
-	    k += corrsize - size;
-	}
-        targ[i*corrsize+k] = space[i*size+j];
+    reorder_bytes(targ, space, size, count, corrsize, freord, fendian);
+  }
+  return(OK);
+}
+
+/* copy items read from an ephemeris file to their target, reordering
+ * bytes and widening items as done by do_fread() */
+static void reorder_bytes(unsigned char *targ, unsigned char *src, int size, int count, int corrsize, int freord, int fendian)
+{
+  int i, j, k; 
+  if (size != corrsize) {
+    memset((void *) targ, 0, (size_t) count * corrsize);
+  }
+  for(i = 0; i < count; i++) {
+    for (j = size-1; j >= 0; j--) {
+      if (freord) {
+	k = size-j-1;
+      } else {
+	k = j;
       }
+      if (size != corrsize) {
+	if ((fendian == SEI_FILE_BIGENDIAN && !freord) ||
+	    (fendian == SEI_FILE_LITENDIAN &&  freord))
+	  k += corrsize - size;
+      }
+      targ[i*corrsize+k] = src[i*size+j];
     }
   }
-  return(OK);
 }
 
 /* SWISSEPH
@@ -6306,6 +6693,52 @@ int32 fixstar_cut_string(char *srecord, char *star, struct fixed_star *stardata,
   return OK;
 }
 
+/* Fixed star files are parsed once and the catalog shared read-only by
+ * all threads using the same file. Built-in stars which handles have been
+ * asked for are kept after the catalog, so they have handles too. */
+static struct star_catalog {
+  char fnam[AS_MAXCH];
+  AS_BOOL is_old_starfile;
+  struct fixed_star *fixed_stars;
+  int n_fixstars_real, n_fixstars_named, n_fixstars_records;
+} starcat[SEI_NSTARCAT];
+static int nstarcat = 0;
+static struct fixed_star starbuiltin[SEI_NSTARBUILTIN];
+static int nstarbuiltin = 0;
+
+#ifdef THREADS
+static pthread_mutex_t mutexStarCat = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static int32 parse_all_fixed_stars(char *serr);
+
+static AS_BOOL is_shared_star_catalog(struct fixed_star *fixed_stars)
+{
+  int i;
+  AS_BOOL found = FALSE;
+#ifdef THREADS
+  pthread_mutex_lock(&mutexStarCat);
+#endif
+  for (i = 0; i < nstarcat; i++)
+    if (starcat[i].fixed_stars == fixed_stars)
+      found = TRUE;
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexStarCat);
+#endif
+  return found;
+}
+
+/* release the shared fixed star catalogs.
+ * only to be called when no thread is computing positions anymore. */
+static void free_star_catalogs(void)
+{
+  int i;
+  for (i = 0; i < nstarcat; i++)
+    free((void *) starcat[i].fixed_stars);
+  nstarcat = 0;
+  nstarbuiltin = 0;
+}
+
 /* function loads all fixed stars from file sefstars.txt,
  * into swed.fixed_stars, which is a pointer to an array
  * of struct fixed_stars.
@@ -6325,12 +6758,8 @@ int32 fixstar_cut_string(char *srecord, char *star, struct fixed_star *stardata,
 static int32 load_all_fixed_stars(char *serr) 
 {
   int32 retc = OK;
-  int nstars = 0, line = 0, fline = 0, nrecs = 0, nnamed = 0;
-  char s[AS_MAXCH], *sp;
-  char srecord[AS_MAXCH];
-  struct fixed_star fstdata;
-  char last_starbayer[SWI_STAR_LENGTH + 1];
-  *last_starbayer = '\0';
+  int i;
+  char *fnam = swed.fidat[SEI_FILE_FIXSTAR].fnam;
   if (swed.n_fixstars_records > 0) {
     return -2;
   }
@@ -6344,6 +6773,50 @@ static int32 load_all_fixed_stars(char *serr)
       }
     }
   }
+  /* the file may already have been parsed, by this or another thread */
+#ifdef THREADS
+  pthread_mutex_lock(&mutexStarCat);
+#endif
+  for (i = 0; i < nstarcat; i++) {
+    if (strcmp(starcat[i].fnam, fnam) == 0)
+      break;
+  }
+  if (i >= nstarcat) {
+    retc = parse_all_fixed_stars(serr);
+    if (retc != ERR && nstarcat < SEI_NSTARCAT) {
+      strcpy(starcat[nstarcat].fnam, fnam);
+      starcat[nstarcat].is_old_starfile = swed.is_old_starfile;
+      starcat[nstarcat].fixed_stars = swed.fixed_stars;
+      starcat[nstarcat].n_fixstars_real = swed.n_fixstars_real;
+      starcat[nstarcat].n_fixstars_named = swed.n_fixstars_named;
+      starcat[nstarcat].n_fixstars_records = swed.n_fixstars_records;
+      nstarcat++;
+    }
+  } else {
+    swed.is_old_starfile = starcat[i].is_old_starfile;
+    swed.fixed_stars = starcat[i].fixed_stars;
+    swed.n_fixstars_real = starcat[i].n_fixstars_real;
+    swed.n_fixstars_named = starcat[i].n_fixstars_named;
+    swed.n_fixstars_records = starcat[i].n_fixstars_records;
+  }
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexStarCat);
+#endif
+  return retc;
+}
+
+/* function parses the open fixed stars file into the array of
+ * struct fixed_stars, as described above
+ */
+static int32 parse_all_fixed_stars(char *serr) 
+{
+  int32 retc = OK;
+  int nstars = 0, line = 0, fline = 0, nrecs = 0, nnamed = 0;
+  char s[AS_MAXCH], *sp;
+  char srecord[AS_MAXCH];
+  struct fixed_star fstdata;
+  char last_starbayer[SWI_STAR_LENGTH + 1];
+  *last_starbayer = '\0';
   rewind(swed.fixfp);
   swed.fixed_stars = NULL;
   while (fgets(s, AS_MAXCH, swed.fixfp) != NULL) {
@@ -6408,17 +6881,28 @@ static int32 load_all_fixed_stars(char *serr)
  * char *serr        error return string
  */
 static int32 fixstar_calc_from_struct(struct fixed_star *stardata, double tjd, int32 iflag, char *star, double *xx, char *serr)
+{
+  struct fixstar_frame fr;
+  if (fixstar_frame_begin(&fr, tjd, iflag, serr) != OK)
+    return ERR;
+  sprintf(star, "%s,%s", stardata->starname, stardata->starbayer);
+  return fixstar_calc_in_frame(&fr, stardata, xx, serr);
+}
+
+/* function sets up everything a fixed star position at tjd needs which
+ * doesn't depend on the star: flags, obliquity and nutation, and the
+ * positions of earth, sun, and observer. stars computed for the same
+ * time and flags can share one frame.
+ */
+static int32 fixstar_frame_begin(struct fixstar_frame *fr, double tjd, int32 iflag, char *serr)
 {
   int i;
   int32 retc = OK;
-  double epoch, radv, parall;
-  double ra_pm, de_pm, ra, de, t;
-  double daya[2], rdist;
-  double x[6], xxsv[6], xobs[6], xobs_dt[6], *xpo = NULL, *xpo_dt = NULL;
-  static TLS double xearth[6], xearth_dt[6], xsun[6], xsun_dt[6];
+  double *xearth = fr->xearth, *xearth_dt = fr->xearth_dt;
+  double *xsun = fr->xsun, *xsun_dt = fr->xsun_dt;
+  double *xobs = fr->xobs, *xobs_dt = fr->xobs_dt;
   double dt = PLAN_SPEED_INTV * 0.1;
   int32 epheflag, iflgsave;
-  struct epsilon *oe = &swed.oec2000;
   iflgsave = iflag;
   iflag |= SEFLG_SPEED; /* we need this in order to work correctly */
   if (serr != NULL)
@@ -6454,7 +6938,73 @@ static int32 fixstar_calc_from_struct(struct fixed_star *stardata, double tjd, i
    * nutation                               * 
    ******************************************/
   swi_check_nutation(tjd, iflag);
-  sprintf(star, "%s,%s", stardata->starname, stardata->starbayer);
+  fr->tjd = tjd;
+  fr->dt = dt;
+  fr->iflag = iflag;
+  fr->iflgsave = iflgsave;
+  /**************************************************** 
+   * earth/sun 
+   * for parallax, light deflection, and aberration,
+   ****************************************************/
+  if (!(iflag & SEFLG_BARYCTR) && (!(iflag & SEFLG_HELCTR) || !(iflag & SEFLG_MOSEPH))) {
+    if ((retc =  main_planet_bary(tjd - dt, SEI_EARTH, epheflag, iflag, NO_SAVE, xearth_dt, xearth_dt, xsun_dt, NULL, serr)) != OK) {
+      return ERR;
+    }
+    if ((retc =  main_planet_bary(tjd, SEI_EARTH, epheflag, iflag, DO_SAVE, xearth, xearth, xsun, NULL, serr)) != OK) {
+      return ERR;
+    }
+  }
+  /************************************
+   * observer: geocenter or topocenter
+   ************************************/
+  /* if topocentric position is wanted  */
+  if (iflag & SEFLG_TOPOCTR) { 
+    if (swi_get_observer(tjd - dt, iflag | SEFLG_NONUT, NO_SAVE, xobs_dt, serr) != OK)
+      return ERR;
+    if (swi_get_observer(tjd, iflag | SEFLG_NONUT, NO_SAVE, xobs, serr) != OK)
+      return ERR;
+    /* barycentric position of observer */
+    for (i = 0; i <= 5; i++) {
+      xobs[i] = xobs[i] + xearth[i];	
+      xobs_dt[i] = xobs_dt[i] + xearth_dt[i];	
+    }
+  } else if (!(iflag & SEFLG_BARYCTR) && (!(iflag & SEFLG_HELCTR) || !(iflag & SEFLG_MOSEPH))) {
+    /* barycentric position of geocenter */
+    for (i = 0; i <= 5; i++) {
+      xobs[i] = xearth[i];
+      xobs_dt[i] = xearth_dt[i];
+    }
+  }
+  /* for parallax */ 
+  if ((iflag & SEFLG_HELCTR) && (iflag & SEFLG_MOSEPH)) {
+    fr->xpo = NULL;		/* no parallax, if moshier and heliocentric */
+    fr->xpo_dt = NULL;	/* no parallax, if moshier and heliocentric */
+  } else if (iflag & SEFLG_HELCTR) {
+    fr->xpo = xsun;//psdp->x;
+    fr->xpo_dt = xsun_dt; 
+  } else if (iflag & SEFLG_BARYCTR) {
+    fr->xpo = NULL;		/* no parallax, if barycentric */
+    fr->xpo_dt = NULL;	/* no parallax, if moshier and heliocentric */
+  } else {
+    fr->xpo = xobs;
+    fr->xpo_dt = xobs_dt;
+  }
+  return OK;
+}
+
+/* function calculates a fixstar from a star data struct, within a frame
+ * set up by fixstar_frame_begin() for its time and flags
+ */
+static int32 fixstar_calc_in_frame(struct fixstar_frame *fr, struct fixed_star *stardata, double *xx, char *serr)
+{
+  int i;
+  double epoch, radv, parall;
+  double ra_pm, de_pm, ra, de, t;
+  double daya[2], rdist;
+  double x[6], xxsv[6];
+  double tjd = fr->tjd, dt = fr->dt, *xpo = fr->xpo, *xpo_dt = fr->xpo_dt;
+  int32 iflag = fr->iflag, iflgsave = fr->iflgsave;
+  struct epsilon *oe = &swed.oec2000;
   epoch = stardata->epoch;
   ra_pm = stardata->ramot; de_pm = stardata->demot;
   radv = stardata->radvel; parall = stardata->parall; 
@@ -6497,56 +7047,9 @@ static int32 fixstar_calc_from_struct(struct fixed_star *stardata, double tjd, i
       swi_bias(x, J2000, SEFLG_SPEED, FALSE);
     }
   }
-  /**************************************************** 
-   * earth/sun 
-   * for parallax, light deflection, and aberration,
-   ****************************************************/
-  if (!(iflag & SEFLG_BARYCTR) && (!(iflag & SEFLG_HELCTR) || !(iflag & SEFLG_MOSEPH))) {
-    if ((retc =  main_planet_bary(tjd - dt, SEI_EARTH, epheflag, iflag, NO_SAVE, xearth_dt, xearth_dt, xsun_dt, NULL, serr)) != OK) {
-      return ERR;
-    }
-    if ((retc =  main_planet_bary(tjd, SEI_EARTH, epheflag, iflag, DO_SAVE, xearth, xearth, xsun, NULL, serr)) != OK) {
-      return ERR;
-    }
-  }
-  /************************************
-   * observer: geocenter or topocenter
-   ************************************/
-  /* if topocentric position is wanted  */
-  if (iflag & SEFLG_TOPOCTR) { 
-    if (swi_get_observer(tjd - dt, iflag | SEFLG_NONUT, NO_SAVE, xobs_dt, serr) != OK)
-      return ERR;
-    if (swi_get_observer(tjd, iflag | SEFLG_NONUT, NO_SAVE, xobs, serr) != OK)
-      return ERR;
-    /* barycentric position of observer */
-    for (i = 0; i <= 5; i++) {
-      xobs[i] = xobs[i] + xearth[i];	
-      xobs_dt[i] = xobs_dt[i] + xearth_dt[i];	
-    }
-  } else if (!(iflag & SEFLG_BARYCTR) && (!(iflag & SEFLG_HELCTR) || !(iflag & SEFLG_MOSEPH))) {
-    /* barycentric position of geocenter */
-    for (i = 0; i <= 5; i++) {
-      xobs[i] = xearth[i];
-      xobs_dt[i] = xearth_dt[i];
-    }
-  }
   /************************************
    * position and speed at tjd        *
    ************************************/
-  /* for parallax */ 
-  if ((iflag & SEFLG_HELCTR) && (iflag & SEFLG_MOSEPH)) {
-    xpo = NULL;		/* no parallax, if moshier and heliocentric */
-    xpo_dt = NULL;	/* no parallax, if moshier and heliocentric */
-  } else if (iflag & SEFLG_HELCTR) {
-    xpo = xsun;//psdp->x;
-    xpo_dt = xsun_dt; 
-  } else if (iflag & SEFLG_BARYCTR) {
-    xpo = NULL;		/* no parallax, if barycentric */
-    xpo_dt = NULL;	/* no parallax, if moshier and heliocentric */
-  } else {
-    xpo = xobs;
-    xpo_dt = xobs_dt;
-  }
   if (xpo == NULL) {
     for (i = 0; i <= 2; i++) {
       x[i] += t * x[i+3];	
@@ -6674,7 +7177,7 @@ if ((0)) {
 /* function searches a star in fixed stars list, i.e. the data loaded from file 
  * sefstars.txt
  */
-static int32 search_star_in_list(char *sstar, struct fixed_star *stardata, char *serr)
+static int32 search_star_in_list(char *sstar, struct fixed_star *stardata, int32 *pistar, char *serr)
 {
   int i, star_nr = 0, ndata = 0, len;
   char *sp;
@@ -6699,6 +7202,8 @@ static int32 search_star_in_list(char *sstar, struct fixed_star *stardata, char
       return ERR;
     }
     *stardata = swed.fixed_stars[star_nr - 1]; // keys start from 1
+    if (pistar != NULL)
+      *pistar = star_nr - 1;
     //printf("seq.number: %s, %s, %s, %f\n", stardata.skey, stardata.starname, stardata.starbayer, stardata.mag);
     return OK;
   /* traditional name with wildcard '%' at end of string */
@@ -6716,6 +7221,8 @@ static int32 search_star_in_list(char *sstar, struct fixed_star *stardata, char
     for (i = 0; i < ndata; i++) {
       if (strncmp(stardatabegp[i].skey, sstar, len) == 0) {
         *stardata = stardatabegp[i];
+	if (pistar != NULL)
+	  *pistar = (int32) (&stardatabegp[i] - swed.fixed_stars);
 	return OK;
       }
     }
@@ -6745,6 +7252,8 @@ static int32 search_star_in_list(char *sstar, struct fixed_star *stardata, char
       return ERR;
     }
     *stardata = *stardatap;
+    if (pistar != NULL)
+      *pistar = (int32) (stardatap - swed.fixed_stars);
     //printf("name search: %s, %s, %s, %f\n", stardata.skey, stardata.starname, stardata.starbayer, stardata.mag);
     return OK;
   }
@@ -6855,7 +7364,7 @@ int32 CALL_CONV swe_fixstar2(char *star, double tjd, int32 iflag,
     goto found;
   /* sequential fixed star number: get it from array directly */
   } 
-  retc = search_star_in_list(sstar, &stardata, serr);
+  retc = search_star_in_list(sstar, &stardata, NULL, serr);
   if (retc == ERR)
     goto return_err;
   /******************************************************/
@@ -6931,7 +7440,7 @@ int32 CALL_CONV swe_fixstar2_mag(char *star, double *mag, char *serr)
     stardata = last_stardata;
     goto found;
   }
-  retc = search_star_in_list(sstar, &stardata, serr);
+  retc = search_star_in_list(sstar, &stardata, NULL, serr);
   if (retc == ERR)
     goto return_err;
   /******************************************************/
@@ -6946,6 +7455,131 @@ int32 CALL_CONV swe_fixstar2_mag(char *star, double *mag, char *serr)
   return retc;
 }
 
+/**********************************************************
+ * get a handle for a fixed star, to compute it with
+ * swi_fixstar_batch() without looking up its name each time.
+ * star 	name of star, as for swe_fixstar2()
+ * returns the handle, or ERR if the star isn't found.
+ * handles stay valid as long as the same fixed star file is used,
+ * and refer to the same star in every thread using that file.
+**********************************************************/
+int32 swi_fixstar_handle(char *star, char *serr)
+{
+  char sstar[SWI_STAR_LENGTH + 1];
+  char srecord[AS_MAXCH + 20];
+  struct fixed_star stardata;
+  int32 istar = ERR;
+  int i;
+  if (serr != NULL)
+    *serr = '\0';
+  load_all_fixed_stars(serr);
+  if (fixstar_format_search_name(star, sstar, serr) == ERR)
+    return ERR;
+  if (!get_builtin_star(star, sstar, srecord)) {
+    if (search_star_in_list(sstar, &stardata, &istar, serr) == ERR)
+      return ERR;
+    return istar;
+  }
+  if (fixstar_cut_string(srecord, NULL, &stardata, serr) == ERR)
+    return ERR;
+  strcpy(stardata.skey, sstar);
+#ifdef THREADS
+  pthread_mutex_lock(&mutexStarCat);
+#endif
+  for (i = 0; i < nstarbuiltin; i++)
+    if (strcmp(starbuiltin[i].skey, sstar) == 0)
+      break;
+  if (i >= nstarbuiltin && nstarbuiltin < SEI_NSTARBUILTIN)
+    starbuiltin[nstarbuiltin++] = stardata;
+  if (i < nstarbuiltin)
+    istar = SEI_STARHANDLE_BUILTIN + i;
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexStarCat);
+#endif
+  return istar;
+}
+
+/* star data of a handle, or NULL if not a valid handle */
+static struct fixed_star *fixstar_from_handle(int32 istar)
+{
+  struct fixed_star *stardata = NULL;
+  if (istar < 0)
+    return NULL;
+  if (istar < swed.n_fixstars_records)
+    return &swed.fixed_stars[istar];
+  if (istar < SEI_STARHANDLE_BUILTIN)
+    return NULL;
+  istar -= SEI_STARHANDLE_BUILTIN;
+#ifdef THREADS
+  pthread_mutex_lock(&mutexStarCat);
+#endif
+  if (istar < nstarbuiltin)
+    stardata = &starbuiltin[istar];
+#ifdef THREADS
+  pthread_mutex_unlock(&mutexStarCat);
+#endif
+  return stardata;
+}
+
+/**********************************************************
+ * compute a number of fixed stars given by handles, all for the
+ * same time and flags. positions of the earth etc. are computed
+ * once for all of them, instead of once per star.
+ * rgistar	handles of stars from swi_fixstar_handle()
+ * nstar	number of stars
+ * tjd, iflag	as for swe_fixstar2()
+ * xx		6 doubles for each star, for position coordinates
+ * returns iflag as swe_fixstar2() does, or ERR if any star failed,
+ * in which case the coordinates of that star are 0.
+**********************************************************/
+int32 swi_fixstar_batch(int32 *rgistar, int nstar, double tjd, int32 iflag, double *xx, char *serr)
+{
+  struct fixstar_frame fr;
+  struct fixed_star *stardata;
+  int32 retc = OK, retflag = iflag;
+  int i, j;
+  load_all_fixed_stars(serr);
+  if (fixstar_frame_begin(&fr, tjd, iflag, serr) != OK) {
+    for (i = 0; i < nstar * 6; i++)
+      xx[i] = 0;
+    return ERR;
+  }
+  for (i = 0; i < nstar; i++) {
+    stardata = fixstar_from_handle(rgistar[i]);
+    if (stardata != NULL)
+      retflag = fixstar_calc_in_frame(&fr, stardata, xx + i*6, serr);
+    if (stardata == NULL || retflag == ERR) {
+      if (stardata == NULL && serr != NULL)
+	sprintf(serr, "error, swi_fixstar_batch(): invalid star handle %d", rgistar[i]);
+      for (j = 0; j <= 5; j++)
+	xx[i*6 + j] = 0;
+      retc = ERR;
+    }
+  }
+  if (retc == ERR)
+    return ERR;
+  return retflag;
+}
+
+/* name of a star given by a handle, in the format trad_name,nomeclat_name,
+ * and its magnitude */
+int32 swi_fixstar_name_mag(int32 istar, char *star, double *mag)
+{
+  struct fixed_star *stardata = fixstar_from_handle(istar);
+  if (stardata == NULL) {
+    if (star != NULL)
+      *star = '\0';
+    if (mag != NULL)
+      *mag = 0;
+    return ERR;
+  }
+  if (star != NULL)
+    sprintf(star, "%s,%s", stardata->starname, stardata->starbayer);
+  if (mag != NULL)
+    *mag = stardata->mag;
+  return OK;
+}
+
 char *CALL_CONV swe_get_planet_name(int ipl, char *s) 
 {
   int i;
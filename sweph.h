@@ -193,6 +193,9 @@
 
 #define SEI_NEPHFILES   7
 #define SEI_CURR_FPOS   -1
+#define SEI_NMAPFILES   100	/* ephemeris files shared mapped in memory */
+#define SEI_NSEGCACHE   256	/* unpacked segments shared between threads */
+#define SEI_NPRELOAD    64	/* bodies and files segments preloaded for */
 #define SEI_NMODELS 8
 
 #define SEI_ECL_GEOALT_MAX   25000.0
@@ -712,6 +715,8 @@ struct file_data {
   int32 sweph_denum;     /* DE number of JPL ephemeris, which this file
 			 * is derived from. */
   FILE *fptr;		/* ephemeris file pointer */
+  unsigned char *pbmap;	/* file contents mapped into memory, or NULL */
+  int32 cbmap;		/* size of mapped file contents */
   double tfstart;       /* file may be used from this date */
   double tfend;         /*      through this date          */
   int32 iflg; 		/* byte reorder flag and little/bigendian flag */
@@ -778,6 +783,19 @@ struct fixed_star {
   double epoch, ra, de, ramot, demot, radvel, parall, mag;
 };
 
+/* what fixed stars computed for the same time and flags share */
+struct fixstar_frame {
+  double tjd, dt;
+  int32 iflag, iflgsave;
+  double xearth[6], xearth_dt[6], xsun[6], xsun_dt[6];
+  double xobs[6], xobs_dt[6];
+  double *xpo, *xpo_dt;		/* observer for parallax, or NULL */
+};
+
+#define SEI_NSTARCAT    4	/* fixed star files shared between threads */
+#define SEI_NSTARBUILTIN 16	/* built-in stars handles are given for */
+#define SEI_STARHANDLE_BUILTIN 0x40000000	/* handle of first built-in star */
+
 /* dpsi and deps loaded for 100 years after 1962 */
 #define SWE_DATA_DPSI_DEPS  36525   
 
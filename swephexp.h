@@ -739,9 +739,23 @@ ext_def(int32) swe_fixstar2_ut(char *star, double tjd_ut, int32 iflag,
 
 ext_def(int32) swe_fixstar2_mag(char *star, double *mag, char *serr);
 
+/* look up fixed stars once, then compute many of them at one date */
+ext_def(int32) swi_fixstar_handle(char *star, char *serr);
+ext_def(int32) swi_fixstar_batch(int32 *rgistar, int nstar, double tjd, 
+	int32 iflag, double *xx, char *serr);
+ext_def(int32) swi_fixstar_name_mag(int32 istar, char *star, double *mag);
+
 /* close Swiss Ephemeris */
 ext_def( void ) swe_close(void);
 
+/* release ephemeris files shared in memory, after all threads closed */
+ext_def( void ) swi_unmap_files(void);
+
+/* decode ephemeris segments of a time range into memory ahead of time */
+ext_def( int ) swi_preload_range(double tjd_start, double tjd_end, 
+	int32 bodymask, char *serr);
+ext_def( int32 ) swi_preload_size(int32 *pnseg);
+
 /* set directory path of ephemeris files */
 ext_def( void ) swe_set_ephe_path(const char *path);
 
@@ -1335,16 +1335,29 @@ static int precess_3(double *R, double J, int direction, int iflag, int prec_met
   //double T;
   double x[3], pmat[9];
   int i, j;
+  /* Astrolog: The matrix for the most recent date is kept, so that all
+   * planets and speed vectors computed for one chart share it. */
+  static TLS double Jsave = 0, pmatsave[9];
+  static TLS int methsave = -1, flgsave = 0;
+  int flg = iflag & (SEFLG_JPLHOR | SEFLG_JPLHOR_APPROX);
   if( J == J2000 ) 
     return(0);
   /* Each precession angle is specified by a polynomial in
    * T = Julian centuries from J2000.0.  See AA page B18.
    */
   //T = (J - J2000)/36525.0;
-  if (prec_meth == SEMOD_PREC_OWEN_1990)
-    owen_pre_matrix(J, pmat, iflag);
-  else
-    pre_pmat(J, pmat);
+  if (J == Jsave && prec_meth == methsave && flg == flgsave) {
+    for (i = 0; i < 9; i++)
+      pmat[i] = pmatsave[i];
+  } else {
+    if (prec_meth == SEMOD_PREC_OWEN_1990)
+      owen_pre_matrix(J, pmat, iflag);
+    else
+      pre_pmat(J, pmat);
+    for (i = 0; i < 9; i++)
+      pmatsave[i] = pmat[i];
+    Jsave = J; methsave = prec_meth; flgsave = flg;
+  }
   if (direction == -1) {
     for (i = 0, j = 0; i <= 2; i++, j = i * 3) {
       x[i] = R[0] *  pmat[j + 0] +
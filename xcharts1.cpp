@@ -2083,6 +2083,9 @@ void XChartLocal()
     xr, yr, xi, yi, lon, lat, len;
   flag fShowLabel, fDidBitmap;
   TELE te;
+#ifdef ATLAS
+  AtlasBox ab;
+#endif
   static real lonPrev = rLarge, latPrev = rLarge;
   static int objPrev = nLarge;
 
@@ -2195,12 +2198,16 @@ void XChartLocal()
   }
 
 #ifdef ATLAS
-  // Draw locations of cities from atlas.
+  // Draw locations of cities from atlas, only looking at those in or near
+  // the area the chart covers.
   if (FEnsureAtlas()) {
     if (!gs.fLabelAsp)
       DrawColor(kOrangeB);
     KiCity(-1);
-    for (i = 0; i < is.cae; i++) {
+    xr = (real)xs/xScale/2.0 + 1.0; yr = (real)ys/yScale/2.0 + 1.0;
+    AtlasBoxInit(&ab, rDegHalf - xBase - xr, rDegHalf - xBase + xr,
+      yBase - yr, yBase + yr);
+    while ((i = IaeAtlasBoxNext(&ab)) >= 0) {
       lon = Mod(rDegHalf - is.rgae[i].lon);
       lat = is.rgae[i].lat;
       xr = MinDifference(xBase, lon); yr = lat - yBase;